@@ -7,7 +7,7 @@
 
 struct liActionRegexStackElement {
 	GString *string;
-	GMatchInfo *match_info;
+	liRegexMatch match; /* own copy of the offsets, subject is string */
 };
 
 struct liActionStack {
@@ -96,4 +96,8 @@ LI_API liAction* li_action_new_balancer(liBackendSelectCB bselect, liBackendFall
 /* LI_FORCE_ASSERT(list->refcount == 1)! converts list to a list in place if necessary */
 LI_API void li_action_append_inplace(liAction *list, liAction *element);
 
+/* replaces long if/else-if chains testing the same value (==, =^, =$ and =/) with dispatch tables, in place.
+ * call it only before the actions are used (see condition_dispatch.c) */
+LI_API void li_action_compile_dispatch(liServer *srv, liAction *a);
+
 #endif
@@ -11,6 +11,12 @@ LI_API void li_angel_setup(liServer *srv);
 /* listen to a socket (mainloop context) */
 LI_API void li_angel_listen(liServer *srv, GString *str, liAngelListenCB cb, gpointer data);
 
+/* listen to a socket with one SO_REUSEPORT socket per worker, each accepted in its own worker (mainloop context).
+ * needs the worker count, so call it after the workers were created (e.g. from a prepare callback).
+ * falls back to li_angel_listen() if SO_REUSEPORT sockets couldn't be created
+ */
+LI_API void li_angel_listen_reuseport(liServer *srv, GString *str);
+
 /* send log messages during startup to angel, frees the string */
 LI_API void li_angel_log(liServer *srv, GString *str);
 
@@ -18,6 +24,7 @@ LI_API void li_angel_log_open_file(liServer *srv, liEventLoop *loop, GString *fi
 
 /* angle_fake definitions, only for internal use */
 int li_angel_fake_listen(liServer *srv, GString *str);
+gboolean li_angel_fake_listen_reuseport(liServer *srv, GString *str, guint count, GArray *fds);
 gboolean li_angel_fake_log(liServer *srv, GString *str);
 int li_angel_fake_log_open_file(liServer *srv, GString *filename);
 
@@ -38,6 +38,7 @@ struct liPluginCoreConfig {
 
 	liInstance *inst;
 	GHashTable *listen_sockets;
+	GHashTable *listen_reuseport_sockets;
 
 	liEventSignal sig_hup;
 };
@@ -23,6 +23,7 @@
 #include <lighttpd/filter_chunked.h>
 #include <lighttpd/radix.h>
 #include <lighttpd/fetch.h>
+#include <lighttpd/regex.h>
 
 #include <lighttpd/value.h>
 #include <lighttpd/base_lua.h>
@@ -43,6 +44,7 @@
 #include <lighttpd/environment.h>
 #include <lighttpd/virtualrequest.h>
 #include <lighttpd/stat_cache.h>
+#include <lighttpd/file_cache.h>
 #include <lighttpd/mimetype.h>
 
 #include <lighttpd/connection.h>
@@ -90,7 +90,7 @@ struct liConditionRValue {
 
 	gboolean b;
 	GString *string;
-	GRegex *regex;
+	liRegex *regex;
 	gint64 i;
 	struct {
 		guint32 addr;
@@ -152,8 +152,15 @@ typedef struct {
 	} data;
 } liConditionValue;
 
+/* header values and the stat based physical lvalues are cached in the vrequest (vr->condition_cache) until the
+ * headers or physical path change; returned strings are valid until the next call.
+ */
 LI_API liHandlerResult li_condition_get_value(GString *tmpstr, liVRequest *vr, liConditionLValue *lvalue, liConditionValue *res, liConditionValueType prefer);
 /* tmpstr can be the same as for li_condition_get_value */
 LI_API gchar const* li_condition_value_to_string(GString *tmpstr, liConditionValue *value);
 
+/* called by li_vrequest_reset and li_vrequest_free */
+LI_API void li_condition_cache_reset(liVRequest *vr);
+LI_API void li_condition_cache_free(liVRequest *vr);
+
 #endif
@@ -13,4 +13,12 @@ LI_API gboolean li_http_response_handle_cachable(liVRequest *vr);
 LI_API void li_etag_mutate(GString *mut, GString *etag);
 LI_API void li_etag_set_header(liVRequest *vr, struct stat *st, gboolean *cachable);
 
+/* the pieces of li_etag_set_header, so the values can be computed once (stat cache) */
+/* etag for the given etag.use flags (liETagFlags) */
+LI_API void li_etag_create(GString *etag, struct stat *st, guint flags);
+/* http date for Last-Modified (zero terminated); returns the length, 0 if mtime can't be converted */
+LI_API gsize li_etag_last_modified(gchar *buf, gsize size, time_t mtime);
+/* sets (or removes if etag is NULL) the ETag and Last-Modified headers, and checks whether the request was a cache hit */
+LI_API void li_etag_set_header_values(liVRequest *vr, GString *etag, GString *last_modified, gboolean *cachable);
+
 #endif
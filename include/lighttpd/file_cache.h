@@ -0,0 +1,54 @@
+/*
+ * file cache - contents of small static files in memory
+ *
+ * The static handler can keep the contents of small files (static.memory_cache setup) in shared liBuffers, so a hit
+ * is appended as BUFFER_CHUNK (and written together with the response header in one writev) instead of a FILE_CHUNK.
+ *
+ * There is one cache for all workers, protected by a mutex (the buffers are refcounted, so the lock is only held for the
+ * lookup). Entries are keyed by path and are only valid for the same inode, size, mtime and ctime; as the stat info comes
+ * from the stat cache, entries are invalidated together with it. If the size limit is reached the least recently used
+ * entries are dropped.
+ */
+
+#ifndef _LIGHTTPD_FILE_CACHE_H_
+#define _LIGHTTPD_FILE_CACHE_H_
+
+#ifndef _LIGHTTPD_BASE_H_
+#error Please include <lighttpd/base.h> instead of this file
+#endif
+
+struct liFileCache {
+	GMutex *mutex;
+	GHashTable *entries;              /* path -> entry */
+	GQueue lru;                       /* most recently used first */
+
+	gsize max_file_size;
+	gsize max_size;
+	gsize size;                       /* sum of the cached file sizes */
+
+	guint64 hits;
+	guint64 misses;
+	guint64 evictions;                /* entries dropped because of the size limit */
+};
+
+struct liFileCacheStats {
+	guint64 hits;
+	guint64 misses;
+	guint64 evictions;
+	guint64 size;
+	guint64 entries;
+};
+
+LI_API liFileCache* li_file_cache_new(gsize max_file_size, gsize max_size);
+LI_API void li_file_cache_free(liFileCache *fc);
+
+/* returns a new reference to the cached contents of path if they are still valid for st, NULL otherwise */
+LI_API liBuffer* li_file_cache_get(liFileCache *fc, GString *path, struct stat *st);
+
+/* reads the file from fd (must be a regular file described by st, at most max_file_size bytes) and caches it.
+ * returns a new reference to the contents, or NULL if the file couldn't be read completely */
+LI_API liBuffer* li_file_cache_load(liFileCache *fc, GString *path, struct stat *st, int fd);
+
+LI_API void li_file_cache_get_stats(liFileCache *fc, liFileCacheStats *stats);
+
+#endif
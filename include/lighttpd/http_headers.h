@@ -14,13 +14,73 @@
 #define LI_HEADER_KEY_LEN(h) \
 	((h)->data->str), ((h)->keylen)
 
+/* ids for well known header names (case-insensitive), assigned when a header is inserted */
+typedef enum {
+	LI_HTTP_HEADER_UNKNOWN = 0,
+	LI_HTTP_HEADER_ACCEPT,
+	LI_HTTP_HEADER_ACCEPT_CHARSET,
+	LI_HTTP_HEADER_ACCEPT_ENCODING,
+	LI_HTTP_HEADER_ACCEPT_LANGUAGE,
+	LI_HTTP_HEADER_ACCEPT_RANGES,
+	LI_HTTP_HEADER_AGE,
+	LI_HTTP_HEADER_AUTHORIZATION,
+	LI_HTTP_HEADER_CACHE_CONTROL,
+	LI_HTTP_HEADER_CONNECTION,
+	LI_HTTP_HEADER_CONTENT_ENCODING,
+	LI_HTTP_HEADER_CONTENT_LANGUAGE,
+	LI_HTTP_HEADER_CONTENT_LENGTH,
+	LI_HTTP_HEADER_CONTENT_LOCATION,
+	LI_HTTP_HEADER_CONTENT_RANGE,
+	LI_HTTP_HEADER_CONTENT_TYPE,
+	LI_HTTP_HEADER_COOKIE,
+	LI_HTTP_HEADER_DATE,
+	LI_HTTP_HEADER_ETAG,
+	LI_HTTP_HEADER_EXPECT,
+	LI_HTTP_HEADER_EXPIRES,
+	LI_HTTP_HEADER_HOST,
+	LI_HTTP_HEADER_IF_MATCH,
+	LI_HTTP_HEADER_IF_MODIFIED_SINCE,
+	LI_HTTP_HEADER_IF_NONE_MATCH,
+	LI_HTTP_HEADER_IF_RANGE,
+	LI_HTTP_HEADER_IF_UNMODIFIED_SINCE,
+	LI_HTTP_HEADER_KEEP_ALIVE,
+	LI_HTTP_HEADER_LAST_MODIFIED,
+	LI_HTTP_HEADER_LOCATION,
+	LI_HTTP_HEADER_PRAGMA,
+	LI_HTTP_HEADER_PROXY_AUTHORIZATION,
+	LI_HTTP_HEADER_RANGE,
+	LI_HTTP_HEADER_REFERER,
+	LI_HTTP_HEADER_SERVER,
+	LI_HTTP_HEADER_SET_COOKIE,
+	LI_HTTP_HEADER_STATUS,
+	LI_HTTP_HEADER_TE,
+	LI_HTTP_HEADER_TRAILER,
+	LI_HTTP_HEADER_TRANSFER_ENCODING,
+	LI_HTTP_HEADER_UPGRADE,
+	LI_HTTP_HEADER_USER_AGENT,
+	LI_HTTP_HEADER_VARY,
+	LI_HTTP_HEADER_VIA,
+	LI_HTTP_HEADER_WWW_AUTHENTICATE,
+	LI_HTTP_HEADER_X_FORWARDED_FOR,
+	LI_HTTP_HEADER_X_FORWARDED_PROTO,
+	LI_HTTP_HEADER_X_SENDFILE,
+	LI_HTTP_HEADER_X_LIGHTTPD_SEND_FILE,
+	LI_HTTP_HEADER_ID_COUNT
+} liHttpHeaderId;
+
 struct liHttpHeader {
 	guint keylen;     /** length of "headername" in data */
 	GString *data;    /** "headername: value" */
+	liHttpHeaderId id;
 };
 
 struct liHttpHeaders {
 	GQueue entries;
+	/* first and last entry for each known header id, NULL if there is none. only modify headers with the functions below */
+	GList *id_first[LI_HTTP_HEADER_ID_COUNT];
+	GList *id_last[LI_HTTP_HEADER_ID_COUNT];
+	/* incremented by every modification (with the functions below), e.g. to validate cached header values */
+	guint version;
 };
 
 typedef struct liHttpHeaderTokenizer liHttpHeaderTokenizer;
@@ -51,6 +111,15 @@ LI_API void li_http_header_remove_link(liHttpHeaders *headers, GList *l);
 
 LI_API liHttpHeader* li_http_header_lookup(liHttpHeaders *headers, const gchar *key, size_t keylen);
 
+/** id for a header name, LI_HTTP_HEADER_UNKNOWN if it isn't a well known one */
+LI_API liHttpHeaderId li_http_header_id(const gchar *key, size_t keylen);
+
+/* constant time lookups for well known headers (id must not be LI_HTTP_HEADER_UNKNOWN) */
+INLINE GList* li_http_header_find_first_id(liHttpHeaders *headers, liHttpHeaderId id);
+INLINE GList* li_http_header_find_last_id(liHttpHeaders *headers, liHttpHeaderId id);
+LI_API GList* li_http_header_find_next_id(GList *l, liHttpHeaderId id);
+INLINE liHttpHeader* li_http_header_lookup_id(liHttpHeaders *headers, liHttpHeaderId id);
+
 LI_API GList* li_http_header_find_first(liHttpHeaders *headers, const gchar *key, size_t keylen);
 LI_API GList* li_http_header_find_next(GList *l, const gchar *key, size_t keylen);
 LI_API GList* li_http_header_find_last(liHttpHeaders *headers, const gchar *key, size_t keylen);
@@ -65,6 +134,19 @@ INLINE gboolean li_http_header_key_is(liHttpHeader *h, const gchar *key, size_t
 	return (h->keylen == keylen && 0 == g_ascii_strncasecmp(key, h->data->str, keylen));
 }
 
+INLINE GList* li_http_header_find_first_id(liHttpHeaders *headers, liHttpHeaderId id) {
+	return headers->id_first[id];
+}
+
+INLINE GList* li_http_header_find_last_id(liHttpHeaders *headers, liHttpHeaderId id) {
+	return headers->id_last[id];
+}
+
+INLINE liHttpHeader* li_http_header_lookup_id(liHttpHeaders *headers, liHttpHeaderId id) {
+	GList *l = headers->id_last[id];
+	return NULL == l ? NULL : (liHttpHeader*) l->data;
+}
+
 /* very simple tokenizer. splits at ' ' and ',', unquotes \\ escapes and "..." tokens */
 LI_API void li_http_header_tokenizer_start(liHttpHeaderTokenizer *tokenizer, liHttpHeaders *headers, const gchar *key, size_t keylen);
 LI_API gboolean li_http_header_tokenizer_next(liHttpHeaderTokenizer *tokenizer, GString *token);
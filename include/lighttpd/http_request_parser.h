@@ -19,5 +19,14 @@ LI_API void li_http_request_parser_clear(liHttpRequestCtx *ctx);
 
 LI_API liHandlerResult li_http_request_parse(liVRequest *vr, liHttpRequestCtx *ctx);
 
+/* returns the offset of the first byte in buf[0..len) the fast path of the parser doesn't handle itself:
+ * control characters except HT (including CR and LF), DEL, '"' and '\\'; len if there is none.
+ * uses SSE2/AVX2 if available */
+LI_API gsize li_http_request_scan(const gchar *buf, gsize len);
+/* name of the scanner variant selected for this cpu ("avx2", "sse2" or "scalar") */
+LI_API const gchar* li_http_request_scan_impl(void);
+/* the plain C variant, for comparison in the tests */
+LI_API gsize li_http_request_scan_fallback(const gchar *buf, gsize len);
+
 
 #endif
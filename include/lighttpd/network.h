@@ -18,24 +18,42 @@ LI_API ssize_t li_net_write(int fd, void *buf, ssize_t nbyte);
 /** repeats read after EINTR */
 LI_API ssize_t li_net_read(int fd, void *buf, ssize_t nbyte);
 
-LI_API liNetworkStatus li_network_write(int fd, liChunkQueue *cq, goffset write_max, GError **err);
+/** writes from cq to fd using the backend selected with srv->network_backend */
+LI_API liNetworkStatus li_network_write(liWorker *wrk, int fd, liChunkQueue *cq, goffset write_max, GError **err);
 LI_API liNetworkStatus li_network_read(int fd, liChunkQueue *cq, goffset read_max, liBuffer **buffer, GError **err);
 
 /* use writev for mem chunks, buffered read/write for files */
-LI_API liNetworkStatus li_network_write_writev(int fd, liChunkQueue *cq, goffset *write_max, GError **err);
+LI_API liNetworkStatus li_network_write_writev(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err);
 
 #ifdef USE_SENDFILE
 /* use sendfile for files, writev for mem chunks */
-LI_API liNetworkStatus li_network_write_sendfile(int fd, liChunkQueue *cq, goffset *write_max, GError **err);
+LI_API liNetworkStatus li_network_write_sendfile(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err);
 #endif
 
-/* write backends */
-LI_API liNetworkStatus li_network_backend_write(int fd, liChunkQueue *cq, goffset *write_max, GError **err);
-LI_API liNetworkStatus li_network_backend_writev(int fd, liChunkQueue *cq, goffset *write_max, GError **err);
+/* batch file reads and one sendmsg into a single io_uring submission; falls back to
+ * sendfile/writev if io_uring is not available. needs the worker for its (lazily created) ring */
+LI_API liNetworkStatus li_network_write_io_uring(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err);
+/** whether io_uring support was compiled in */
+LI_API gboolean li_network_io_uring_supported(void);
+LI_API void li_network_io_uring_free(liNetworkIOUring *uring);
+
+/* write backends
+ * - count the write syscalls in wrk->stats.write_syscalls
+ * - pass MSG_MORE (if available) if more data is written in the same call
+ *   (see LI_NETWORK_MORE), so the kernel doesn't push out partial packets
+ */
+LI_API liNetworkStatus li_network_backend_write(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err);
+LI_API liNetworkStatus li_network_backend_writev(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err);
+#ifdef USE_SENDFILE
+LI_API liNetworkStatus li_network_backend_sendfile(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err);
+#endif
+
+/* whether more data follows directly after we_have bytes of cq in the same write call */
+#define LI_NETWORK_MORE(cq, we_have, write_max) ((we_have) < (cq)->length && (we_have) < (write_max))
 
 #define LI_NETWORK_FALLBACK(f, write_max) do { \
 	liNetworkStatus res; \
-	switch(res = f(fd, cq, write_max, err)) { \
+	switch(res = f(wrk, fd, cq, write_max, err)) { \
 		case LI_NETWORK_STATUS_SUCCESS: \
 			break; \
 		default: \
@@ -9,6 +9,7 @@ enum liCoreOptions {
 	LI_CORE_OPTION_DEBUG_REQUEST_HANDLING = 0,
 
 	LI_CORE_OPTION_STATIC_RANGE_REQUESTS,
+	LI_CORE_OPTION_STATIC_PRECOMPRESSED,
 
 	LI_CORE_OPTION_MAX_KEEP_ALIVE_IDLE,
 	LI_CORE_OPTION_MAX_KEEP_ALIVE_REQUESTS,
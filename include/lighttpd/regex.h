@@ -0,0 +1,61 @@
+/*
+ * regex - regular expressions for conditions, rewrite, redirect and vhost
+ *
+ * Patterns are compiled once at config load. With PCRE2 (HAVE_PCRE2) they are also jit compiled; without it
+ * GRegex is used. Patterns are matched as raw bytes (no UTF-8 checks), like GRegex with G_REGEX_RAW did before.
+ *
+ * Matching needs a liRegexMatchData block; every worker has one (wrk->regex_match_data) which is reused for all
+ * matches in the worker. The capture offsets in a liRegexMatch point into that block and are only valid until the
+ * next match with the same block; use li_regex_match_copy() to keep them longer (e.g. on the regex stack).
+ */
+
+#ifndef _LIGHTTPD_REGEX_H_
+#define _LIGHTTPD_REGEX_H_
+
+#ifndef _LIGHTTPD_BASE_H_
+#error Please include <lighttpd/base.h> instead of this file
+#endif
+
+/* offset of capture groups that didn't participate in the match */
+#define LI_REGEX_UNSET (~(gsize) 0)
+
+struct liRegexMatch {
+	const gchar *subject;
+	guint count;     /* number of start/end pairs in ovector: highest matched group + 1 */
+	gsize *ovector;  /* start/end offsets of $0, $1, ... */
+};
+
+#define LI_REGEX_ERROR li_regex_error_quark()
+LI_API GQuark li_regex_error_quark(void);
+
+/* returns NULL and sets err if the pattern can't be compiled */
+LI_API liRegex* li_regex_new(const gchar *pattern, GError **err);
+LI_API void li_regex_free(liRegex *regex);
+
+LI_API const gchar* li_regex_get_pattern(liRegex *regex);
+/* whether the pattern is matched by jit compiled code */
+LI_API gboolean li_regex_is_jit(liRegex *regex);
+/* "pcre2" or "glib" */
+LI_API const gchar* li_regex_impl(void);
+
+LI_API liRegexMatchData* li_regex_match_data_new(void);
+LI_API void li_regex_match_data_free(liRegexMatchData *md);
+
+/* match may be NULL if the captures aren't needed; on success it references subject and md */
+LI_API gboolean li_regex_match(liRegex *regex, liRegexMatchData *md, const gchar *subject, gsize len, liRegexMatch *match);
+
+/* like g_match_info_fetch_pos, but returns FALSE for groups that didn't participate in the match */
+LI_API gboolean li_regex_match_fetch_pos(const liRegexMatch *match, guint n, gsize *start, gsize *end);
+
+/* copy the offsets of src into dest, which then references subject (a copy of the matched string) instead */
+LI_API void li_regex_match_copy(liRegexMatch *dest, const liRegexMatch *src, const gchar *subject);
+/* only for copies from li_regex_match_copy */
+LI_API void li_regex_match_clear(liRegexMatch *match);
+
+/* the longest literal string every subject matching the regex has to contain (respecting case), or NULL if the
+ * pattern doesn't require one or uses features this doesn't follow (like top-level alternatives or option settings).
+ * can be used to skip matching a regex; free the result with g_string_free.
+ */
+LI_API GString* li_regex_required_literal(liRegex *regex);
+
+#endif
@@ -11,6 +11,21 @@ struct liResponse {
 	liTransferEncoding transfer_encoding;
 };
 
+/* per worker state to serialize response headers without allocations:
+ * the headers are written into a shared buffer which is appended as BUFFER_CHUNK, and the status, Date and Server
+ * lines are prepared only once (Date once per second)
+ */
+struct liResponseWriter {
+	liBuffer *buf;                 /* reset when all responses using it are sent */
+	time_t date_ts;                /* second date_line was generated for */
+	GString *date_line;            /* "Date: ...\r\n" */
+	GString *server_line;          /* "Server: ...\r\n" for the last used server.tag */
+	GString *status_lines[2][500]; /* [HTTP/1.0, HTTP/1.1][status - 100]: "HTTP/1.x 200 OK\r\n", created when first used */
+};
+
+LI_API liResponseWriter* li_response_writer_new(void);
+LI_API void li_response_writer_free(liResponseWriter *rw);
+
 LI_API void li_response_init(liResponse *resp);
 LI_API void li_response_reset(liResponse *resp);
 LI_API void li_response_clear(liResponse *resp);
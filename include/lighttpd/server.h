@@ -30,6 +30,8 @@ typedef enum {
 struct liServerSocket {
 	gint refcount;
 	liServer *srv;
+	liWorker *wrk;          /** NULL: accepted by the main worker, which distributes the connections;
+	                          * otherwise (SO_REUSEPORT) accepted in the loop of this worker */
 	liEventIO watcher;
 
 	liSocketAddress local_addr;
@@ -76,6 +78,8 @@ struct liServer {
 	liEventTimer srv_1sec_timer;
 
 	GPtrArray *sockets;          /** array of (server_socket*) */
+	guint listen_reuseport_sockets; /** number of worker owned (SO_REUSEPORT) sockets in sockets */
+	gboolean listen_reuseport_active; /** atomic access; whether worker owned sockets should accept connections */
 
 	liModules *modules;
 
@@ -119,8 +123,11 @@ struct liServer {
 	guint keep_alive_queue_timeout;
 
 	gdouble io_timeout;
+	liNetworkBackend network_backend; /**< backend used by li_network_write, see io.write_backend */
 
 	gdouble stat_cache_ttl;
+	gboolean stat_cache_mime_type_xattr; /**< read content type from user.mime_type xattr */
+	liFileCache *file_cache; /**< contents of small static files, see static.memory_cache; NULL if disabled */
 	gint tasklet_pool_threads;
 };
 
@@ -130,6 +137,8 @@ LI_API void li_server_free(liServer* srv);
 LI_API void li_server_loop_init(liServer *srv);
 
 LI_API liServerSocket* li_server_listen(liServer *srv, int fd);
+/* socket is assigned to a worker (round-robin), connections are accepted in that worker; needs initialized workers */
+LI_API liServerSocket* li_server_listen_reuseport(liServer *srv, int fd);
 
 /* exit asap with cleanup */
 LI_API void li_server_exit(liServer *srv);
@@ -6,13 +6,25 @@
  * This means that there will be more blocking stat() calls than there would be with only one shared cache but since there
  * should be mostly hits in most cases (few items requested frequently) it will outweight the locking contention.
  * To prevent the stat() from blocking all other requests of that worker, we hand it over to another thread.
+ * For single entries that thread also open()s the file and uses fstat(); regular files are kept open in the entry
+ * and shared (refcounted liChunkFile) by all requests until the entry expires, so a hit doesn't need any syscall.
+ * This means a cached fd (and its stat info) can refer to a file that was replaced or deleted up to TTL seconds ago.
  *
  * Entries are removed after 10 seconds (adjustable through stat_cache.ttl setup)
  *
- * TODO:
- *     - create ETAGs
- *     - get content type from xattr
- *     - add support for inotify (linux). TTL for entries can be increased to 60s
+ * With inotify (linux) each worker watches the directories of its cached entries (and all their parent directories,
+ * so a renamed directory or a swapped symlink in the path is noticed too); entries are removed as soon as something
+ * changes, so the TTL can be increased to minutes. Entries in directories which can't be watched (out of watches,
+ * no permission, ...) still rely on the TTL.
+ *
+ * Failed lookups (ENOENT/ENOTDIR) in watched directories are not kept as entries but in a small hashed "negative set"
+ * per worker, together with the directory generation (sc->generation at the time of the lookup). As long as neither
+ * the directory nor its parents had entries added, removed or renamed since, the path is known to be missing without
+ * a stat() or tasklet job. This absorbs 404 floods without filling the cache.
+ *
+ * Header values for static files are computed once per entry and reused on hits: Last-Modified by the stat thread,
+ * the ETag (for the etag.use flags of the request) and the content type (from mime_types, or from the
+ * "user.mime_type" xattr if enabled with the stat_cache.mime_type_xattr setup) on first use.
  *
  * Technical details:
  * If a stat is requested, the following procedure takes place:
@@ -41,8 +53,11 @@
 
 struct liStatCacheEntryData {
 	GString *path;
-	GString *etag;
-	GString *content_type;
+	GString *etag;                    /* see li_stat_cache_etag(); NULL until first used */
+	guint etag_flags;                 /* etag.use flags etag was created for */
+	GString *last_modified;           /* http date of st_mtime (single entries only), NULL if not available */
+	GString *content_type;            /* see li_stat_cache_content_type(); NULL until first used */
+	gpointer content_type_mime_types; /* mime_types option content_type was looked up in, NULL if it came from the xattr */
 	gboolean failed;
 	struct stat st;
 	gint err;
@@ -60,6 +75,8 @@ struct liStatCacheEntry {
 	} state;
 
 	liStatCacheEntryData data;
+	liChunkFile *file;                /* opened regular file (STAT_CACHE_ENTRY_SINGLE only), NULL if not regular, open() failed or closed by the limit */
+	GList open_files_link;            /* in sc->open_files while the cached entry holds file */
 	GArray *dirlist;                  /* array of stat_cache_entry_data, used together with STAT_CACHE_ENTRY_DIR */
 
 	liStatCache *sc;
@@ -67,6 +84,16 @@ struct liStatCacheEntry {
 	guint refcount;                   /* vrequests, delete_queue and tasklet hold references; dirlist/entrie cache entries are always in delete_queue too */
 	liWaitQueueElem queue_elem;       /* queue element for the delete_queue */
 	gboolean cached;
+	liStatCacheWatch *watch;          /* inotify watch of the directory (the parent directory for single entries) while cached */
+	guint64 generation;               /* sc->generation when the lookup was started */
+	gboolean mime_type_xattr;         /* read the content type from the user.mime_type xattr */
+};
+
+struct liStatCacheNegativeEntry {
+	GString *path;                    /* the missing path; allocated on first use of the slot */
+	guint64 generation;               /* valid as long as the watched directories didn't change since */
+	liStatCacheWatch *watch;          /* parent directory of the path, NULL for empty slots */
+	gint err;
 };
 
 struct liStatCache {
@@ -75,9 +102,27 @@ struct liStatCache {
 	liWaitQueue delete_queue;
 	gdouble ttl;
 
+	/* inotify; inotify_fd is -1 if not available */
+	int inotify_fd;
+	liEventIO inotify_watcher;
+	GHashTable *watches;              /* directory path -> liStatCacheWatch */
+	GHashTable *watch_descriptors;    /* inotify watch descriptor -> GSList of liStatCacheWatch (same inode, different paths) */
+	GString *inotify_path;
+	guint64 generation;               /* incremented for each change of a watched directory */
+
+	liStatCacheNegativeEntry *negative; /* known missing paths, direct mapped by hash */
+	guint64 negative_seed;            /* random, so clients can't pick paths that compete for one slot */
+
+	GQueue open_files;                /* cached entries holding an open file, least recently used first */
+	guint max_open_files;             /* derived from RLIMIT_NOFILE and the number of workers */
+	gboolean mime_type_xattr;
+
 	guint64 hits;
 	guint64 misses;
 	guint64 errors;
+	guint64 invalidations;            /* entries removed because of inotify events */
+	guint64 negative_hits;            /* lookups answered by the negative set */
+	guint64 negative_misses;          /* failed lookups added to the negative set */
 };
 
 LI_API liStatCache* li_stat_cache_new(liWorker *wrk, gdouble ttl);
@@ -85,11 +130,25 @@ LI_API void li_stat_cache_free(liStatCache *sc);
 
 /*
  gets a stat_cache_entry for a specified path
- if fd is set, a new fd is acquired via open() and stat info via fstat(), otherwise only a stat() is performed
+ if fd is set, a new fd is acquired (dup() of the cached fd or open()) and stat info via fstat(), otherwise only a stat() is performed
+ if fd is set and the path is not a regular file, *fd may be -1
  returns HANDLER_WAIT_FOR_EVENT in case of a cache MISS, HANDLER_GO_ON in case of a hit and HANDLER_ERROR in case of an error
 */
 LI_API liHandlerResult li_stat_cache_get(liVRequest *vr, GString *path, struct stat *st, int *err, int *fd);
 
+/*
+ like li_stat_cache_get, but returns the shared liChunkFile for regular files (*file is NULL for other types);
+ release it with li_chunkfile_release(). on a cache hit this doesn't need any syscall (no open, no dup).
+ if data is not NULL it is set to the cached entry data (for the precomputed header values) on a cache hit, and to NULL
+ otherwise; it is only valid until the handler returns.
+*/
+LI_API liHandlerResult li_stat_cache_get_file(liVRequest *vr, GString *path, struct stat *st, int *err, liChunkFile **file, liStatCacheEntryData **data);
+
+/* ETag for the etag.use flags of the request (NULL if disabled); created once per entry */
+LI_API GString* li_stat_cache_etag(liVRequest *vr, liStatCacheEntryData *sced);
+/* content type from the xattr or the mime_types of the request (NULL if unknown); looked up once per entry */
+LI_API GString* li_stat_cache_content_type(liVRequest *vr, liStatCacheEntryData *sced);
+
 /* doesn't return HANDLER_WAIT_FOR_EVENT, blocks instead of async lookup */
 LI_API liHandlerResult li_stat_cache_get_sync(liVRequest *vr, GString *path, struct stat *st, int *err, int *fd);
 
@@ -136,6 +136,14 @@ typedef enum {
 	LI_NETWORK_STATUS_WAIT_FOR_EVENT       /**< read/write returned -1 with errno=EAGAIN/EWOULDBLOCK */
 } liNetworkStatus;
 
+typedef enum {
+	LI_NETWORK_BACKEND_WRITEV,             /**< writev for mem chunks, buffered read/write for files */
+	LI_NETWORK_BACKEND_SENDFILE,           /**< writev for mem chunks, sendfile for files */
+	LI_NETWORK_BACKEND_IO_URING            /**< linked io_uring reads + one sendmsg per submission */
+} liNetworkBackend;
+
+typedef struct liNetworkIOUring liNetworkIOUring;
+
 /* options.h */
 
 typedef union liOptionValue liOptionValue;
@@ -167,6 +175,12 @@ typedef struct liServerSetup liServerSetup;
 
 typedef struct liPluginAngel liPluginAngel;
 
+/* regex.h */
+
+typedef struct liRegex liRegex;
+typedef struct liRegexMatch liRegexMatch;
+typedef struct liRegexMatchData liRegexMatchData;
+
 /* request.h */
 
 typedef enum {
@@ -211,6 +225,8 @@ typedef struct liPhysical liPhysical;
 
 typedef struct liResponse liResponse;
 
+typedef struct liResponseWriter liResponseWriter;
+
 /* server.h */
 
 typedef struct liServerStateWait liServerStateWait;
@@ -264,5 +280,12 @@ typedef struct liWorker liWorker;
 typedef struct liStatCacheEntryData liStatCacheEntryData;
 typedef struct liStatCacheEntry liStatCacheEntry;
 typedef struct liStatCache liStatCache;
+typedef struct liStatCacheWatch liStatCacheWatch;
+typedef struct liStatCacheNegativeEntry liStatCacheNegativeEntry;
+
+/* file_cache.h */
+
+typedef struct liFileCache liFileCache;
+typedef struct liFileCacheStats liFileCacheStats;
 
 #endif
@@ -34,6 +34,9 @@ LI_API void li_url_decode(GString *path);
 
 LI_API void li_path_simplify(GString *path);
 
+/* li_url_decode() and li_path_simplify() in one pass */
+LI_API void li_url_decode_path_simplify(GString *path);
+
 /* ensures path has a trailing slash */
 INLINE void li_path_append_slash(GString *path);
 
@@ -76,8 +76,13 @@ struct liVRequest {
 	liConInfo *coninfo;
 	liWorker *wrk;
 
+	/* start as copies of the server defaults; the optionptrs only hold a reference for slots an action changed
+	 * (the defaults are borrowed). options_changed and optionptrs_changed record the indices actions set, so
+	 * reset/free only have to restore/release those.
+	 */
 	liOptionValue *options;
 	liOptionPtrValue **optionptrs;
+	GArray *options_changed, *optionptrs_changed; /* guint indices */
 
 	liLogContext log_context;
 
@@ -111,6 +116,8 @@ struct liVRequest {
 	liJob job;
 
 	GPtrArray *stat_cache_entries;
+
+	GArray *condition_cache; /* lvalues cached by li_condition_get_value, created on first use */
 };
 
 #define LI_VREQUEST_WAIT_FOR_REQUEST_BODY(vr) \
@@ -137,6 +144,10 @@ LI_API void li_vrequest_free(liVRequest *vr);
  */
 LI_API void li_vrequest_reset(liVRequest *vr, gboolean keepalive);
 
+/* used by the setting actions; value references are not taken over (the caller keeps its own) */
+LI_API void li_vrequest_set_option(liVRequest *vr, guint ndx, liOptionValue value);
+LI_API void li_vrequest_set_optionptr(liVRequest *vr, guint ndx, liOptionPtrValue *value);
+
 /****************************************************/
 /* called by connection                             */
 /****************************************************/
@@ -19,6 +19,10 @@ struct liStatistics {
 	guint64 active_cons_cum;  /** cummulative value of active connections, updated once a second */
 
 	guint64 actions_executed; /** actions executed */
+	guint64 condition_cache_hits; /** condition lvalues taken from the per request cache instead of evaluated again */
+
+	guint64 write_syscalls;   /** network write syscalls (write, writev, sendmsg, sendfile, io_uring_enter) */
+	guint64 cork_syscalls;    /** setsockopt(TCP_CORK) calls around network writes */
 
 	/* 5 seconds frame avg */
 	guint64 requests_5s;
@@ -42,6 +46,39 @@ struct liStatistics {
 	guint64 last_requests;
 	double requests_per_sec;
 	li_tstamp last_update;
+
+	li_tstamp loop_lag;       /** how late the stats timer fired (seconds, smoothed): event loop latency */
+	li_tstamp next_update;    /** when the stats timer is due */
+};
+
+/* must be a power of 2 */
+#define LI_WORKER_NEW_CON_RING_SIZE 256
+
+typedef struct liWorkerNewCon liWorkerNewCon;
+struct liWorkerNewCon {
+	liSockAddr remote_addr;
+	socklen_t remote_addr_len;
+	int s;
+	liServerSocket *srv_sock;
+};
+
+/* bounded single-producer (main worker) / single-consumer (target worker) ring of accepted sockets.
+ * the producer fills slots and publishes them by advancing head; the consumer drains all
+ * published slots on a single wakeup and advances tail.
+ */
+typedef struct liWorkerNewConRing liWorkerNewConRing;
+struct liWorkerNewConRing {
+	/* producer side */
+	guint head;           /** next slot to fill; atomic access */
+	guint flushed;        /** head at the last flush, producer only */
+	gchar pad1[64 - 2*sizeof(guint)];
+
+	/* consumer side */
+	guint tail;           /** next slot to drain; atomic access */
+	gint wakeup;          /** atomic access; TRUE if a wakeup was sent and not handled yet */
+	gchar pad2[64 - sizeof(guint) - sizeof(gint)];
+
+	liWorkerNewCon cons[LI_WORKER_NEW_CON_RING_SIZE];
 };
 
 typedef struct liWorkerTS liWorkerTS;
@@ -73,6 +110,8 @@ struct liWorker {
 
 	GString *tmp_str;         /**< can be used everywhere for local temporary needed strings */
 
+	liRegexMatchData *regex_match_data; /**< for li_regex_match, use only from local worker context */
+
 	/* keep alive timeout queue */
 	liEventTimer keep_alive_timer;
 	GQueue keep_alive_queue;
@@ -89,7 +128,12 @@ struct liWorker {
 	/* incoming queues */
 	/*  - new connections (after accept) */
 	liEventAsync new_con_watcher;
-	GAsyncQueue *new_con_queue;
+	liWorkerNewConRing *new_con_ring;
+	/*  - listening sockets accepted in this worker (SO_REUSEPORT) */
+	liEventAsync listen_watcher;
+	GAsyncQueue *new_listen_queue; /** (liServerSocket*) waiting to be attached to the worker loop */
+	GPtrArray *listen_sockets;     /** (liServerSocket*) attached to the worker loop, use only from local worker context */
+	gboolean listen_limit_hit;     /** connection limit was hit and listen_sockets are disabled, use only from local worker context */
 
 	liServerStateWait wait_for_stop_connections;
 
@@ -105,6 +149,11 @@ struct liWorker {
 	liStatCache *stat_cache;
 
 	liBuffer *network_read_buf; /** available buffer - steal it if you need it, can be NULL. refcount must be 1, no other references. */
+
+	liResponseWriter *response_writer; /** see li_response_send_headers, use only from local worker context */
+
+	liNetworkIOUring *network_io_uring; /** lazily created by the io_uring write backend, only used in the worker thread */
+	gboolean network_io_uring_failed; /** io_uring setup failed, don't try again */
 };
 
 LI_API liWorker* li_worker_new(liServer *srv, struct ev_loop *loop);
@@ -121,7 +170,19 @@ LI_API void li_worker_stopping(liWorker *context, liWorker *wrk);
 LI_API void li_worker_suspend(liWorker *context, liWorker *wrk);
 LI_API void li_worker_exit(liWorker *context, liWorker *wrk);
 
-LI_API void li_worker_new_con(liWorker *ctx, liWorker *wrk, liSocketAddress remote_addr, int s, liServerSocket *srv_sock);
+/* remote_addr is copied. if ctx != wrk the connection is queued in wrk's ring, call li_worker_new_con_flush()
+ * after a batch of connections to wake up wrk. if the ring is full the connection is started in ctx instead.
+ */
+LI_API void li_worker_new_con(liWorker *ctx, liWorker *wrk, const liSockAddr *remote_addr, socklen_t remote_addr_len, int s, liServerSocket *srv_sock);
+/* wake up wrk if connections were queued since the last flush */
+LI_API void li_worker_new_con_flush(liWorker *ctx, liWorker *wrk);
+
+/* hand a listening socket to wrk, which accepts connections on it in its own loop */
+LI_API void li_worker_add_listen_socket(liWorker *ctx, liWorker *wrk, liServerSocket *srv_sock);
+/* start/stop the worker's own listening sockets according to srv->listen_reuseport_active */
+LI_API void li_worker_listen(liWorker *ctx, liWorker *wrk);
+/* local worker context only: disable own listening sockets until the connection load dropped */
+LI_API void li_worker_listen_limit_hit(liWorker *wrk);
 
 LI_API void li_worker_check_keepalive(liWorker *wrk);
 
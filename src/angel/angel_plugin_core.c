@@ -21,6 +21,8 @@ struct listen_socket {
 
 	liSocketAddress addr;
 	int fd;
+
+	GArray *reuseport_fds; /* (int), SO_REUSEPORT group; NULL for plain sockets (fd == -1 otherwise) */
 };
 
 struct listen_ref_resource {
@@ -488,6 +490,14 @@ static listen_socket* listen_new_socket(liSocketAddress *addr, int fd) {
 	return sock;
 }
 
+static listen_socket* listen_new_reuseport_socket(liSocketAddress *addr) {
+	listen_socket *sock = listen_new_socket(addr, -1);
+
+	sock->reuseport_fds = g_array_new(FALSE, FALSE, sizeof(int));
+
+	return sock;
+}
+
 static void listen_socket_acquire(listen_socket *sock) {
 	g_atomic_int_inc(&sock->refcount);
 }
@@ -502,7 +512,11 @@ static void listen_ref_release(liServer *srv, liInstance *i, liPlugin *p, liInst
 	if (g_atomic_int_dec_and_test(&sock->refcount)) {
 		liPluginCoreConfig *config = (liPluginCoreConfig*) p->data;
 
-		g_hash_table_remove(config->listen_sockets, &sock->addr);
+		if (NULL != sock->reuseport_fds) {
+			g_hash_table_remove(config->listen_reuseport_sockets, &sock->addr);
+		} else {
+			g_hash_table_remove(config->listen_sockets, &sock->addr);
+		}
 	}
 
 	g_slice_free(listen_ref_resource, ref);
@@ -512,7 +526,15 @@ static void _listen_socket_free(gpointer ptr) {
 	listen_socket *sock = ptr;
 
 	li_sockaddr_clear(&sock->addr);
-	close(sock->fd);
+	if (-1 != sock->fd) close(sock->fd);
+
+	if (NULL != sock->reuseport_fds) {
+		guint i;
+		for (i = 0; i < sock->reuseport_fds->len; i++) {
+			close(g_array_index(sock->reuseport_fds, int, i));
+		}
+		g_array_free(sock->reuseport_fds, TRUE);
+	}
 
 	g_slice_free(listen_socket, sock);
 }
@@ -605,10 +627,17 @@ static gboolean listen_check_acl(liServer *srv, liPluginCoreConfig *config, liSo
 	return FALSE;
 }
 
-static int do_listen(liServer *srv, liSocketAddress *addr, GString *str) {
+static int do_listen(liServer *srv, liSocketAddress *addr, GString *str, gboolean reuseport) {
 	int s, v;
 	GString *ipv6_str;
 
+#ifndef SO_REUSEPORT
+	if (reuseport) {
+		ERROR(srv, "Couldn't listen on '%s': SO_REUSEPORT not supported", str->str);
+		return -1;
+	}
+#endif
+
 	switch (addr->addr->plain.sa_family) {
 	case AF_INET:
 		if (-1 == (s = socket(AF_INET, SOCK_STREAM, 0))) {
@@ -621,6 +650,13 @@ static int do_listen(liServer *srv, liSocketAddress *addr, GString *str) {
 			ERROR(srv, "Couldn't setsockopt(SO_REUSEADDR): %s", g_strerror(errno));
 			return -1;
 		}
+#ifdef SO_REUSEPORT
+		if (reuseport && -1 == setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &v, sizeof(v))) {
+			close(s);
+			ERROR(srv, "Couldn't setsockopt(SO_REUSEPORT): %s", g_strerror(errno));
+			return -1;
+		}
+#endif
 		if (-1 == bind(s, &addr->addr->plain, addr->len)) {
 			close(s);
 			ERROR(srv, "Couldn't bind socket to '%s': %s", str->str, g_strerror(errno));
@@ -660,6 +696,14 @@ static int do_listen(liServer *srv, liSocketAddress *addr, GString *str) {
 			g_string_free(ipv6_str, TRUE);
 			return -1;
 		}
+#ifdef SO_REUSEPORT
+		if (reuseport && -1 == setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &v, sizeof(v))) {
+			close(s);
+			ERROR(srv, "Couldn't setsockopt(SO_REUSEPORT): %s", g_strerror(errno));
+			g_string_free(ipv6_str, TRUE);
+			return -1;
+		}
+#endif
 		if (-1 == bind(s, &addr->addr->plain, addr->len)) {
 			close(s);
 			ERROR(srv, "Couldn't bind socket to '%s': %s", ipv6_str->str, g_strerror(errno));
@@ -682,6 +726,10 @@ static int do_listen(liServer *srv, liSocketAddress *addr, GString *str) {
 #endif
 #ifdef HAVE_SYS_UN_H
 	case AF_UNIX:
+		if (reuseport) {
+			ERROR(srv, "Couldn't listen on '%s': SO_REUSEPORT not supported for unix sockets", str->str);
+			return -1;
+		}
 		if (-1 == unlink(addr->addr->un.sun_path)) {
 			switch (errno) {
 			case ENOENT:
@@ -750,7 +798,7 @@ static void core_listen(liServer *srv, liPlugin *p, liInstance *i, gint32 id, GS
 	}
 
 	if (NULL == (sock = g_hash_table_lookup(config->listen_sockets, &addr))) {
-		fd = do_listen(srv, &addr, data);
+		fd = do_listen(srv, &addr, data, FALSE);
 
 		if (-1 == fd) {
 			GString *error = g_string_sized_new(0);
@@ -795,6 +843,122 @@ static void core_listen(liServer *srv, liPlugin *p, liInstance *i, gint32 id, GS
 	}
 }
 
+/* data: "<count> <socket address>"; returns at least <count> sockets bound with SO_REUSEPORT */
+static void core_listen_reuseport(liServer *srv, liPlugin *p, liInstance *i, gint32 id, GString *data) {
+	GError *err = NULL;
+	gint fd;
+	guint j;
+	guint64 count;
+	gchar *endptr;
+	GString *addrstr;
+	GArray *fds;
+	liPluginCoreConfig *config = (liPluginCoreConfig*) p->data;
+	liSocketAddress addr;
+	listen_socket *sock;
+
+	if (-1 == id) return; /* ignore simple calls */
+
+	count = g_ascii_strtoull(data->str, &endptr, 10);
+	if (endptr == data->str || ' ' != *endptr || count < 1 || count > 1024) {
+		GString *error = g_string_sized_new(0);
+		g_string_printf(error, "Invalid reuseport listen request: '%s'", data->str);
+		if (!li_angel_send_result(i->acon, id, error, NULL, NULL, &err)) {
+			ERROR(srv, "Couldn't send result: %s", err->message);
+			g_error_free(err);
+		}
+		return;
+	}
+	addrstr = g_string_new(endptr + 1);
+
+	addr = li_sockaddr_from_string(addrstr, 80);
+	if (!addr.addr) {
+		GString *error = g_string_sized_new(0);
+		g_string_printf(error, "Invalid socket address: '%s'", addrstr->str);
+		g_string_free(addrstr, TRUE);
+		if (!li_angel_send_result(i->acon, id, error, NULL, NULL, &err)) {
+			ERROR(srv, "Couldn't send result: %s", err->message);
+			g_error_free(err);
+		}
+		return;
+	}
+
+	if (!listen_check_acl(srv, config, &addr)) {
+		GString *error = g_string_sized_new(0);
+		li_sockaddr_clear(&addr);
+		g_string_printf(error, "Socket address not allowed: '%s'", addrstr->str);
+		g_string_free(addrstr, TRUE);
+		if (!li_angel_send_result(i->acon, id, error, NULL, NULL, &err)) {
+			ERROR(srv, "Couldn't send result: %s", err->message);
+			g_error_free(err);
+		}
+		return;
+	}
+
+	if (NULL == (sock = g_hash_table_lookup(config->listen_reuseport_sockets, &addr))) {
+		sock = listen_new_reuseport_socket(&addr);
+		g_hash_table_insert(config->listen_reuseport_sockets, &sock->addr, sock);
+	} else {
+		li_sockaddr_clear(&addr);
+	}
+
+	/* grow the group if the new instance has more workers; a smaller group is never shrunk,
+	 * as the kernel keeps routing connections to all sockets in it. the worker distributes
+	 * surplus sockets over its workers */
+	while (sock->reuseport_fds->len < count) {
+		fd = do_listen(srv, &sock->addr, addrstr, TRUE);
+
+		if (-1 == fd) {
+			GString *error = g_string_sized_new(0);
+			g_string_printf(error, "Couldn't listen to '%s' with SO_REUSEPORT", addrstr->str);
+			g_string_free(addrstr, TRUE);
+			if (0 == g_atomic_int_get(&sock->refcount)) {
+				/* not used by any instance yet */
+				g_hash_table_remove(config->listen_reuseport_sockets, &sock->addr);
+			}
+			if (!li_angel_send_result(i->acon, id, error, NULL, NULL, &err)) {
+				ERROR(srv, "Couldn't send result: %s", err->message);
+				g_error_free(err);
+			}
+			return;
+		}
+
+		li_fd_init(fd);
+		g_array_append_val(sock->reuseport_fds, fd);
+	}
+
+	g_string_free(addrstr, TRUE);
+
+	listen_socket_add(i, p, sock);
+
+	fds = g_array_sized_new(FALSE, FALSE, sizeof(int), sock->reuseport_fds->len);
+	for (j = 0; j < sock->reuseport_fds->len; j++) {
+		fd = dup(g_array_index(sock->reuseport_fds, int, j));
+
+		if (-1 == fd) {
+			/* socket ref will be released when instance is released */
+			GString *error = g_string_sized_new(0);
+			g_string_printf(error, "Couldn't duplicate fd");
+			for (j = 0; j < fds->len; j++) {
+				close(g_array_index(fds, int, j));
+			}
+			g_array_free(fds, TRUE);
+			if (!li_angel_send_result(i->acon, id, error, NULL, NULL, &err)) {
+				ERROR(srv, "Couldn't send result: %s", err->message);
+				g_error_free(err);
+			}
+			return;
+		}
+
+		g_array_append_val(fds, fd);
+	}
+
+	if (!li_angel_send_result(i->acon, id, NULL, NULL, fds, &err)) {
+		ERROR(srv, "Couldn't send result: %s", err->message);
+		g_error_free(err);
+		return;
+	}
+}
+
 static void core_reached_state(liServer *srv, liPlugin *p, liInstance *i, gint32 id, GString *data) {
 	UNUSED(srv);
 	UNUSED(p);
@@ -894,6 +1058,7 @@ static void core_free(liServer *srv, liPlugin *p) {
 	}
 	g_ptr_array_free(config->listen_masks, TRUE);
 	g_hash_table_destroy(config->listen_sockets);
+	g_hash_table_destroy(config->listen_reuseport_sockets);
 	config->listen_masks = NULL;
 
 	g_slice_free(liPluginCoreConfig, config);
@@ -972,9 +1137,11 @@ static gboolean core_init(liServer *srv, liPlugin *p) {
 
 	core_parse_init(srv, p);
 	config->listen_sockets = g_hash_table_new_full(li_hash_sockaddr, li_equal_sockaddr, NULL, _listen_socket_free);
+	config->listen_reuseport_sockets = g_hash_table_new_full(li_hash_sockaddr, li_equal_sockaddr, NULL, _listen_socket_free);
 	config->listen_masks = g_ptr_array_new();
 
 	li_angel_plugin_add_angel_cb(p, "listen", core_listen);
+	li_angel_plugin_add_angel_cb(p, "listen-reuseport", core_listen_reuseport);
 	li_angel_plugin_add_angel_cb(p, "reached-state", core_reached_state);
 	li_angel_plugin_add_angel_cb(p, "log-open-file", core_log_open_file);
 
@@ -9,6 +9,11 @@
 # include <crypt.h>
 #endif
 
+#if defined(__GNUC__) && defined(__SSE2__)
+# define URL_PATH_SCAN_SSE2 1
+# include <emmintrin.h>
+#endif
+
 /* for send/li_receive_fd */
 union fdmsg {
   struct cmsghdr h;
@@ -429,6 +434,139 @@ void li_path_simplify(GString *path) {
 	g_string_set_size(path, out - start);
 }
 
+/* number of bytes from s on which li_url_decode_path_simplify can copy as they are:
+ * stops at '%', '/', control characters (including the terminating zero) and DEL. end must be the
+ * terminating zero */
+static gsize url_path_plain_len(const char *s, const char *end) {
+	const char *p = s;
+	unsigned char c;
+
+#ifdef URL_PATH_SCAN_SSE2
+	const __m128i percent = _mm_set1_epi8('%'), slash = _mm_set1_epi8('/');
+	const __m128i ctl = _mm_set1_epi8(0x1f), del = _mm_set1_epi8(0x7f);
+
+	for ( ; end - p >= 16; p += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) p);
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, percent), _mm_cmpeq_epi8(v, slash));
+		int bits;
+
+		m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v), _mm_cmpeq_epi8(v, del)));
+		if (0 != (bits = _mm_movemask_epi8(m))) return (p - s) + __builtin_ctz(bits);
+	}
+#else
+	UNUSED(end);
+#endif
+
+	for ( ; ; p++) {
+		c = *p;
+		if (c == '%' || c == '/' || c < 32 || c == 127) break;
+	}
+
+	return p - s;
+}
+
+/* one step of the li_path_simplify loop for the character c (including the terminating zero) */
+#define PATH_SIMPLIFY_STEP(c) do { \
+	if (c == '/' || c == '\0') { \
+		gsize toklen = out - slash; \
+		if (toklen == 3 && pre == (('.' << 8) | '.')) { \
+			out = slash; \
+			if (out > start) { \
+				out--; \
+				while (out > start && *out != '/') { \
+					out--; \
+				} \
+			} \
+			if (c == '\0') \
+				out++; \
+		} else if (toklen == 1 || pre == (('/' << 8) | '.')) { \
+			out = slash; \
+			if (c == '\0') \
+				out++; \
+		} \
+		slash = out; \
+	} \
+	if (c != '\0') { \
+		pre = (pre << 8) | c; \
+		*(out++) = c; \
+	} \
+} while (0)
+
+/* Same result as li_url_decode() followed by li_path_simplify(), but in one pass: the decoded
+ * characters are fed directly into the simplify loop, and runs of characters neither of them
+ * changes are found (SSE2 if available) and copied as a block.
+ * The output never overtakes the input, so this works in-place too.
+ */
+void li_url_decode_path_simplify(GString *path) {
+	char *start, *src, *end, *out, *slash;
+	char c;
+	unsigned short pre;
+	gsize decoded; /* length li_url_decode would have written so far */
+
+	start = path->str;
+	if (start[0] != '/') {
+		/* leading spaces, missing leading slash or empty path */
+		li_url_decode(path);
+		li_path_simplify(path);
+		return;
+	}
+
+	end = start + path->len;
+	src = start + 1;
+	out = start + 1;
+	slash = start;
+	pre = '/';
+	decoded = 1;
+
+	for (;;) {
+		gsize n = url_path_plain_len(src, end);
+
+		if (n > 0) {
+			if (out != src) memmove(out, src, n);
+			src += n;
+			out += n;
+			decoded += n;
+			if (n > 1) pre = (pre << 8) | out[-2];
+			pre = (pre << 8) | out[-1];
+		}
+
+		c = *src;
+		if (c == '%') {
+			unsigned char *esc = (unsigned char*) src;
+			if (esc[1] && esc[2]) {
+				int a = hex2int(esc[1]), b = hex2int(esc[2]);
+				src += 3;
+				if (a != -1 && b != -1) {
+					unsigned char d = (a << 4) | b;
+					if (d < 32 || d == 127) d = '_';
+					c = d;
+					decoded++;
+					PATH_SIMPLIFY_STEP(c);
+				}
+			} else {
+				/* li_url_decode stops here without truncating, so li_path_simplify sees the undecoded
+				 * rest of the string after the decoded part */
+				for (src = start + decoded; '\0' != (c = *src); src++) {
+					PATH_SIMPLIFY_STEP(c);
+				}
+				break;
+			}
+		} else if (c == '\0') {
+			break;
+		} else {
+			if (c != '/') c = '_'; /* control character or DEL */
+			src++;
+			decoded++;
+			PATH_SIMPLIFY_STEP(c);
+		}
+	}
+
+	c = '\0';
+	PATH_SIMPLIFY_STEP(c);
+
+	g_string_set_size(path, out - start);
+}
+
 
 gboolean li_querystring_find(const GString *querystring, const gchar *key, const guint key_len, gchar **val, guint *val_len) {
 	gchar delim = '\0';
@@ -48,9 +48,13 @@
 #cmakedefine  HAVE_LIBCRYPTO
 #cmakedefine  OPENSSL_NO_KRB5
 #cmakedefine  HAVE_LIBSSL
+#cmakedefine  HAVE_LINUX_TLS_H
 
 #cmakedefine  HAVE_AIO_H
 
+/* io_uring */
+#cmakedefine  HAVE_LIBURING
+
 /* FAM */
 #cmakedefine  HAVE_FAM_H
 
@@ -71,9 +75,8 @@
 #cmakedefine  HAVE_LIBXML_H
 #cmakedefine  HAVE_LIBXML
 
-/* PCRE */
-/* We use pcre through glib */
-/* #cmakedefine  HAVE_PCRE_H */
+/* PCRE2, otherwise we use pcre through glib */
+#cmakedefine  HAVE_PCRE2
 /* #cmakedefine  HAVE_LIBPCRE */
 
 #cmakedefine  HAVE_POLL_H
@@ -96,6 +99,13 @@
 
 /* ZLIB */
 #cmakedefine  HAVE_ZLIB
+#cmakedefine  HAVE_ZLIB_NG
+
+/* brotli */
+#cmakedefine  HAVE_BROTLI
+
+/* zstd */
+#cmakedefine  HAVE_ZSTD
 
 /* GLIB */
 #cmakedefine  HAVE_GLIB_H
@@ -112,6 +122,9 @@
 #cmakedefine  HAVE_INOTIFY_INIT
 #cmakedefine  HAVE_SYS_INOTIFY_H
 
+/* xattr */
+#cmakedefine  HAVE_SYS_XATTR_H
+
 /* Types */
 #cmakedefine  HAVE_SOCKLEN_T
 #cmakedefine  SIZEOF_LONG ${SIZEOF_LONG}
@@ -150,6 +163,8 @@
 #cmakedefine  HAVE_SYSLOG
 #cmakedefine  HAVE_WRITEV
 #cmakedefine  HAVE_ACCEPT4
+/* struct stat has nanosecond timestamps (st_mtim, st_ctim) */
+#cmakedefine  HAVE_STRUCT_STAT_ST_MTIM
 
 /* libcrypt */
 #cmakedefine  HAVE_LIBCRYPT
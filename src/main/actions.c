@@ -185,7 +185,7 @@ static void action_stack_element_release(liServer *srv, liVRequest *vr, action_s
 				liActionRegexStackElement *arse = &g_array_index(rs, liActionRegexStackElement, rs->len - 1);
 				if (arse->string)
 					g_string_free(arse->string, TRUE);
-				g_match_info_free(arse->match_info);
+				li_regex_match_clear(&arse->match);
 				g_array_set_size(rs, rs->len - 1);
 			}
 		}
@@ -351,15 +351,11 @@ liHandlerResult li_action_execute(liVRequest *vr) {
 			action_stack_pop(srv, vr, as);
 			break;
 		case LI_ACTION_TSETTING:
-			vr->options[a->data.setting.ndx] = a->data.setting.value;
+			li_vrequest_set_option(vr, a->data.setting.ndx, a->data.setting.value);
 			action_stack_pop(srv, vr, as);
 			break;
 		case LI_ACTION_TSETTINGPTR:
-			if (vr->optionptrs[a->data.settingptr.ndx] != a->data.settingptr.value) {
-				g_atomic_int_inc(&a->data.settingptr.value->refcount);
-				li_release_optionptr(srv, vr->optionptrs[a->data.settingptr.ndx]);
-				vr->optionptrs[a->data.settingptr.ndx] = a->data.settingptr.value;
-			}
+			li_vrequest_set_optionptr(vr, a->data.settingptr.ndx, a->data.settingptr.value);
 			action_stack_pop(srv, vr, as);
 			break;
 		case LI_ACTION_TFUNCTION:
@@ -112,6 +112,77 @@ void li_angel_listen(liServer *srv, GString *str, liAngelListenCB cb, gpointer d
 	}
 }
 
+typedef struct angel_listen_reuseport_cb_ctx angel_listen_reuseport_cb_ctx;
+struct angel_listen_reuseport_cb_ctx {
+	liServer *srv;
+	GString *str;
+};
+
+static void li_angel_listen_reuseport_cb(gpointer pctx, gboolean timeout, GString *error, GString *data, GArray *fds) {
+	angel_listen_reuseport_cb_ctx ctx = * (angel_listen_reuseport_cb_ctx*) pctx;
+	liServer *srv = ctx.srv;
+	guint i;
+	UNUSED(data);
+
+	g_slice_free(angel_listen_reuseport_cb_ctx, pctx);
+
+	if (timeout) {
+		ERROR(srv, "listen failed: %s", "time out");
+		goto cleanup;
+	}
+
+	if (error->len > 0) {
+		WARNING(srv, "reuseport listen failed: %s, falling back to distributing connections from main worker", error->str);
+		li_angel_listen(srv, ctx.str, NULL, NULL);
+		goto cleanup;
+	}
+
+	if (fds && fds->len > 0) {
+		for (i = 0; i < fds->len; i++) {
+			li_server_listen_reuseport(srv, g_array_index(fds, int, i));
+		}
+		g_array_set_size(fds, 0);
+	} else {
+		ERROR(srv, "listen failed: %s", "received no filedescriptors");
+	}
+
+cleanup:
+	g_string_free(ctx.str, TRUE);
+}
+
+void li_angel_listen_reuseport(liServer *srv, GString *str) {
+	if (srv->acon) {
+		liAngelCall *acall = li_angel_call_new(&srv->main_worker->loop, li_angel_listen_reuseport_cb, 20.0);
+		angel_listen_reuseport_cb_ctx *ctx = g_slice_new0(angel_listen_reuseport_cb_ctx);
+		GString *data = g_string_sized_new(str->len + 8);
+		GError *err = NULL;
+
+		ctx->srv = srv;
+		ctx->str = g_string_new_len(GSTR_LEN(str));
+		acall->context = ctx;
+
+		g_string_printf(data, "%u %s", srv->worker_count, str->str);
+		if (!li_angel_send_call(srv->acon, CONST_STR_LEN("core"), CONST_STR_LEN("listen-reuseport"), acall, data, &err)) {
+			ERROR(srv, "couldn't send call: %s", err->message);
+			g_error_free(err);
+		}
+	} else {
+		GArray *fds = g_array_new(FALSE, FALSE, sizeof(int));
+		guint i;
+
+		if (li_angel_fake_listen_reuseport(srv, str, srv->worker_count, fds)) {
+			for (i = 0; i < fds->len; i++) {
+				li_server_listen_reuseport(srv, g_array_index(fds, int, i));
+			}
+		} else {
+			WARNING(srv, "reuseport listen('%s') failed, falling back to distributing connections from main worker", str->str);
+			li_angel_listen(srv, str, NULL, NULL);
+		}
+
+		g_array_free(fds, TRUE);
+	}
+}
+
 /* send log messages while startup to angel */
 void li_angel_log(liServer *srv, GString *str) {
 	li_angel_fake_log(srv, str);
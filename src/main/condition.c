@@ -31,13 +31,124 @@ static const liConditionValueType cond_value_hints[] = {
 };
 #endif
 
-/* uses tmpstr for temporary (and returned) strings */
-liHandlerResult li_condition_get_value(GString *tmpstr, liVRequest *vr, liConditionLValue *lvalue, liConditionValue *res, liConditionValueType prefer) {
-	liConInfo *coninfo = vr->coninfo;
+/* cached lvalues: header values (validated with the headers version) and one stat result for the physical path
+ * (validated by comparing the path), shared by phys.exists, phys.is_dir, phys.is_file and phys.size
+ */
+typedef struct {
+	liCondLValue type;  /* LI_COMP_REQUEST_HEADER, LI_COMP_RESPONSE_HEADER or LI_COMP_PHYSICAL_EXISTS */
+	GString *key;       /* header name or physical path */
+
+	guint version;
+	GString *value;
+
+	gboolean exists;
+	mode_t mode;
+	gint64 size;
+} condition_cache_entry;
+
+static condition_cache_entry* condition_cache_find(liVRequest *vr, liCondLValue type, GString *key) {
+	guint i;
+
+	if (NULL == vr->condition_cache) return NULL;
+
+	for (i = 0; i < vr->condition_cache->len; i++) {
+		condition_cache_entry *e = &g_array_index(vr->condition_cache, condition_cache_entry, i);
+		if (e->type == type && (NULL == key || g_string_equal(e->key, key))) return e;
+	}
+	return NULL;
+}
+
+static condition_cache_entry* condition_cache_add(liVRequest *vr, liCondLValue type, GString *key) {
+	condition_cache_entry e;
+
+	if (NULL == vr->condition_cache) {
+		vr->condition_cache = g_array_sized_new(FALSE, FALSE, sizeof(condition_cache_entry), 4);
+	}
+
+	memset(&e, 0, sizeof(e));
+	e.type = type;
+	e.key = g_string_new_len(GSTR_LEN(key));
+	e.value = g_string_sized_new(0);
+	g_array_append_val(vr->condition_cache, e);
+
+	return &g_array_index(vr->condition_cache, condition_cache_entry, vr->condition_cache->len - 1);
+}
+
+void li_condition_cache_reset(liVRequest *vr) {
+	guint i;
+
+	if (NULL == vr->condition_cache) return;
+
+	for (i = 0; i < vr->condition_cache->len; i++) {
+		condition_cache_entry *e = &g_array_index(vr->condition_cache, condition_cache_entry, i);
+		g_string_free(e->key, TRUE);
+		g_string_free(e->value, TRUE);
+	}
+	g_array_set_size(vr->condition_cache, 0);
+}
+
+void li_condition_cache_free(liVRequest *vr) {
+	if (NULL == vr->condition_cache) return;
+
+	li_condition_cache_reset(vr);
+	g_array_free(vr->condition_cache, TRUE);
+	vr->condition_cache = NULL;
+}
+
+static const gchar* condition_cache_header(liVRequest *vr, liHttpHeaders *headers, liConditionLValue *lvalue) {
+	condition_cache_entry *e = condition_cache_find(vr, lvalue->type, lvalue->key);
+
+	if (NULL == e) {
+		e = condition_cache_add(vr, lvalue->type, lvalue->key);
+	} else if (e->version == headers->version) {
+		vr->wrk->stats.condition_cache_hits++;
+		return e->value->str;
+	}
+
+	li_http_header_get_all(e->value, headers, GSTR_LEN(lvalue->key));
+	e->version = headers->version;
+	return e->value->str;
+}
+
+/* vr->physical.path must not be empty */
+static liHandlerResult condition_cache_stat(liVRequest *vr, condition_cache_entry **pe) {
+	condition_cache_entry *e = condition_cache_find(vr, LI_COMP_PHYSICAL_EXISTS, NULL);
 	liHandlerResult r;
 	struct stat st;
 	int err;
 
+	if (NULL != e && g_string_equal(e->key, vr->physical.path)) {
+		vr->wrk->stats.condition_cache_hits++;
+		*pe = e;
+		return LI_HANDLER_GO_ON;
+	}
+
+	r = li_stat_cache_get(vr, vr->physical.path, &st, &err, NULL);
+	if (r == LI_HANDLER_WAIT_FOR_EVENT) return r;
+
+	if (NULL == e) {
+		e = condition_cache_add(vr, LI_COMP_PHYSICAL_EXISTS, vr->physical.path);
+	} else {
+		g_string_truncate(e->key, 0);
+		g_string_append_len(e->key, GSTR_LEN(vr->physical.path));
+	}
+
+	/* not found: doesn't exist, size "-1" */
+	e->exists = (r == LI_HANDLER_GO_ON);
+	e->mode = e->exists ? st.st_mode : 0;
+	e->size = e->exists ? (gint64) st.st_size : -1;
+
+	*pe = e;
+	return LI_HANDLER_GO_ON;
+}
+
+/* returned strings point into the vrequest or the condition cache; tmpstr isn't needed anymore */
+liHandlerResult li_condition_get_value(GString *tmpstr, liVRequest *vr, liConditionLValue *lvalue, liConditionValue *res, liConditionValueType prefer) {
+	liConInfo *coninfo = vr->coninfo;
+	condition_cache_entry *ce;
+	liHandlerResult r;
+	UNUSED(tmpstr);
+
 	res->match_type = LI_COND_VALUE_HINT_ANY;
 	res->data.str = "";
 
@@ -137,15 +248,15 @@ liHandlerResult li_condition_get_value(GString *tmpstr, liVRequest *vr, liCondit
 			break;
 		}
 
-		r = li_stat_cache_get(vr, vr->physical.path, &st, &err, NULL);
-		if (r == LI_HANDLER_WAIT_FOR_EVENT) return r;
+		r = condition_cache_stat(vr, &ce);
+		if (r != LI_HANDLER_GO_ON) return r;
 
 		/* not found, return FALSE */
-		if (r != LI_HANDLER_GO_ON) break;
+		if (!ce->exists) break;
 		if (lvalue->type == LI_COMP_PHYSICAL_ISFILE) {
-			res->data.bool = S_ISREG(st.st_mode);
+			res->data.bool = S_ISREG(ce->mode);
 		} else if (lvalue->type == LI_COMP_PHYSICAL_ISDIR) {
-			res->data.bool = S_ISDIR(st.st_mode);
+			res->data.bool = S_ISDIR(ce->mode);
 		} else {
 			res->data.bool = TRUE;
 		}
@@ -157,12 +268,10 @@ liHandlerResult li_condition_get_value(GString *tmpstr, liVRequest *vr, liCondit
 			break;
 		}
 
-		r = li_stat_cache_get(vr, vr->physical.path, &st, &err, NULL);
-		if (r == LI_HANDLER_WAIT_FOR_EVENT) return r;
+		r = condition_cache_stat(vr, &ce);
+		if (r != LI_HANDLER_GO_ON) return r;
 
-		if (r == LI_HANDLER_GO_ON) { /* not found -> size "-1" */
-			res->data.number = (gint64) st.st_size;
-		}
+		res->data.number = ce->size;
 		break;
 	case LI_COMP_PHYSICAL_DOCROOT:
 		res->match_type = LI_COND_VALUE_HINT_STRING;
@@ -179,14 +288,12 @@ liHandlerResult li_condition_get_value(GString *tmpstr, liVRequest *vr, liCondit
 		break;
 	case LI_COMP_REQUEST_HEADER:
 		res->match_type = LI_COND_VALUE_HINT_STRING;
-		li_http_header_get_all(tmpstr, vr->request.headers, GSTR_LEN(lvalue->key));
-		res->data.str = tmpstr->str;
+		res->data.str = condition_cache_header(vr, vr->request.headers, lvalue);
 		break;
 	case LI_COMP_RESPONSE_HEADER:
 		LI_VREQUEST_WAIT_FOR_RESPONSE_HEADERS(vr);
 		res->match_type = LI_COND_VALUE_HINT_STRING;
-		li_http_header_get_all(tmpstr, vr->response.headers, GSTR_LEN(lvalue->key));
-		res->data.str = tmpstr->str;
+		res->data.str = condition_cache_header(vr, vr->response.headers, lvalue);
 		break;
 	case LI_COMP_ENVIRONMENT:
 		res->match_type = LI_COND_VALUE_HINT_STRING;
@@ -307,12 +414,12 @@ static liCondition* cond_new_string(liCompOperator op, liConditionLValue *lvalue
 /* only MATCH and NOMATCH */
 static liCondition* cond_new_match(liServer *srv, liCompOperator op, liConditionLValue *lvalue, GString *str) {
 	liCondition *c;
-	GRegex *regex;
+	liRegex *regex;
 	GError *err = NULL;
 
-	regex = g_regex_new(str->str, G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, &err);
+	regex = li_regex_new(str->str, &err);
 
-	if (!regex || err) {
+	if (NULL == regex) {
 		ERROR(srv, "failed to compile regex \"%s\": %s", str->str, err->message);
 		g_error_free(err);
 		return NULL;
@@ -418,7 +525,7 @@ static void condition_free(liCondition *c) {
 		g_string_free(c->rvalue.string, TRUE);
 		break;
 	case LI_COND_VALUE_REGEXP:
-		g_regex_unref(c->rvalue.regex);
+		li_regex_free(c->rvalue.regex);
 		break;
 	case LI_COND_VALUE_SOCKET_IPV4:
 	case LI_COND_VALUE_SOCKET_IPV6:
@@ -646,25 +753,19 @@ static liHandlerResult li_condition_check_eval_string(liVRequest *vr, liConditio
 		*res = !g_str_has_suffix(val, cond->rvalue.string->str);
 		break;
 	case LI_CONFIG_COND_MATCH:
-		arse.match_info = NULL;
-		arse.string = g_string_new(val); /* we have to copy the value, as match-info references it */
-		*res = g_regex_match(cond->rvalue.regex, arse.string->str, 0, &arse.match_info);
-		if (*res) {
-			g_array_append_val(vr->action_stack.regex_stack, arse);
-		} else {
-			g_match_info_free(arse.match_info);
-			g_string_free(arse.string, TRUE);
-		}
-		break;
 	case LI_CONFIG_COND_NOMATCH:
-		arse.match_info = NULL;
-		arse.string = g_string_new(val); /* we have to copy the value, as match-info references it */
-		*res = !g_regex_match(cond->rvalue.regex, arse.string->str, 0, &arse.match_info);
-		if (*res) {
-			g_match_info_free(arse.match_info);
-			g_string_free(arse.string, TRUE);
-		} else {
-			g_array_append_val(vr->action_stack.regex_stack, arse);
+		{
+			liRegexMatch match;
+			gboolean matched = li_regex_match(cond->rvalue.regex, vr->wrk->regex_match_data, val, strlen(val), &match);
+
+			if (matched) {
+				/* the captures are used by the nested actions: copy the value (it is in tmp_str) and the offsets */
+				arse.string = g_string_new(val);
+				li_regex_match_copy(&arse.match, &match, arse.string->str);
+				g_array_append_val(vr->action_stack.regex_stack, arse);
+			}
+
+			*res = (LI_CONFIG_COND_MATCH == cond->op) ? matched : !matched;
 		}
 		break;
 	case LI_CONFIG_COND_IP:
@@ -0,0 +1,363 @@
+
+#include <lighttpd/base.h>
+
+/* Dispatch tables for if/else-if chains
+ *
+ * A chain "if X == "a" { A } else if X =^ "b" { B } else if X =$ "c" { C } ... else { E }" evaluates its conditions
+ * one by one, although they all test the same value. li_action_compile_dispatch replaces such chains (with at least
+ * DISPATCH_MIN_CONDITIONS conditions) by a function action which gets the value once and looks it up:
+ *  - "==" in a hash table
+ *  - "=^" in a radix tree (longest matching prefix)
+ *  - "=$" in a radix tree of the reversed suffixes
+ *  - "=/" (req.localip and req.remoteip only) in radix trees of the networks
+ * Every entry stores the position of its condition in the chain; the prefix trees store the smallest position of all
+ * prefixes of an entry, so the longest match gives the first matching condition in the chain. The first match over all
+ * tables is the same action the linear chain would have entered.
+ */
+
+#define DISPATCH_MIN_CONDITIONS 4
+
+typedef struct condition_dispatch condition_dispatch;
+struct condition_dispatch {
+	liConditionLValue *lvalue;
+	gboolean ip;
+
+	GHashTable *equal;            /* gchar* -> position + 1 */
+	liRadixTree *prefix, *suffix; /* (reversed) string -> smallest position + 1 */
+	liRadixTree *ipv4, *ipv6;     /* network -> smallest position + 1 */
+
+	GPtrArray *targets;           /* liAction* (or NULL) for each position */
+	liAction *target_else;
+};
+
+typedef struct dispatch_key dispatch_key;
+struct dispatch_key {
+	const guint8 *key;
+	guint32 bits;
+	guint pos;
+};
+
+static gboolean dispatch_same_lvalue(liConditionLValue *a, liConditionLValue *b) {
+	if (a->type != b->type) return FALSE;
+	if (NULL == a->key || NULL == b->key) return a->key == b->key;
+	return g_string_equal(a->key, b->key);
+}
+
+static gboolean dispatch_ipv4_prefixlen(guint32 networkmask, guint32 *prefixlen) {
+	guint32 mask = ntohl(networkmask), len = 0;
+
+	while (len < 32 && (mask & (0x80000000u >> len))) len++;
+	/* only contiguous network masks */
+	if (len < 32 && 0 != (mask << len)) return FALSE;
+
+	*prefixlen = len;
+	return TRUE;
+}
+
+/* whether cond can be looked up in a dispatch table; ip selects the kind of table */
+static gboolean dispatch_condition_supported(liCondition *cond, gboolean ip) {
+	guint32 prefixlen;
+
+	if (ip) {
+		if (LI_CONFIG_COND_IP != cond->op) return FALSE;
+		if (LI_COMP_REQUEST_LOCALIP != cond->lvalue->type && LI_COMP_REQUEST_REMOTEIP != cond->lvalue->type) return FALSE;
+		switch (cond->rvalue.type) {
+		case LI_COND_VALUE_SOCKET_IPV4:
+			return dispatch_ipv4_prefixlen(cond->rvalue.ipv4.networkmask, &prefixlen);
+		case LI_COND_VALUE_SOCKET_IPV6:
+			return cond->rvalue.ipv6.network <= 128;
+		default:
+			return FALSE;
+		}
+	}
+
+	if (LI_COND_VALUE_STRING != cond->rvalue.type) return FALSE;
+	switch (cond->op) {
+	case LI_CONFIG_COND_EQ:
+	case LI_CONFIG_COND_PREFIX:
+	case LI_CONFIG_COND_SUFFIX:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/* the else branch of a condition in a chain: "else if" is parsed as a list with only the condition */
+static liAction* dispatch_next(liAction *a) {
+	liAction *next = a->data.condition.target_else;
+
+	if (NULL != next && LI_ACTION_TLIST == next->type && 1 == next->data.list->len) {
+		next = g_array_index(next->data.list, liAction*, 0);
+	}
+
+	return next;
+}
+
+static gint dispatch_key_cmp(gconstpointer a, gconstpointer b) {
+	const dispatch_key *ka = a, *kb = b;
+
+	if (ka->bits != kb->bits) return ka->bits < kb->bits ? -1 : 1;
+	if (ka->pos != kb->pos) return ka->pos < kb->pos ? -1 : 1;
+	return 0;
+}
+
+/* inserts the keys from the shortest to the longest, every key gets the smallest position of all its prefixes */
+static liRadixTree* dispatch_build_tree(GArray *keys) {
+	liRadixTree *tree;
+	guint i;
+
+	if (0 == keys->len) return NULL;
+
+	tree = li_radixtree_new();
+	g_array_sort(keys, dispatch_key_cmp);
+
+	for (i = 0; i < keys->len; i++) {
+		dispatch_key *k = &g_array_index(keys, dispatch_key, i);
+		guint pos = k->pos + 1, prefix_pos;
+
+		if (NULL != li_radixtree_lookup_exact(tree, k->key, k->bits)) continue; /* duplicate, first one wins */
+
+		prefix_pos = GPOINTER_TO_UINT(li_radixtree_lookup(tree, k->key, k->bits));
+		if (0 != prefix_pos && prefix_pos < pos) pos = prefix_pos;
+
+		li_radixtree_insert(tree, k->key, k->bits, GUINT_TO_POINTER(pos));
+	}
+
+	return tree;
+}
+
+static void dispatch_free(liServer *srv, gpointer param) {
+	condition_dispatch *cd = param;
+	guint i;
+
+	li_condition_lvalue_release(cd->lvalue);
+
+	if (NULL != cd->equal) g_hash_table_destroy(cd->equal);
+	if (NULL != cd->prefix) li_radixtree_free(cd->prefix, NULL, NULL);
+	if (NULL != cd->suffix) li_radixtree_free(cd->suffix, NULL, NULL);
+	if (NULL != cd->ipv4) li_radixtree_free(cd->ipv4, NULL, NULL);
+	if (NULL != cd->ipv6) li_radixtree_free(cd->ipv6, NULL, NULL);
+
+	for (i = 0; i < cd->targets->len; i++) {
+		li_action_release(srv, g_ptr_array_index(cd->targets, i));
+	}
+	g_ptr_array_free(cd->targets, TRUE);
+	li_action_release(srv, cd->target_else);
+
+	g_slice_free(condition_dispatch, cd);
+}
+
+static guint dispatch_lookup_string(condition_dispatch *cd, const gchar *val) {
+	gsize len = strlen(val);
+	guint pos = G_MAXUINT, p;
+
+	if (NULL != cd->equal) {
+		p = GPOINTER_TO_UINT(g_hash_table_lookup(cd->equal, val));
+		if (0 != p && p - 1 < pos) pos = p - 1;
+	}
+
+	if (NULL != cd->prefix) {
+		p = GPOINTER_TO_UINT(li_radixtree_lookup(cd->prefix, val, len * 8));
+		if (0 != p && p - 1 < pos) pos = p - 1;
+	}
+
+	if (NULL != cd->suffix) {
+		gchar buf[256], *rev = (len <= sizeof(buf)) ? buf : g_malloc(len);
+		gsize i;
+
+		for (i = 0; i < len; i++) rev[i] = val[len - 1 - i];
+		p = GPOINTER_TO_UINT(li_radixtree_lookup(cd->suffix, rev, len * 8));
+		if (0 != p && p - 1 < pos) pos = p - 1;
+
+		if (rev != buf) g_free(rev);
+	}
+
+	return pos;
+}
+
+static guint dispatch_lookup_ip(condition_dispatch *cd, liSockAddr *addr) {
+	guint p = 0;
+
+	switch (addr->plain.sa_family) {
+	case AF_INET:
+		if (NULL != cd->ipv4) p = GPOINTER_TO_UINT(li_radixtree_lookup(cd->ipv4, &addr->ipv4.sin_addr.s_addr, 32));
+		break;
+#ifdef HAVE_IPV6
+	case AF_INET6:
+		if (NULL != cd->ipv6) p = GPOINTER_TO_UINT(li_radixtree_lookup(cd->ipv6, addr->ipv6.sin6_addr.s6_addr, 128));
+		break;
+#endif
+	}
+
+	return (0 != p) ? p - 1 : G_MAXUINT;
+}
+
+static liHandlerResult dispatch_handle(liVRequest *vr, gpointer param, gpointer *context) {
+	condition_dispatch *cd = param;
+	liConditionValue match_val;
+	liHandlerResult res;
+	liAction *target;
+	guint pos;
+	UNUSED(context);
+
+	res = li_condition_get_value(vr->wrk->tmp_str, vr, cd->lvalue, &match_val, cd->ip ? LI_COND_VALUE_HINT_SOCKADDR : LI_COND_VALUE_HINT_STRING);
+	if (LI_HANDLER_GO_ON != res) return res;
+
+	if (cd->ip) {
+		if (LI_COND_VALUE_HINT_SOCKADDR != match_val.match_type) {
+			VR_ERROR(vr, "couldn't get ip value for '%s'", li_cond_lvalue_to_string(cd->lvalue->type));
+			return LI_HANDLER_ERROR;
+		}
+		pos = dispatch_lookup_ip(cd, match_val.data.addr.addr);
+	} else {
+		pos = dispatch_lookup_string(cd, li_condition_value_to_string(vr->wrk->tmp_str, &match_val));
+	}
+
+	target = (pos < cd->targets->len) ? g_ptr_array_index(cd->targets, pos) : cd->target_else;
+	if (NULL != target) li_action_enter(vr, target);
+
+	return LI_HANDLER_GO_ON;
+}
+
+/* a is a condition action; returns NULL if it doesn't start a long enough chain */
+static condition_dispatch* dispatch_build(liAction *a) {
+	liConditionLValue *lvalue = a->data.condition.cond->lvalue;
+	gboolean ip = (LI_CONFIG_COND_IP == a->data.condition.cond->op);
+	condition_dispatch *cd;
+	GArray *prefix_keys, *suffix_keys, *ipv4_keys, *ipv6_keys;
+	GPtrArray *reversed;
+	liAction *cur;
+	guint n = 0, i;
+
+	for (cur = a; NULL != cur && LI_ACTION_TCONDITION == cur->type; cur = dispatch_next(cur), n++) {
+		liCondition *cond = cur->data.condition.cond;
+		if (!dispatch_same_lvalue(lvalue, cond->lvalue) || !dispatch_condition_supported(cond, ip)) break;
+	}
+	if (n < DISPATCH_MIN_CONDITIONS) return NULL;
+
+	cd = g_slice_new0(condition_dispatch);
+	cd->lvalue = lvalue;
+	li_condition_lvalue_acquire(lvalue);
+	cd->ip = ip;
+	cd->targets = g_ptr_array_sized_new(n);
+
+	prefix_keys = g_array_new(FALSE, FALSE, sizeof(dispatch_key));
+	suffix_keys = g_array_new(FALSE, FALSE, sizeof(dispatch_key));
+	ipv4_keys = g_array_new(FALSE, FALSE, sizeof(dispatch_key));
+	ipv6_keys = g_array_new(FALSE, FALSE, sizeof(dispatch_key));
+	reversed = g_ptr_array_new();
+
+	for (cur = a, i = 0; i < n; cur = dispatch_next(cur), i++) {
+		liCondition *cond = cur->data.condition.cond;
+		const gchar *str = (LI_COND_VALUE_STRING == cond->rvalue.type) ? cond->rvalue.string->str : NULL;
+		dispatch_key k;
+
+		k.pos = i;
+
+		switch (cond->op) {
+		case LI_CONFIG_COND_EQ:
+			if (NULL == cd->equal) cd->equal = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+			if (NULL == g_hash_table_lookup(cd->equal, str)) {
+				g_hash_table_insert(cd->equal, g_strdup(str), GUINT_TO_POINTER(i + 1));
+			}
+			break;
+		case LI_CONFIG_COND_PREFIX:
+			k.key = (const guint8*) str;
+			k.bits = strlen(str) * 8;
+			g_array_append_val(prefix_keys, k);
+			break;
+		case LI_CONFIG_COND_SUFFIX:
+			k.key = (const guint8*) g_strreverse(g_strdup(str));
+			k.bits = strlen(str) * 8;
+			g_ptr_array_add(reversed, (gpointer) k.key);
+			g_array_append_val(suffix_keys, k);
+			break;
+		case LI_CONFIG_COND_IP:
+			if (LI_COND_VALUE_SOCKET_IPV4 == cond->rvalue.type) {
+				k.key = (const guint8*) &cond->rvalue.ipv4.addr;
+				dispatch_ipv4_prefixlen(cond->rvalue.ipv4.networkmask, &k.bits);
+				g_array_append_val(ipv4_keys, k);
+			} else {
+				k.key = cond->rvalue.ipv6.addr;
+				k.bits = cond->rvalue.ipv6.network;
+				g_array_append_val(ipv6_keys, k);
+			}
+			break;
+		default:
+			break;
+		}
+
+		if (NULL != cur->data.condition.target) li_action_acquire(cur->data.condition.target);
+		g_ptr_array_add(cd->targets, cur->data.condition.target);
+
+		if (i == n - 1) {
+			cd->target_else = cur->data.condition.target_else;
+			if (NULL != cd->target_else) li_action_acquire(cd->target_else);
+		}
+	}
+
+	cd->prefix = dispatch_build_tree(prefix_keys);
+	cd->suffix = dispatch_build_tree(suffix_keys);
+	cd->ipv4 = dispatch_build_tree(ipv4_keys);
+	cd->ipv6 = dispatch_build_tree(ipv6_keys);
+
+	g_array_free(prefix_keys, TRUE);
+	g_array_free(suffix_keys, TRUE);
+	g_array_free(ipv4_keys, TRUE);
+	g_array_free(ipv6_keys, TRUE);
+	for (i = 0; i < reversed->len; i++) g_free(g_ptr_array_index(reversed, i));
+	g_ptr_array_free(reversed, TRUE);
+
+	return cd;
+}
+
+static void dispatch_compile(liServer *srv, liAction *a, GHashTable *visited) {
+	condition_dispatch *cd;
+	guint i;
+
+	if (NULL == a || NULL != g_hash_table_lookup(visited, a)) return;
+	g_hash_table_insert(visited, a, a);
+
+	switch (a->type) {
+	case LI_ACTION_TLIST:
+		for (i = 0; i < a->data.list->len; i++) {
+			dispatch_compile(srv, g_array_index(a->data.list, liAction*, i), visited);
+		}
+		break;
+	case LI_ACTION_TCONDITION:
+		if (NULL != (cd = dispatch_build(a))) {
+			liCondition *cond = a->data.condition.cond;
+			liAction *target = a->data.condition.target, *target_else = a->data.condition.target_else;
+
+			/* replace in place, the action may be referenced from other places too */
+			a->type = LI_ACTION_TFUNCTION;
+			a->data.function.func = dispatch_handle;
+			a->data.function.cleanup = NULL;
+			a->data.function.free = dispatch_free;
+			a->data.function.param = cd;
+
+			li_condition_release(srv, cond);
+			li_action_release(srv, target);
+			li_action_release(srv, target_else);
+
+			for (i = 0; i < cd->targets->len; i++) {
+				dispatch_compile(srv, g_ptr_array_index(cd->targets, i), visited);
+			}
+			dispatch_compile(srv, cd->target_else, visited);
+		} else {
+			dispatch_compile(srv, a->data.condition.target, visited);
+			dispatch_compile(srv, a->data.condition.target_else, visited);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void li_action_compile_dispatch(liServer *srv, liAction *a) {
+	GHashTable *visited = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	dispatch_compile(srv, a, visited);
+
+	g_hash_table_destroy(visited);
+}
@@ -8,16 +8,16 @@ liTristate li_http_response_handle_cachable_etag(liVRequest *vr, GString *etag)
 	gchar *setag = NULL;
 
 	if (!etag) {
-		liHttpHeader *hetag = li_http_header_lookup(vr->response.headers, CONST_STR_LEN("etag"));
+		liHttpHeader *hetag = li_http_header_lookup_id(vr->response.headers, LI_HTTP_HEADER_ETAG);
 		if (hetag) setag = hetag->data->str + hetag->keylen + 2;
 	} else {
 		setag = etag->str;
 	}
 
 	for (
-			l = li_http_header_find_first(vr->request.headers, CONST_STR_LEN("If-None-Match"));
+			l = li_http_header_find_first_id(vr->request.headers, LI_HTTP_HEADER_IF_NONE_MATCH);
 			l;
-			l = li_http_header_find_next(l, CONST_STR_LEN("If-None-Match"))) {
+			l = li_http_header_find_next_id(l, LI_HTTP_HEADER_IF_NONE_MATCH)) {
 		liHttpHeader *h = (liHttpHeader*) l->data;
 		res = LI_TRIFALSE; /* if the header was given at least once, we need a match */
 		if (!setag) return res;
@@ -36,15 +36,15 @@ liTristate li_http_response_handle_cachable_modified(liVRequest *vr, GString *la
 	char *semicolon;
 
 	if (!last_modified) {
-		h = li_http_header_lookup(vr->response.headers, CONST_STR_LEN("last-modified"));
+		h = li_http_header_lookup_id(vr->response.headers, LI_HTTP_HEADER_LAST_MODIFIED);
 		if (h) slm = h->data->str + h->keylen + 2;
 	} else {
 		slm = last_modified->str;
 	}
 
-	l = li_http_header_find_first(vr->request.headers, CONST_STR_LEN("If-Modified-Since"));
+	l = li_http_header_find_first_id(vr->request.headers, LI_HTTP_HEADER_IF_MODIFIED_SINCE);
 	if (!l) return LI_TRIMAYBE; /* no if-modified-since header */
-	if (li_http_header_find_next(l, CONST_STR_LEN("If-Modified-Since"))) {
+	if (li_http_header_find_next_id(l, LI_HTTP_HEADER_IF_MODIFIED_SINCE)) {
 		return LI_TRIFALSE; /* we only check one if-modified-since header */
 	}
 	h = (liHttpHeader*) l->data;
@@ -128,37 +128,44 @@ void li_etag_mutate(GString *mut, GString *etag) {
 	g_string_append_len(mut, CONST_STR_LEN("\""));
 }
 
-void li_etag_set_header(liVRequest *vr, struct stat *st, gboolean *cachable) {
-	guint flags = CORE_OPTION(LI_CORE_OPTION_ETAG_FLAGS).number;
-	GString *tmp_str = vr->wrk->tmp_str;
+void li_etag_create(GString *etag, struct stat *st, guint flags) {
+	g_string_truncate(etag, 0);
+
+	if (flags & LI_ETAG_USE_INODE) {
+		li_string_append_int(etag, st->st_ino);
+	}
+
+	if (flags & LI_ETAG_USE_SIZE) {
+		if (etag->len != 0) g_string_append_len(etag, CONST_STR_LEN("-"));
+		li_string_append_int(etag, st->st_size);
+	}
+
+	if (flags & LI_ETAG_USE_MTIME) {
+		if (etag->len != 0) g_string_append_len(etag, CONST_STR_LEN("-"));
+		li_string_append_int(etag, st->st_mtime);
+	}
+
+	li_etag_mutate(etag, etag);
+}
+
+gsize li_etag_last_modified(gchar *buf, gsize size, time_t mtime) {
 	struct tm tm;
+
+	if (!gmtime_r(&mtime, &tm)) return 0;
+
+	return strftime(buf, size, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+}
+
+void li_etag_set_header_values(liVRequest *vr, GString *etag, GString *last_modified, gboolean *cachable) {
 	liTristate c_able = cachable ? LI_TRIMAYBE : LI_TRIFALSE;
 
-	if (0 == flags) {
+	if (NULL == etag) {
 		li_http_header_remove(vr->response.headers, CONST_STR_LEN("etag"));
 	} else {
-		g_string_truncate(tmp_str, 0);
-	
-		if (flags & LI_ETAG_USE_INODE) {
-			li_string_append_int(tmp_str, st->st_ino);
-		}
-		
-		if (flags & LI_ETAG_USE_SIZE) {
-			if (tmp_str->len != 0) g_string_append_len(tmp_str, CONST_STR_LEN("-"));
-			li_string_append_int(tmp_str, st->st_size);
-		}
-		
-		if (flags & LI_ETAG_USE_MTIME) {
-			if (tmp_str->len != 0) g_string_append_len(tmp_str, CONST_STR_LEN("-"));
-			li_string_append_int(tmp_str, st->st_mtime);
-		}
-	
-		li_etag_mutate(tmp_str, tmp_str);
-	
-		li_http_header_overwrite(vr->response.headers, CONST_STR_LEN("ETag"), GSTR_LEN(tmp_str));
+		li_http_header_overwrite(vr->response.headers, CONST_STR_LEN("ETag"), GSTR_LEN(etag));
 
 		if (c_able != LI_TRIFALSE) {
-			switch (li_http_response_handle_cachable_etag(vr, tmp_str)) {
+			switch (li_http_response_handle_cachable_etag(vr, etag)) {
 			case LI_TRIFALSE: c_able = LI_TRIFALSE; break;
 			case LI_TRIMAYBE: break;
 			case LI_TRITRUE : c_able = LI_TRITRUE; break;
@@ -166,14 +173,11 @@ void li_etag_set_header(liVRequest *vr, struct stat *st, gboolean *cachable) {
 		}
 	}
 
-	if (gmtime_r(&st->st_mtime, &tm)) {
-		g_string_set_size(tmp_str, 256);
-		g_string_set_size(tmp_str, strftime(tmp_str->str, tmp_str->len-1,
-			"%a, %d %b %Y %H:%M:%S GMT", &tm));
-		li_http_header_overwrite(vr->response.headers, CONST_STR_LEN("Last-Modified"), GSTR_LEN(tmp_str));
+	if (NULL != last_modified) {
+		li_http_header_overwrite(vr->response.headers, CONST_STR_LEN("Last-Modified"), GSTR_LEN(last_modified));
 
 		if (c_able != LI_TRIFALSE) {
-			switch (li_http_response_handle_cachable_modified(vr, tmp_str)) {
+			switch (li_http_response_handle_cachable_modified(vr, last_modified)) {
 			case LI_TRIFALSE: c_able = LI_TRIFALSE; break;
 			case LI_TRIMAYBE: break;
 			case LI_TRITRUE : c_able = LI_TRITRUE; break;
@@ -183,3 +187,20 @@ void li_etag_set_header(liVRequest *vr, struct stat *st, gboolean *cachable) {
 
 	if (cachable) *cachable = (c_able == LI_TRITRUE);
 }
+
+void li_etag_set_header(liVRequest *vr, struct stat *st, gboolean *cachable) {
+	guint flags = CORE_OPTION(LI_CORE_OPTION_ETAG_FLAGS).number;
+	GString *etag = NULL, last_modified;
+	gchar buf[64];
+	gsize len;
+
+	if (0 != flags) {
+		etag = vr->wrk->tmp_str;
+		li_etag_create(etag, st, flags);
+	}
+
+	len = li_etag_last_modified(buf, sizeof(buf), st->st_mtime);
+	last_modified = li_const_gstring(buf, len);
+
+	li_etag_set_header_values(vr, etag, 0 != len ? &last_modified : NULL, cachable);
+}
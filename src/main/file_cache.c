@@ -0,0 +1,170 @@
+
+#include <lighttpd/base.h>
+
+typedef struct fileCacheEntry fileCacheEntry;
+struct fileCacheEntry {
+	GString *path;
+	ino_t ino;
+	off_t size;
+	struct timespec mtime, ctime;
+
+	liBuffer *buf;
+	GList lru_link;
+};
+
+static void file_cache_entry_free(fileCacheEntry *fce) {
+	g_string_free(fce->path, TRUE);
+	li_buffer_release(fce->buf);
+	g_slice_free(fileCacheEntry, fce);
+}
+
+/* needs lock */
+static void file_cache_remove(liFileCache *fc, fileCacheEntry *fce) {
+	g_queue_unlink(&fc->lru, &fce->lru_link);
+	g_hash_table_remove(fc->entries, fce->path);
+	fc->size -= fce->size;
+	file_cache_entry_free(fce);
+}
+
+/* with nanoseconds if available: a rewrite of the same size within one second must not match */
+static void file_cache_stat_times(struct stat *st, struct timespec *mtime, struct timespec *ctime) {
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	*mtime = st->st_mtim;
+	*ctime = st->st_ctim;
+#else
+	mtime->tv_sec = st->st_mtime;
+	mtime->tv_nsec = 0;
+	ctime->tv_sec = st->st_ctime;
+	ctime->tv_nsec = 0;
+#endif
+}
+
+static gboolean file_cache_entry_valid(fileCacheEntry *fce, struct stat *st) {
+	struct timespec mtime, ctime;
+
+	if (fce->ino != st->st_ino || fce->size != st->st_size) return FALSE;
+
+	file_cache_stat_times(st, &mtime, &ctime);
+	return fce->mtime.tv_sec == mtime.tv_sec && fce->mtime.tv_nsec == mtime.tv_nsec
+		&& fce->ctime.tv_sec == ctime.tv_sec && fce->ctime.tv_nsec == ctime.tv_nsec;
+}
+
+liFileCache* li_file_cache_new(gsize max_file_size, gsize max_size) {
+	liFileCache *fc = g_slice_new0(liFileCache);
+
+	fc->mutex = g_mutex_new();
+	fc->entries = g_hash_table_new((GHashFunc) g_string_hash, (GEqualFunc) g_string_equal);
+	g_queue_init(&fc->lru);
+	fc->max_file_size = max_file_size;
+	fc->max_size = max_size;
+
+	return fc;
+}
+
+void li_file_cache_free(liFileCache *fc) {
+	GList *link;
+
+	if (NULL == fc) return;
+
+	while (NULL != (link = fc->lru.head)) {
+		file_cache_remove(fc, link->data);
+	}
+
+	g_hash_table_destroy(fc->entries);
+	g_mutex_free(fc->mutex);
+	g_slice_free(liFileCache, fc);
+}
+
+liBuffer* li_file_cache_get(liFileCache *fc, GString *path, struct stat *st) {
+	fileCacheEntry *fce;
+	liBuffer *buf = NULL;
+
+	g_mutex_lock(fc->mutex);
+
+	if (NULL != (fce = g_hash_table_lookup(fc->entries, path))) {
+		if (file_cache_entry_valid(fce, st)) {
+			/* move to front */
+			g_queue_unlink(&fc->lru, &fce->lru_link);
+			g_queue_push_head_link(&fc->lru, &fce->lru_link);
+
+			buf = fce->buf;
+			li_buffer_acquire(buf);
+		} else {
+			/* file changed */
+			file_cache_remove(fc, fce);
+		}
+	}
+
+	if (NULL != buf) {
+		fc->hits++;
+	} else {
+		fc->misses++;
+	}
+
+	g_mutex_unlock(fc->mutex);
+
+	return buf;
+}
+
+liBuffer* li_file_cache_load(liFileCache *fc, GString *path, struct stat *st, int fd) {
+	fileCacheEntry *fce;
+	liBuffer *buf;
+	gsize len = st->st_size;
+	ssize_t r;
+
+	if (0 == len || len > fc->max_file_size || len > fc->max_size) return NULL;
+
+	/* read outside the lock; a file this small is most likely in the page cache anyway */
+	buf = li_buffer_new_slice(len);
+	while (buf->used < len) {
+		r = pread(fd, buf->addr + buf->used, len - buf->used, buf->used);
+		if (r < 0 && EINTR == errno) continue;
+		if (r <= 0) {
+			/* read error or file shrinked */
+			li_buffer_release(buf);
+			return NULL;
+		}
+		buf->used += r;
+	}
+
+	fce = g_slice_new0(fileCacheEntry);
+	fce->path = g_string_new_len(GSTR_LEN(path));
+	fce->ino = st->st_ino;
+	fce->size = st->st_size;
+	file_cache_stat_times(st, &fce->mtime, &fce->ctime);
+	fce->buf = buf;
+	fce->lru_link.data = fce;
+	li_buffer_acquire(buf); /* reference for the caller */
+
+	g_mutex_lock(fc->mutex);
+
+	{
+		fileCacheEntry *old = g_hash_table_lookup(fc->entries, path);
+		if (NULL != old) file_cache_remove(fc, old);
+	}
+
+	while (fc->size + len > fc->max_size && NULL != fc->lru.tail) {
+		file_cache_remove(fc, fc->lru.tail->data);
+		fc->evictions++;
+	}
+
+	g_hash_table_insert(fc->entries, fce->path, fce);
+	g_queue_push_head_link(&fc->lru, &fce->lru_link);
+	fc->size += len;
+
+	g_mutex_unlock(fc->mutex);
+
+	return buf;
+}
+
+void li_file_cache_get_stats(liFileCache *fc, liFileCacheStats *stats) {
+	g_mutex_lock(fc->mutex);
+
+	stats->hits = fc->hits;
+	stats->misses = fc->misses;
+	stats->evictions = fc->evictions;
+	stats->size = fc->size;
+	stats->entries = g_hash_table_size(fc->entries);
+
+	g_mutex_unlock(fc->mutex);
+}
@@ -1,6 +1,91 @@
 
 #include <lighttpd/base.h>
 
+/* well known header names, lowercase, indexed by liHttpHeaderId - 1 */
+static const gchar* const header_id_names[LI_HTTP_HEADER_ID_COUNT - 1] = {
+	"accept",
+	"accept-charset",
+	"accept-encoding",
+	"accept-language",
+	"accept-ranges",
+	"age",
+	"authorization",
+	"cache-control",
+	"connection",
+	"content-encoding",
+	"content-language",
+	"content-length",
+	"content-location",
+	"content-range",
+	"content-type",
+	"cookie",
+	"date",
+	"etag",
+	"expect",
+	"expires",
+	"host",
+	"if-match",
+	"if-modified-since",
+	"if-none-match",
+	"if-range",
+	"if-unmodified-since",
+	"keep-alive",
+	"last-modified",
+	"location",
+	"pragma",
+	"proxy-authorization",
+	"range",
+	"referer",
+	"server",
+	"set-cookie",
+	"status",
+	"te",
+	"trailer",
+	"transfer-encoding",
+	"upgrade",
+	"user-agent",
+	"vary",
+	"via",
+	"www-authenticate",
+	"x-forwarded-for",
+	"x-forwarded-proto",
+	"x-sendfile",
+	"x-lighttpd-send-file",
+};
+
+/* perfect hash of the well known names: header_id_hash() -> id (0: none) */
+static const guint8 header_id_table[128] = {
+	 0,  0, 13,  0, 48,  0,  0, 15, 23,  0, 20, 14, 27, 26, 31, 11,
+	34, 32,  3, 47, 45,  0,  5,  0, 44, 12,  0, 38,  0, 19, 29, 28,
+	 0,  0,  0,  0, 37,  0,  0,  0,  0, 36,  0,  0,  0, 22,  6,  0,
+	 0,  0, 18,  0,  0,  0,  0,  8,  0,  0, 35,  0,  0, 46, 10,  0,
+	 0,  0,  0,  0,  0, 24,  0,  0,  0,  0,  0,  7,  0,  1,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0, 40,  0,  0, 25,  0, 39, 21,
+	 0,  9,  0,  4,  0,  0, 16,  0, 43, 41,  0,  2,  0,  0,  0, 33,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 30, 17,  0, 42,  0,  0,
+};
+
+#define HEADER_ID_LC(c) ((guint) ((guchar) (c) | 0x20)) /* lowercase for letters, keeps '-' and digits */
+
+static guint header_id_hash(const gchar *key, size_t keylen) {
+	return (keylen * 4 + HEADER_ID_LC(key[0]) * 20 + HEADER_ID_LC(key[keylen - 1]) * 27 + HEADER_ID_LC(key[keylen / 2])) % 128;
+}
+
+liHttpHeaderId li_http_header_id(const gchar *key, size_t keylen) {
+	liHttpHeaderId id;
+	const gchar *name;
+
+	if (0 == keylen) return LI_HTTP_HEADER_UNKNOWN;
+
+	id = (liHttpHeaderId) header_id_table[header_id_hash(key, keylen)];
+	if (LI_HTTP_HEADER_UNKNOWN == id) return id;
+
+	name = header_id_names[id - 1];
+	if (strlen(name) != keylen || 0 != g_ascii_strncasecmp(key, name, keylen)) return LI_HTTP_HEADER_UNKNOWN;
+
+	return id;
+}
+
 static void _http_header_free(gpointer p) {
 	liHttpHeader *h = (liHttpHeader*) p;
 	g_string_free(h->data, TRUE);
@@ -52,6 +137,7 @@ static liHttpHeader* _http_header_new(const gchar *key, size_t keylen, const gch
 	h->data = g_string_sized_new(keylen + valuelen + 2);
 	g_string_set_size(h->data, keylen + valuelen + 2);
 	h->keylen = keylen;
+	h->id = li_http_header_id(key, keylen);
 	s = h->data->str;
 	memcpy(s, key, keylen);
 	s += keylen;
@@ -76,6 +162,9 @@ liHttpHeaders* li_http_headers_new(void) {
 void li_http_headers_reset(liHttpHeaders* headers) {
 	g_queue_foreach(&headers->entries, _header_queue_free, NULL);
 	g_queue_clear(&headers->entries);
+	memset(headers->id_first, 0, sizeof(headers->id_first));
+	memset(headers->id_last, 0, sizeof(headers->id_last));
+	headers->version++;
 }
 
 void li_http_headers_free(liHttpHeaders* headers) {
@@ -89,36 +178,63 @@ void li_http_headers_free(liHttpHeaders* headers) {
 void li_http_header_insert(liHttpHeaders *headers, const gchar *key, size_t keylen, const gchar *val, size_t valuelen) {
 	liHttpHeader *h = _http_header_new(key, keylen, val, valuelen);
 	g_queue_push_tail(&headers->entries, h);
+	headers->version++;
+
+	if (LI_HTTP_HEADER_UNKNOWN != h->id) {
+		GList *l = g_queue_peek_tail_link(&headers->entries);
+		if (NULL == headers->id_first[h->id]) headers->id_first[h->id] = l;
+		headers->id_last[h->id] = l;
+	}
 }
 
+GList* li_http_header_find_next_id(GList *l, liHttpHeaderId id) {
+	for (l = g_list_next(l); l; l = g_list_next(l)) {
+		if (((liHttpHeader*) l->data)->id == id) return l;
+	}
+	return NULL;
+}
+
+/* headers with a well known name are never equal to an unknown key, only compare the names of unknown ones */
+#define HEADER_UNKNOWN_KEY_IS(h, k, klen) \
+	(LI_HTTP_HEADER_UNKNOWN == (h)->id && (h)->keylen == (klen) && 0 == g_ascii_strncasecmp((k), (h)->data->str, (klen)))
+
 GList* li_http_header_find_first(liHttpHeaders *headers, const gchar *key, size_t keylen) {
+	liHttpHeaderId id = li_http_header_id(key, keylen);
 	liHttpHeader *h;
 	GList *l;
 
+	if (LI_HTTP_HEADER_UNKNOWN != id) return headers->id_first[id];
+
 	for (l = g_queue_peek_head_link(&headers->entries); l; l = g_list_next(l)) {
 		h = (liHttpHeader*) l->data;
-		if (h->keylen == keylen && 0 == g_ascii_strncasecmp(key, h->data->str, keylen)) return l;
+		if (HEADER_UNKNOWN_KEY_IS(h, key, keylen)) return l;
 	}
 	return NULL;
 }
 
 GList* li_http_header_find_next(GList *l, const gchar *key, size_t keylen) {
+	liHttpHeaderId id = li_http_header_id(key, keylen);
 	liHttpHeader *h;
 
+	if (LI_HTTP_HEADER_UNKNOWN != id) return li_http_header_find_next_id(l, id);
+
 	for (l = g_list_next(l); l; l = g_list_next(l)) {
 		h = (liHttpHeader*) l->data;
-		if (h->keylen == keylen && 0 == g_ascii_strncasecmp(key, h->data->str, keylen)) return l;
+		if (HEADER_UNKNOWN_KEY_IS(h, key, keylen)) return l;
 	}
 	return NULL;
 }
 
 GList* li_http_header_find_last(liHttpHeaders *headers, const gchar *key, size_t keylen) {
+	liHttpHeaderId id = li_http_header_id(key, keylen);
 	liHttpHeader *h;
 	GList *l;
 
+	if (LI_HTTP_HEADER_UNKNOWN != id) return headers->id_last[id];
+
 	for (l = g_queue_peek_tail_link(&headers->entries); l; l = g_list_previous(l)) {
 		h = (liHttpHeader*) l->data;
-		if (h->keylen == keylen && 0 == g_ascii_strncasecmp(key, h->data->str, keylen)) return l;
+		if (HEADER_UNKNOWN_KEY_IS(h, key, keylen)) return l;
 	}
 	return NULL;
 }
@@ -140,6 +256,7 @@ void li_http_header_append(liHttpHeaders *headers, const gchar *key, size_t keyl
 		s = h->data->str + oldlen;
 		memcpy(s, ", ", 2);
 		memcpy(s+2, val, valuelen);
+		headers->version++;
 	}
 }
 
@@ -156,12 +273,29 @@ void li_http_header_overwrite(liHttpHeaders *headers, const gchar *key, size_t k
 		g_string_set_size(h->data, keylen + 2 + valuelen);
 		/* only overwrite value */
 		memcpy(h->data->str + keylen + 2, val, valuelen);
+		headers->version++;
 	}
 }
 
 void li_http_header_remove_link(liHttpHeaders *headers, GList *l) {
+	liHttpHeaderId id = ((liHttpHeader*) l->data)->id;
+
+	if (LI_HTTP_HEADER_UNKNOWN != id) {
+		if (headers->id_first[id] == l) {
+			headers->id_first[id] = li_http_header_find_next_id(l, id);
+		}
+		if (headers->id_last[id] == l) {
+			GList *prev;
+			for (prev = g_list_previous(l); prev; prev = g_list_previous(prev)) {
+				if (((liHttpHeader*) prev->data)->id == id) break;
+			}
+			headers->id_last[id] = prev;
+		}
+	}
+
 	_http_header_free(l->data);
 	g_queue_delete_link(&headers->entries, l);
+	headers->version++;
 }
 
 gboolean li_http_header_remove(liHttpHeaders *headers, const gchar *key, size_t keylen) {
@@ -140,6 +140,112 @@ void li_http_request_parser_clear(liHttpRequestCtx *ctx) {
 	g_string_free(ctx->h_value, TRUE);
 }
 
+/* Token = (OCTET - Separators - CTL) */
+static inline gboolean http_token_char(guchar c) {
+	if (c <= 0x20 || c == 0x7f) return FALSE;
+	switch (c) {
+	case '(': case ')': case '<': case '>': case '@': case ',': case ';': case ':':
+	case '\\': case '"': case '/': case '[': case ']': case '?': case '=': case '{': case '}':
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+/* returns the CR of the CRLF ending the line starting at p, or NULL if the fast path can't handle the line.
+ * in header values quoted strings have to be complete, quoted pairs are left to the ragel machine */
+static const gchar* http_request_fast_eol(const gchar *p, const gchar *pe, gboolean header_value) {
+	gboolean quoted = FALSE;
+
+	for (;;) {
+		p += li_http_request_scan(p, pe - p);
+		if (p + 1 >= pe) return NULL;
+
+		switch (*p) {
+		case '"':
+			if (header_value) quoted = !quoted;
+			break;
+		case '\\':
+			if (quoted) return NULL;
+			break;
+		case '\r':
+			return (!quoted && '\n' == p[1]) ? p : NULL;
+		default:
+			return NULL;
+		}
+		p++;
+	}
+}
+
+/* Fast path for the common case: the complete request header is in the first chunk, has CRLF line ends, an
+ * HTTP/1.0 or HTTP/1.1 version and no folded header lines. The line ends are found by li_http_request_scan.
+ * Returns the length of the request header, or 0 if the ragel machine has to parse it (which handles all the
+ * rare cases and reports the errors); in that case it removes the headers it already inserted.
+ */
+static gsize http_request_parse_fast(liHttpRequestCtx *ctx, const gchar *buf, gsize len) {
+	liRequest *req = ctx->request;
+	const gchar *p = buf, *pe = buf + len, *s, *e;
+
+	/* Method SP */
+	for (s = p; p < pe && http_token_char(*p); p++) ;
+	if (p == s || p == pe || ' ' != *p) return 0;
+	e = p++;
+
+	/* Request_URI SP HTTP_Version CRLF */
+	if (pe - p < 12) return 0;
+	{
+		const gchar *eol = http_request_fast_eol(p, pe, FALSE), *uri_end;
+
+		if (NULL == eol || eol - p < 10) return 0;
+		uri_end = eol - 9; /* " HTTP/1.x" */
+		if (0 != memcmp(uri_end, " HTTP/1.", 8)) return 0;
+		/* the scanner skips HT (allowed in header values), but the URI must not contain any CTL */
+		if (NULL != memchr(p, ' ', uri_end - p) || NULL != memchr(p, '\t', uri_end - p)) return 0;
+
+		switch (eol[-1]) {
+		case '0': req->http_version = LI_HTTP_VERSION_1_0; break;
+		case '1': req->http_version = LI_HTTP_VERSION_1_1; break;
+		default: return 0;
+		}
+
+		li_string_assign_len(req->http_method_str, s, e - s);
+		req->http_method = li_http_method_from_string(GSTR_LEN(req->http_method_str));
+		li_string_assign_len(req->uri.raw, p, uri_end - p);
+
+		p = eol + 2;
+	}
+
+	/* (Message_Header)* CRLF */
+	for (;;) {
+		const gchar *eol;
+
+		if (pe - p < 2) goto fallback;
+		if ('\r' == p[0]) {
+			if ('\n' != p[1]) goto fallback;
+			p += 2;
+			break;
+		}
+
+		for (s = p; p < pe && http_token_char(*p); p++) ;
+		if (p == s || p == pe || ':' != *p) goto fallback;
+		e = p++;
+
+		while (p < pe && (' ' == *p || '\t' == *p)) p++;
+		if (NULL == (eol = http_request_fast_eol(p, pe, TRUE))) goto fallback;
+		/* folded header line; let the ragel machine join it */
+		if (eol + 2 < pe && (' ' == eol[2] || '\t' == eol[2])) goto fallback;
+
+		li_http_header_insert(req->headers, s, e - s, p, eol - p);
+		p = eol + 2;
+	}
+
+	return p - buf;
+
+fallback:
+	li_http_headers_reset(req->headers);
+	return 0;
+}
+
 liHandlerResult li_http_request_parse(liVRequest *vr, liHttpRequestCtx *ctx) {
 	liHandlerResult res;
 
@@ -159,6 +265,15 @@ liHandlerResult li_http_request_parse(liVRequest *vr, liHttpRequestCtx *ctx) {
 			return res;
 		}
 
+		if (0 == ctx->chunk_ctx.bytes_in && li_http_request_parser_start == ctx->chunk_ctx.cs) {
+			gsize len = http_request_parse_fast(ctx, p, pe - p);
+			if (len > 0) {
+				li_chunk_parser_done(&ctx->chunk_ctx, len);
+				ctx->chunk_ctx.cs = li_http_request_parser_first_final;
+				break;
+			}
+		}
+
 		%% write exec;
 
 		li_chunk_parser_done(&ctx->chunk_ctx, p - ctx->chunk_ctx.buf);
@@ -0,0 +1,114 @@
+
+#include <lighttpd/base.h>
+#include <lighttpd/http_request_parser.h>
+
+/* Scanner for the fast path of the request parser: finds the first byte the fast path can't handle
+ * on its own, which includes the CR/LF line ends. The SIMD variants check 16 (SSE2) or 32 (AVX2)
+ * bytes per step; AVX2 is only used if the cpu supports it.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+# define HTTP_SCAN_X86 1
+# include <immintrin.h>
+#endif
+
+static inline gboolean http_scan_special(guchar c) {
+	return (c < 0x20 && c != '\t') || c == 0x7f || c == '"' || c == '\\';
+}
+
+static gsize http_request_scan_scalar(const gchar *buf, gsize len) {
+	gsize i;
+
+	for (i = 0; i < len; i++) {
+		if (http_scan_special(buf[i])) break;
+	}
+
+	return i;
+}
+
+#ifdef HTTP_SCAN_X86
+
+static gsize http_request_scan_sse2(const gchar *buf, gsize len) {
+	const __m128i ctl = _mm_set1_epi8(0x1f), ht = _mm_set1_epi8('\t'), del = _mm_set1_epi8(0x7f);
+	const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\');
+	gsize i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (buf + i));
+		/* v <= 0x1f (unsigned), but not HT */
+		__m128i m = _mm_andnot_si128(_mm_cmpeq_epi8(v, ht), _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v));
+		int bits;
+
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, del));
+		m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+
+		if (0 != (bits = _mm_movemask_epi8(m))) return i + __builtin_ctz(bits);
+	}
+
+	return i + http_request_scan_scalar(buf + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static gsize http_request_scan_avx2(const gchar *buf, gsize len) {
+	const __m256i ctl = _mm256_set1_epi8(0x1f), ht = _mm256_set1_epi8('\t'), del = _mm256_set1_epi8(0x7f);
+	const __m256i quote = _mm256_set1_epi8('"'), backslash = _mm256_set1_epi8('\\');
+	gsize i;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) (buf + i));
+		__m256i m = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, ht), _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v));
+		guint32 bits;
+
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, del));
+		m = _mm256_or_si256(m, _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)));
+
+		if (0 != (bits = (guint32) _mm256_movemask_epi8(m))) return i + __builtin_ctz(bits);
+	}
+
+	/* rest in (at most) two sse2 steps */
+	return i + http_request_scan_sse2(buf + i, len - i);
+}
+
+#endif /* HTTP_SCAN_X86 */
+
+typedef gsize (*http_request_scan_func)(const gchar *buf, gsize len);
+
+static http_request_scan_func http_request_scan_impl = NULL;
+static const gchar *http_request_scan_impl_name = NULL;
+
+static void http_request_scan_select(void) {
+	static gsize initialized = 0;
+
+	if (g_once_init_enter(&initialized)) {
+		http_request_scan_func impl = http_request_scan_scalar;
+		const gchar *name = "scalar";
+
+#ifdef HTTP_SCAN_X86
+		impl = http_request_scan_sse2;
+		name = "sse2";
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			impl = http_request_scan_avx2;
+			name = "avx2";
+		}
+#endif
+
+		http_request_scan_impl_name = name;
+		http_request_scan_impl = impl;
+		g_once_init_leave(&initialized, 1);
+	}
+}
+
+gsize li_http_request_scan(const gchar *buf, gsize len) {
+	if (G_UNLIKELY(NULL == http_request_scan_impl)) http_request_scan_select();
+	return http_request_scan_impl(buf, len);
+}
+
+const gchar* li_http_request_scan_impl(void) {
+	http_request_scan_select();
+	return http_request_scan_impl_name;
+}
+
+gsize li_http_request_scan_fallback(const gchar *buf, gsize len) {
+	return http_request_scan_scalar(buf, len);
+}
@@ -40,32 +40,78 @@ ssize_t li_net_read(int fd, void *buf, ssize_t nbyte) {
 	return r;
 }
 
-liNetworkStatus li_network_write(int fd, liChunkQueue *cq, goffset write_max, GError **err) {
+#ifdef TCP_CORK
+/* the backends pass MSG_MORE if more data follows in the same call; only sendfile()
+ * can't do that, so we still need a cork if a file chunk is followed by more data.
+ * without MSG_MORE cork every write with more than one chunk.
+ */
+static gboolean network_need_cork(liWorker *wrk, liChunkQueue *cq, goffset write_max) {
+#if defined(MSG_MORE) && defined(USE_SENDFILE)
+	liChunkIter ci;
+	goffset len = 0;
+
+	if (cq->queue.length < 2 || LI_NETWORK_BACKEND_WRITEV == wrk->srv->network_backend) return FALSE;
+
+	ci = li_chunkqueue_iter(cq);
+	do {
+		liChunk *c = li_chunkiter_chunk(ci);
+		len += li_chunk_length(c);
+		if (len >= write_max) return FALSE;
+		if (FILE_CHUNK == c->type) return li_chunkiter_next(&ci);
+	} while (li_chunkiter_next(&ci));
+
+	return FALSE;
+#elif defined(MSG_MORE)
+	UNUSED(wrk); UNUSED(cq); UNUSED(write_max);
+	return FALSE;
+#else
+	UNUSED(wrk); UNUSED(write_max);
+	return cq->queue.length > 1;
+#endif
+}
+#endif
+
+liNetworkStatus li_network_write(liWorker *wrk, int fd, liChunkQueue *cq, goffset write_max, GError **err) {
 	liNetworkStatus res;
 #ifdef TCP_CORK
 	int corked = 0;
 #endif
 
+	if (LI_NETWORK_BACKEND_IO_URING == wrk->srv->network_backend && !wrk->network_io_uring_failed) {
+		/* a submission only contains one send operation, no need to cork */
+		return li_network_write_io_uring(wrk, fd, cq, &write_max, err);
+	}
+
 #ifdef TCP_CORK
 	/* Linux: put a cork into the socket as we want to combine the write() calls
-	 * but only if we really have multiple chunks
+	 * but only if we really have to
 	 */
-	if (cq->queue.length > 1) {
+	if (network_need_cork(wrk, cq, write_max)) {
 		corked = 1;
+		wrk->stats.cork_syscalls++;
 		setsockopt(fd, IPPROTO_TCP, TCP_CORK, &corked, sizeof(corked));
 	}
 #endif
 
-	/* TODO: add setup-option to select the backend */
+	switch (wrk->srv->network_backend) {
+	case LI_NETWORK_BACKEND_WRITEV:
+		res = li_network_write_writev(wrk, fd, cq, &write_max, err);
+		break;
+	case LI_NETWORK_BACKEND_SENDFILE:
+	case LI_NETWORK_BACKEND_IO_URING: /* io_uring not available in this worker */
+	default:
 #ifdef USE_SENDFILE
-	res = li_network_write_sendfile(fd, cq, &write_max, err);
+		res = li_network_write_sendfile(wrk, fd, cq, &write_max, err);
 #else
-	res = li_network_write_writev(fd, cq, &write_max, err);
+		res = li_network_write_writev(wrk, fd, cq, &write_max, err);
 #endif
+		break;
+	}
 
 #ifdef TCP_CORK
 	if (corked) {
 		corked = 0;
+		wrk->stats.cork_syscalls++;
 		setsockopt(fd, IPPROTO_TCP, TCP_CORK, &corked, sizeof(corked));
 	}
 #endif
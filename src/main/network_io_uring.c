@@ -0,0 +1,281 @@
+
+#include <lighttpd/base.h>
+
+/* io_uring write backend
+ *
+ * One submission contains the reads for all (small) file chunks at the head of the queue into a
+ * per-worker scratch buffer, linked to a single sendmsg which sends memory chunks and the read file
+ * data in queue order. A short or failed read breaks the link and cancels the sendmsg, and as there
+ * is only one send operation per submission, the number of bytes sent is always exact.
+ *
+ * The stream layer expects li_network_write to return synchronously, so the completions are reaped
+ * right after the submission. To keep that from blocking the worker, no operation may wait: the
+ * sendmsg uses MSG_DONTWAIT (io_uring doesn't look at O_NONBLOCK of the socket, it would wait for
+ * socket space instead) and the reads use RWF_NOWAIT, so they only succeed with data already in the
+ * page cache. If a read would block, nothing is sent and that round is written with the default
+ * backend instead, which blocks on the disk like it always did.
+ */
+
+static liNetworkStatus network_io_uring_fallback(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
+#ifdef USE_SENDFILE
+	return li_network_write_sendfile(wrk, fd, cq, write_max, err);
+#else
+	return li_network_write_writev(wrk, fd, cq, write_max, err);
+#endif
+}
+
+#ifdef HAVE_LIBURING
+
+#include <liburing.h>
+#include <sys/uio.h>
+
+#define IO_URING_ENTRIES   64          /* submission queue size: the reads + one sendmsg */
+#define IO_URING_MAX_READS (IO_URING_ENTRIES - 1)
+#define IO_URING_MAX_IOV   64          /* iovecs for the sendmsg */
+#define IO_URING_FILE_BUF  (64*1024)   /* scratch buffer for file data read in one submission */
+
+struct liNetworkIOUring {
+	struct io_uring ring;
+
+	char *file_buf;
+	struct iovec iov[IO_URING_MAX_IOV];
+	struct msghdr msg;
+
+	struct {
+		int fd;
+		off_t offset;
+		size_t len;
+		char *buf;
+		int res;
+	} reads[IO_URING_MAX_READS];
+};
+
+gboolean li_network_io_uring_supported(void) {
+	return TRUE;
+}
+
+static liNetworkIOUring* network_io_uring_new(liWorker *wrk) {
+	liNetworkIOUring *uring = g_slice_new0(liNetworkIOUring);
+	int r;
+
+	if (0 > (r = io_uring_queue_init(IO_URING_ENTRIES, &uring->ring, 0))) {
+		WARNING(wrk->srv, "worker %u: couldn't setup io_uring (%s), falling back to the default write backend", wrk->ndx, g_strerror(-r));
+		g_slice_free(liNetworkIOUring, uring);
+		return NULL;
+	}
+
+	uring->file_buf = g_malloc(IO_URING_FILE_BUF);
+
+	return uring;
+}
+
+void li_network_io_uring_free(liNetworkIOUring *uring) {
+	if (NULL == uring) return;
+
+	io_uring_queue_exit(&uring->ring);
+	g_free(uring->file_buf);
+
+	g_slice_free(liNetworkIOUring, uring);
+}
+
+/* the ring is in an unknown state (submitted entries we didn't reap): drop it and don't use io_uring in this worker anymore */
+static void network_io_uring_broken(liWorker *wrk) {
+	li_network_io_uring_free(wrk->network_io_uring);
+	wrk->network_io_uring = NULL;
+	wrk->network_io_uring_failed = TRUE;
+}
+
+liNetworkStatus li_network_write_io_uring(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
+	liNetworkIOUring *uring;
+	liChunkIter ci;
+	liChunk *c;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	guint nreads, niov, pending, i;
+	gsize buf_used;
+	off_t we_have;
+	int r, send_res;
+
+	if (0 == cq->length) return LI_NETWORK_STATUS_FATAL_ERROR;
+
+	if (NULL == (uring = wrk->network_io_uring)) {
+		if (wrk->network_io_uring_failed || NULL == (uring = wrk->network_io_uring = network_io_uring_new(wrk))) {
+			wrk->network_io_uring_failed = TRUE;
+			return network_io_uring_fallback(wrk, fd, cq, write_max, err);
+		}
+	}
+
+	do {
+		ci = li_chunkqueue_iter(cq);
+		c = li_chunkiter_chunk(ci);
+
+#ifdef USE_SENDFILE
+		/* don't copy big files through the scratch buffer */
+		if (FILE_CHUNK == c->type && li_chunk_length(c) > IO_URING_FILE_BUF) {
+			LI_NETWORK_FALLBACK(li_network_backend_sendfile, write_max);
+			if (0 == cq->length) return LI_NETWORK_STATUS_SUCCESS;
+			continue;
+		}
+#endif
+
+		nreads = niov = 0;
+		buf_used = 0;
+		we_have = 0;
+
+		do {
+			off_t len = li_chunk_length(c);
+			struct iovec *v = &uring->iov[niov];
+
+			if (len > *write_max - we_have) len = *write_max - we_have;
+
+			switch (c->type) {
+			case STRING_CHUNK:
+				v->iov_base = c->data.str->str + c->offset;
+				break;
+			case MEM_CHUNK:
+				v->iov_base = c->mem->data + c->offset;
+				break;
+			case BUFFER_CHUNK:
+				v->iov_base = c->data.buffer.buffer->addr + c->data.buffer.offset + c->offset;
+				break;
+			case FILE_CHUNK:
+				if (nreads == IO_URING_MAX_READS || buf_used == IO_URING_FILE_BUF) goto submit;
+#ifdef USE_SENDFILE
+				/* send what we have, the next round uses sendfile for it */
+				if (len > IO_URING_FILE_BUF - buf_used && we_have > 0) goto submit;
+#endif
+				if (LI_HANDLER_GO_ON != li_chunkfile_open(c->data.file.file, err)) {
+					return LI_NETWORK_STATUS_FATAL_ERROR;
+				}
+				if (len > IO_URING_FILE_BUF - buf_used) len = IO_URING_FILE_BUF - buf_used;
+
+				uring->reads[nreads].fd = c->data.file.file->fd;
+				uring->reads[nreads].offset = c->data.file.start + c->offset;
+				uring->reads[nreads].len = len;
+				uring->reads[nreads].buf = uring->file_buf + buf_used;
+				uring->reads[nreads].res = -ECANCELED;
+				nreads++;
+
+				v->iov_base = uring->file_buf + buf_used;
+				buf_used += len;
+				break;
+			default:
+				goto submit;
+			}
+
+			v->iov_len = len;
+			niov++;
+			we_have += len;
+		} while (we_have < *write_max &&
+		         niov < IO_URING_MAX_IOV &&
+		         li_chunkiter_next(&ci) &&
+		         NULL != (c = li_chunkiter_chunk(ci)));
+
+submit:
+		if (0 == niov) return LI_NETWORK_STATUS_FATAL_ERROR;
+
+		for (i = 0; i < nreads; i++) {
+			sqe = io_uring_get_sqe(&uring->ring);
+			io_uring_prep_read(sqe, uring->reads[i].fd, uring->reads[i].buf, uring->reads[i].len, uring->reads[i].offset);
+#ifdef RWF_NOWAIT
+			sqe->rw_flags = RWF_NOWAIT;
+#endif
+			io_uring_sqe_set_flags(sqe, IOSQE_IO_LINK);
+			io_uring_sqe_set_data(sqe, GUINT_TO_POINTER(i + 1));
+		}
+
+		memset(&uring->msg, 0, sizeof(uring->msg));
+		uring->msg.msg_iov = uring->iov;
+		uring->msg.msg_iovlen = niov;
+
+		sqe = io_uring_get_sqe(&uring->ring);
+		io_uring_prep_sendmsg(sqe, fd, &uring->msg, MSG_NOSIGNAL | MSG_DONTWAIT | (LI_NETWORK_MORE(cq, we_have, *write_max) ? MSG_MORE : 0));
+		io_uring_sqe_set_data(sqe, NULL);
+
+		pending = nreads + 1;
+		wrk->stats.write_syscalls++;
+		while (0 > (r = io_uring_submit_and_wait(&uring->ring, pending))) {
+			if (-EINTR == r) continue;
+			g_set_error(err, LI_NETWORK_ERROR, 0, "li_network_write_io_uring: io_uring submit failed: %s", g_strerror(-r));
+			network_io_uring_broken(wrk);
+			return LI_NETWORK_STATUS_FATAL_ERROR;
+		}
+
+		send_res = -ECANCELED;
+		while (pending > 0) {
+			if (0 > (r = io_uring_wait_cqe(&uring->ring, &cqe))) {
+				if (-EINTR == r) continue;
+				g_set_error(err, LI_NETWORK_ERROR, 0, "li_network_write_io_uring: waiting for io_uring completion failed: %s", g_strerror(-r));
+				network_io_uring_broken(wrk);
+				return LI_NETWORK_STATUS_FATAL_ERROR;
+			}
+			i = GPOINTER_TO_UINT(io_uring_cqe_get_data(cqe));
+			if (0 == i) {
+				send_res = cqe->res;
+			} else {
+				uring->reads[i - 1].res = cqe->res;
+			}
+			io_uring_cqe_seen(&uring->ring, cqe);
+			pending--;
+		}
+
+		/* the first failed or short read cancels everything after it, including the sendmsg */
+		for (i = 0; i < nreads; i++) {
+			int res = uring->reads[i].res;
+			if (-EAGAIN == res || -EOPNOTSUPP == res || (res >= 0 && (size_t) res != uring->reads[i].len)) {
+				/* data not (completely) in the page cache, or no RWF_NOWAIT support: nothing was sent.
+				 * the default backend reads (and detects shrinked files) the blocking way */
+				return network_io_uring_fallback(wrk, fd, cq, write_max, err);
+			}
+			if (res < 0) {
+				g_set_error(err, LI_NETWORK_ERROR, 0, "li_network_write_io_uring: reading file failed: %s", g_strerror(-res));
+				return LI_NETWORK_STATUS_FATAL_ERROR;
+			}
+		}
+
+		if (send_res < 0) {
+			switch (-send_res) {
+			case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+			case EWOULDBLOCK:
+#endif
+				return LI_NETWORK_STATUS_WAIT_FOR_EVENT;
+			case ECONNRESET:
+			case EPIPE:
+			case ETIMEDOUT:
+				return LI_NETWORK_STATUS_CONNECTION_CLOSE;
+			case EINTR:
+				continue; /* try again */
+			default:
+				g_set_error(err, LI_NETWORK_ERROR, 0, "li_network_write_io_uring: oops, write to fd=%d failed: %s", fd, g_strerror(-send_res));
+				return LI_NETWORK_STATUS_FATAL_ERROR;
+			}
+		}
+		if (0 == send_res) return LI_NETWORK_STATUS_WAIT_FOR_EVENT;
+
+		li_chunkqueue_skip(cq, send_res);
+		*write_max -= send_res;
+
+		if (send_res != we_have) return LI_NETWORK_STATUS_WAIT_FOR_EVENT;
+		if (0 == cq->length) return LI_NETWORK_STATUS_SUCCESS;
+	} while (*write_max > 0);
+
+	return LI_NETWORK_STATUS_SUCCESS;
+}
+
+#else /* HAVE_LIBURING */
+
+gboolean li_network_io_uring_supported(void) {
+	return FALSE;
+}
+
+void li_network_io_uring_free(liNetworkIOUring *uring) {
+	UNUSED(uring);
+}
+
+liNetworkStatus li_network_write_io_uring(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
+	wrk->network_io_uring_failed = TRUE;
+	return network_io_uring_fallback(wrk, fd, cq, write_max, err);
+}
+
+#endif /* HAVE_LIBURING */
@@ -151,7 +151,7 @@ static network_sendfile_result lighty_sendfile(int fd, int filefd, goffset offse
 
 
 /* first chunk must be a FILE_CHUNK ! */
-static liNetworkStatus network_backend_sendfile(int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
+liNetworkStatus li_network_backend_sendfile(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
 	off_t file_offset, toSend;
 	ssize_t r;
 	gboolean did_write_something = FALSE;
@@ -179,6 +179,7 @@ static liNetworkStatus network_backend_sendfile(int fd, liChunkQueue *cq, goffse
 		if (toSend > *write_max) toSend = *write_max;
 
 		r = 0;
+		wrk->stats.write_syscalls++;
 		switch (lighty_sendfile(fd, c->data.file.file->fd, file_offset, toSend, &r, err)) {
 		case NSR_SUCCESS:
 			li_chunkqueue_skip(cq, r);
@@ -198,13 +199,13 @@ static liNetworkStatus network_backend_sendfile(int fd, liChunkQueue *cq, goffse
 			/* don't care about cached stat - file is open */
 			struct stat st;
 			if (-1 == fstat(fd, &st)) {
-				g_set_error(err, LI_NETWORK_ERROR, 0, "network_backend_sendfile: Couldn't fstat file: %s", g_strerror(errno));
+				g_set_error(err, LI_NETWORK_ERROR, 0, "li_network_backend_sendfile: Couldn't fstat file: %s", g_strerror(errno));
 				return LI_NETWORK_STATUS_FATAL_ERROR;
 			}
 
 			if (file_offset > st.st_size) {
 				/* file shrinked, close the connection */
-				g_set_error(err, LI_NETWORK_ERROR, 0, "network_backend_sendfile: File shrinked, aborting");
+				g_set_error(err, LI_NETWORK_ERROR, 0, "li_network_backend_sendfile: File shrinked, aborting");
 				return LI_NETWORK_STATUS_FATAL_ERROR;
 			}
 			return LI_NETWORK_STATUS_WAIT_FOR_EVENT;
@@ -218,7 +219,7 @@ static liNetworkStatus network_backend_sendfile(int fd, liChunkQueue *cq, goffse
 	return LI_NETWORK_STATUS_SUCCESS;
 }
 
-liNetworkStatus li_network_write_sendfile(int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
+liNetworkStatus li_network_write_sendfile(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
 	if (cq->length == 0) return LI_NETWORK_STATUS_FATAL_ERROR;
 
 	do {
@@ -229,7 +230,7 @@ liNetworkStatus li_network_write_sendfile(int fd, liChunkQueue *cq, goffset *wri
 			LI_NETWORK_FALLBACK(li_network_backend_writev, write_max);
 			break;
 		case FILE_CHUNK:
-			LI_NETWORK_FALLBACK(network_backend_sendfile, write_max);
+			LI_NETWORK_FALLBACK(li_network_backend_sendfile, write_max);
 			break;
 		default:
 			return LI_NETWORK_STATUS_FATAL_ERROR;
@@ -1,7 +1,21 @@
 
 #include <lighttpd/base.h>
 
-liNetworkStatus li_network_backend_write(int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
+/* write(), or send() with MSG_MORE if more data follows; repeats after EINTR */
+static ssize_t network_write(int fd, char *buf, ssize_t nbyte, gboolean more) {
+#ifdef MSG_MORE
+	if (more) {
+		ssize_t r;
+		while (-1 == (r = send(fd, buf, nbyte, MSG_MORE)) && EINTR == errno) ;
+		return r;
+	}
+#else
+	UNUSED(more);
+#endif
+	return li_net_write(fd, buf, nbyte);
+}
+
+liNetworkStatus li_network_backend_write(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
 	const ssize_t blocksize = 16*1024; /* 16k */
 	char *block_data;
 	off_t block_len;
@@ -22,7 +36,8 @@ liNetworkStatus li_network_backend_write(int fd, liChunkQueue *cq, goffset *writ
 			return LI_NETWORK_STATUS_FATAL_ERROR;
 		}
 
-		if (-1 == (r = li_net_write(fd, block_data, block_len))) {
+		wrk->stats.write_syscalls++;
+		if (-1 == (r = network_write(fd, block_data, block_len, LI_NETWORK_MORE(cq, block_len, *write_max)))) {
 			switch (errno) {
 			case EAGAIN:
 #if EWOULDBLOCK != EAGAIN
@@ -24,11 +24,27 @@
 # endif
 #endif
 
+/* writev(), or sendmsg() with MSG_MORE if more data follows */
+static ssize_t network_writev(int fd, struct iovec *iov, int iovcnt, gboolean more) {
+#ifdef MSG_MORE
+	if (more) {
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = iovcnt;
+		return sendmsg(fd, &msg, MSG_MORE);
+	}
+#else
+	UNUSED(more);
+#endif
+	return writev(fd, iov, iovcnt);
+}
+
 /* first chunk must be a STRING_CHUNK ! */
-liNetworkStatus li_network_backend_writev(int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
+liNetworkStatus li_network_backend_writev(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
 	off_t we_have;
 	ssize_t r;
-	gboolean did_write_something = FALSE;
+	gboolean did_write_something = FALSE, more;
 	liChunkIter ci;
 	liChunk *c;
 	liNetworkStatus res = LI_NETWORK_STATUS_FATAL_ERROR;
@@ -67,7 +83,9 @@ liNetworkStatus li_network_backend_writev(int fd, liChunkQueue *cq, goffset *wri
 		         (STRING_CHUNK == (c = li_chunkiter_chunk(ci))->type || MEM_CHUNK == c->type || BUFFER_CHUNK == c->type) &&
 		         chunks->len < UIO_MAXIOV);
 
-		while (-1 == (r = writev(fd, &g_array_index(chunks, struct iovec, 0), chunks->len))) {
+		more = LI_NETWORK_MORE(cq, we_have, *write_max);
+		wrk->stats.write_syscalls++;
+		while (-1 == (r = network_writev(fd, &g_array_index(chunks, struct iovec, 0), chunks->len, more))) {
 			switch (errno) {
 			case EAGAIN:
 #if EWOULDBLOCK != EAGAIN
@@ -115,7 +133,7 @@ cleanup:
 	return res;
 }
 
-liNetworkStatus li_network_write_writev(int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
+liNetworkStatus li_network_write_writev(liWorker *wrk, int fd, liChunkQueue *cq, goffset *write_max, GError **err) {
 	if (cq->length == 0) return LI_NETWORK_STATUS_FATAL_ERROR;
 	do {
 		switch (li_chunkqueue_first_chunk(cq)->type) {
@@ -325,24 +325,24 @@ void li_pattern_array_cb(GString *pattern_result, guint from, guint to, gpointer
 }
 
 void li_pattern_regex_cb(GString *pattern_result, guint from, guint to, gpointer data) {
-	GMatchInfo *match_info = data;
+	liRegexMatch *match = data;
 	guint i;
-	gint start_pos, end_pos;
+	gsize start_pos, end_pos;
 
-	if (NULL == match_info) return;
+	if (NULL == match) return;
 
 	if (G_LIKELY(from <= to)) {
 		to = MIN(to, G_MAXINT);
 		for (i = from; i <= to; i++) {
-			if (g_match_info_fetch_pos(match_info, (gint) i, &start_pos, &end_pos)) {
-				g_string_append_len(pattern_result, g_match_info_get_string(match_info) + start_pos, end_pos - start_pos);
+			if (li_regex_match_fetch_pos(match, i, &start_pos, &end_pos)) {
+				g_string_append_len(pattern_result, match->subject + start_pos, end_pos - start_pos);
 			}
 		}
 	} else {
 		from = MIN(from, G_MAXINT); /* => from+1 is defined */
 		for (i = from + 1; --i >= to; ) {
-			if (g_match_info_fetch_pos(match_info, (gint) i, &start_pos, &end_pos)) {
-				g_string_append_len(pattern_result, g_match_info_get_string(match_info) + start_pos, end_pos - start_pos);
+			if (li_regex_match_fetch_pos(match, i, &start_pos, &end_pos)) {
+				g_string_append_len(pattern_result, match->subject + start_pos, end_pos - start_pos);
 			}
 		}
 	}
@@ -154,7 +154,7 @@ static void core_docroot_nth_cb(GString *pattern_result, guint to, guint from, g
 
 static liHandlerResult core_handle_docroot(liVRequest *vr, gpointer param, gpointer *context) {
 	guint i;
-	GMatchInfo *match_info = NULL;
+	liRegexMatch *match = NULL;
 	GArray *arr = param;
 	docroot_split dsplit = { vr->request.uri.host, NULL, 0 };
 
@@ -162,7 +162,7 @@ static liHandlerResult core_handle_docroot(liVRequest *vr, gpointer param, gpoin
 
 	if (vr->action_stack.regex_stack->len) {
 		GArray *rs = vr->action_stack.regex_stack;
-		match_info = g_array_index(rs, liActionRegexStackElement, rs->len - 1).match_info;
+		match = &g_array_index(rs, liActionRegexStackElement, rs->len - 1).match;
 	}
 
 	/* resume from last stat check */
@@ -180,7 +180,7 @@ static liHandlerResult core_handle_docroot(liVRequest *vr, gpointer param, gpoin
 
 
 		g_string_truncate(vr->physical.doc_root, 0);
-		li_pattern_eval(vr, vr->physical.doc_root, g_array_index(arr, liPattern*, i), core_docroot_nth_cb, &dsplit, li_pattern_regex_cb, match_info);
+		li_pattern_eval(vr, vr->physical.doc_root, g_array_index(arr, liPattern*, i), core_docroot_nth_cb, &dsplit, li_pattern_regex_cb, match);
 
 		/* if there's only one entry and we're not debug logging, don't stat */
 		if (i == arr->len - 1 && !CORE_OPTION(LI_CORE_OPTION_DEBUG_REQUEST_HANDLING).boolean) break;
@@ -527,8 +527,140 @@ static liAction* core_index(liServer *srv, liWorker *wrk, liPlugin* p, liValue *
 }
 
 
+/* precompressed siblings (static.precompressed), in order of preference */
+static const struct {
+	const gchar *encoding;
+	const gchar *suffix;
+} core_static_encodings[] = {
+	{ "br", ".br" },
+	{ "zstd", ".zst" },
+	{ "gzip", ".gz" },
+	{ NULL, NULL }
+};
+
+/* whether one of the Accept-Encoding headers lists the encoding (or "*") without "q=0" */
+static gboolean core_static_accepts_encoding(liVRequest *vr, const gchar *encoding) {
+	gsize enclen = strlen(encoding);
+	GList *l;
+
+	for (l = li_http_header_find_first(vr->request.headers, CONST_STR_LEN("accept-encoding")); NULL != l;
+			l = li_http_header_find_next(l, CONST_STR_LEN("accept-encoding"))) {
+		liHttpHeader *h = (liHttpHeader*) l->data;
+		const gchar *s = LI_HEADER_VALUE(h);
+
+		while ('\0' != *s) {
+			const gchar *token;
+			gsize tokenlen;
+			gboolean disabled = FALSE;
+
+			while (' ' == *s || '\t' == *s || ',' == *s) s++;
+			token = s;
+			while ('\0' != *s && ',' != *s && ';' != *s && ' ' != *s && '\t' != *s) s++;
+			tokenlen = s - token;
+
+			/* parameters: we only care about q=0 */
+			for (; '\0' != *s && ',' != *s; s++) {
+				if ('q' == s[0] && '=' == s[1] && (';' == s[-1] || ' ' == s[-1] || '\t' == s[-1])) {
+					disabled = (0 == g_ascii_strtod(s + 2, NULL));
+				}
+			}
+
+			if (disabled || 0 == tokenlen) continue;
+			if (tokenlen == enclen && 0 == g_ascii_strncasecmp(token, encoding, enclen)) return TRUE;
+			if (1 == tokenlen && '*' == token[0]) return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* looks for a precompressed sibling of vr->physical.path the client accepts and which is not older than the file (st).
+ * returns the index of the encoding with *path, *file and *pst describing the sibling, or -1 if there is none;
+ * WAIT_FOR_EVENT in *res means the stat cache needs more time for a sibling */
+static gint core_static_precompressed(liVRequest *vr, struct stat *st, GString **path, struct stat *pst, liChunkFile **file, liHandlerResult *res) {
+	gint i;
+	int err;
+
+	*res = LI_HANDLER_GO_ON;
+
+	for (i = 0; NULL != core_static_encodings[i].encoding; i++) {
+		if (!core_static_accepts_encoding(vr, core_static_encodings[i].encoding)) continue;
+
+		if (NULL == *path) *path = g_string_sized_new(vr->physical.path->len + 4);
+		g_string_truncate(*path, 0);
+		g_string_append_len(*path, GSTR_LEN(vr->physical.path));
+		g_string_append(*path, core_static_encodings[i].suffix);
+
+		/* misses end up in the negative set of the stat cache, so looking for siblings which don't exist is cheap */
+		switch (li_stat_cache_get_file(vr, *path, pst, &err, file, NULL)) {
+		case LI_HANDLER_GO_ON:
+			if (S_ISREG(pst->st_mode) && pst->st_mtime >= st->st_mtime && NULL != *file) return i;
+			li_chunkfile_release(*file);
+			*file = NULL;
+			break;
+		case LI_HANDLER_WAIT_FOR_EVENT:
+			*res = LI_HANDLER_WAIT_FOR_EVENT;
+			return -1;
+		default:
+			break;
+		}
+	}
+
+	return -1;
+}
+
+/* ETag and Last-Modified of the original file; the ETag is mutated for the encoding the same way mod_deflate does it */
+static void core_static_etag_encoded(liVRequest *vr, struct stat *st, liStatCacheEntryData *sced, const gchar *encoding, gboolean *cachable) {
+	guint flags = CORE_OPTION(LI_CORE_OPTION_ETAG_FLAGS).number;
+	GString *etag = NULL, *last_modified = NULL, last_modified_buf;
+	gchar buf[64];
+	gsize len;
+
+	if (NULL != sced) {
+		GString *orig_etag = li_stat_cache_etag(vr, sced);
+		if (NULL != orig_etag) {
+			etag = vr->wrk->tmp_str;
+			g_string_truncate(etag, 0);
+			g_string_append_len(etag, GSTR_LEN(orig_etag));
+		}
+		last_modified = sced->last_modified;
+	} else {
+		if (0 != flags) {
+			etag = vr->wrk->tmp_str;
+			li_etag_create(etag, st, flags);
+		}
+		if (0 != (len = li_etag_last_modified(buf, sizeof(buf), st->st_mtime))) {
+			last_modified_buf = li_const_gstring(buf, len);
+			last_modified = &last_modified_buf;
+		}
+	}
+
+	if (NULL != etag) {
+		g_string_append_len(etag, CONST_STR_LEN("-"));
+		g_string_append(etag, encoding);
+		li_etag_mutate(etag, etag);
+	}
+
+	li_etag_set_header_values(vr, etag, last_modified, cachable);
+}
+
+/* appends a part of the file: from the memory cache if we have the contents, otherwise as file chunk */
+static void core_static_append(liChunkQueue *cq, liChunkFile *cf, liBuffer *buf, goffset start, goffset length) {
+	if (NULL != buf) {
+		li_buffer_acquire(buf);
+		li_chunkqueue_append_buffer2(cq, buf, start, length);
+	} else {
+		li_chunkqueue_append_chunkfile(cq, cf, start, length);
+	}
+}
+
 static liHandlerResult core_handle_static(liVRequest *vr, gpointer param, gpointer *context) {
-	int fd = -1;
+	liChunkFile *cf = NULL;
+	liBuffer *buf = NULL;
+	liFileCache *fc = vr->wrk->srv->file_cache;
+	GString *encoded_path = NULL;
+	gint encoding = -1;
+	liStatCacheEntryData *sced;
 	struct stat st;
 	int err;
 	liHandlerResult res;
@@ -583,7 +715,7 @@ static liHandlerResult core_handle_static(liVRequest *vr, gpointer param, gpoint
 		}
 	}
 
-	res = li_stat_cache_get(vr, vr->physical.path, &st, &err, &fd);
+	res = li_stat_cache_get_file(vr, vr->physical.path, &st, &err, &cf, &sced);
 	if (res == LI_HANDLER_WAIT_FOR_EVENT)
 		return res;
 
@@ -594,9 +726,6 @@ static liHandlerResult core_handle_static(liVRequest *vr, gpointer param, gpoint
 	if (res == LI_HANDLER_ERROR) {
 		/* open or fstat failed */
 
-		if (fd != -1)
-			close(fd);
-
 		if (no_fail) return LI_HANDLER_GO_ON;
 
 		if (!li_vrequest_handle_direct(vr)) {
@@ -616,16 +745,14 @@ static liHandlerResult core_handle_static(liVRequest *vr, gpointer param, gpoint
 			return LI_HANDLER_ERROR;
 		}
 	} else if (S_ISDIR(st.st_mode)) {
-		if (fd != -1)
-			close(fd);
+		li_chunkfile_release(cf);
 		return LI_HANDLER_GO_ON;
 	} else if (!S_ISREG(st.st_mode)) {
 		if (CORE_OPTION(LI_CORE_OPTION_DEBUG_REQUEST_HANDLING).boolean) {
 			VR_DEBUG(vr, "not a regular file: '%s'", vr->physical.path->str);
 		}
 
-		if (fd != -1)
-			close(fd);
+		li_chunkfile_release(cf);
 
 		if (no_fail) return LI_HANDLER_GO_ON;
 
@@ -639,30 +766,77 @@ static liHandlerResult core_handle_static(liVRequest *vr, gpointer param, gpoint
 		gboolean cachable;
 		gboolean ranged_response = FALSE;
 		liHttpHeader *hh_range;
-		liChunkFile *cf;
 		static const GString default_mime_str = { CONST_STR_LEN("application/octet-stream"), 0 };
+		GString *path = vr->physical.path;
+		struct stat orig_st = st;
+
+		if (CORE_OPTION(LI_CORE_OPTION_STATIC_PRECOMPRESSED).boolean) {
+			liChunkFile *encoded_cf = NULL;
+
+			encoding = core_static_precompressed(vr, &orig_st, &encoded_path, &st, &encoded_cf, &res);
+			if (LI_HANDLER_WAIT_FOR_EVENT == res) {
+				/* the handler runs again, the file itself is a stat cache hit then */
+				li_chunkfile_release(cf);
+				if (NULL != encoded_path) g_string_free(encoded_path, TRUE);
+				return res;
+			}
+
+			if (-1 != encoding) {
+				if (CORE_OPTION(LI_CORE_OPTION_DEBUG_REQUEST_HANDLING).boolean) {
+					VR_DEBUG(vr, "serving precompressed file: '%s'", encoded_path->str);
+				}
+				li_chunkfile_release(cf);
+				cf = encoded_cf;
+				path = encoded_path;
+			} else {
+				st = orig_st;
+			}
+		}
 
 		if (!li_vrequest_handle_direct(vr)) {
-			close(fd);
+			li_chunkfile_release(cf);
+			if (NULL != encoded_path) g_string_free(encoded_path, TRUE);
 			return LI_HANDLER_ERROR;
 		}
 
-		li_etag_set_header(vr, &st, &cachable);
+		if (CORE_OPTION(LI_CORE_OPTION_STATIC_PRECOMPRESSED).boolean) {
+			/* the response depends on Accept-Encoding even if we didn't find a sibling for this client */
+			li_http_header_append(vr->response.headers, CONST_STR_LEN("Vary"), CONST_STR_LEN("Accept-Encoding"));
+		}
+
+		if (-1 != encoding) {
+			core_static_etag_encoded(vr, &orig_st, sced, core_static_encodings[encoding].encoding, &cachable);
+		} else if (NULL != sced) {
+			/* header values precomputed by the stat cache */
+			li_etag_set_header_values(vr, li_stat_cache_etag(vr, sced), sced->last_modified, &cachable);
+		} else {
+			li_etag_set_header(vr, &st, &cachable);
+		}
 		if (cachable) {
 			vr->response.http_status = 304;
-			close(fd);
+			li_chunkfile_release(cf);
+			if (NULL != encoded_path) g_string_free(encoded_path, TRUE);
 			return LI_HANDLER_GO_ON;
 		}
 
-		cf = li_chunkfile_new(NULL, fd, FALSE);
+		if (-1 != encoding) {
+			li_http_header_overwrite(vr->response.headers, CONST_STR_LEN("Content-Encoding"),
+				core_static_encodings[encoding].encoding, strlen(core_static_encodings[encoding].encoding));
+		}
 
-		mime_str = li_mimetype_get(vr, vr->physical.path);
+		mime_str = (NULL != sced) ? li_stat_cache_content_type(vr, sced) : li_mimetype_get(vr, vr->physical.path);
 		if (!mime_str) mime_str = &default_mime_str;
 
+		if (NULL != fc && NULL != cf && st.st_size > 0 && (gsize) st.st_size <= fc->max_file_size) {
+			if (NULL == (buf = li_file_cache_get(fc, path, &st))) {
+				buf = li_file_cache_load(fc, path, &st, cf->fd);
+			}
+		}
+
 		if (CORE_OPTION(LI_CORE_OPTION_STATIC_RANGE_REQUESTS).boolean) {
 			li_http_header_overwrite(vr->response.headers, CONST_STR_LEN("Accept-Ranges"), CONST_STR_LEN("bytes"));
 
-			hh_range = li_http_header_lookup(vr->request.headers, CONST_STR_LEN("range"));
+			hh_range = li_http_header_lookup_id(vr->request.headers, LI_HTTP_HEADER_RANGE);
 			if (hh_range) {
 				/* TODO: Check If-Range: header */
 				const GString range_str = li_const_gstring(LI_HEADER_VALUE_LEN(hh_range));
@@ -681,10 +855,10 @@ static liHandlerResult core_handle_static(liVRequest *vr, gpointer param, gpoint
 							GString *subheader = g_string_sized_new(1023);
 							g_string_append_printf(subheader, "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: %s\r\n\r\n", boundary, mime_str->str, vr->wrk->tmp_str->str);
 							li_chunkqueue_append_string(vr->direct_out, subheader);
-							li_chunkqueue_append_chunkfile(vr->direct_out, cf, rs.range_start, rs.range_length);
+							core_static_append(vr->direct_out, cf, buf, rs.range_start, rs.range_length);
 						} else {
 							li_http_header_overwrite(vr->response.headers, CONST_STR_LEN("Content-Range"), GSTR_LEN(vr->wrk->tmp_str));
-							li_chunkqueue_append_chunkfile(vr->direct_out, cf, rs.range_start, rs.range_length);
+							core_static_append(vr->direct_out, cf, buf, rs.range_start, rs.range_length);
 						}
 						break;
 					case LI_PARSE_HTTP_RANGE_DONE:
@@ -724,10 +898,12 @@ static liHandlerResult core_handle_static(liVRequest *vr, gpointer param, gpoint
 		if (!ranged_response) {
 			vr->response.http_status = 200;
 			li_http_header_overwrite(vr->response.headers, CONST_STR_LEN("Content-Type"), GSTR_LEN(mime_str));
-			li_chunkqueue_append_chunkfile(vr->direct_out, cf, 0, st.st_size);
+			core_static_append(vr->direct_out, cf, buf, 0, st.st_size);
 		}
 
+		if (NULL != buf) li_buffer_release(buf);
 		li_chunkfile_release(cf);
+		if (NULL != encoded_path) g_string_free(encoded_path, TRUE);
 	}
 
 	return LI_HANDLER_GO_ON;
@@ -857,18 +1033,18 @@ static void core_log_write_free(liServer *srv, gpointer param) {
 
 static liHandlerResult core_handle_log_write(liVRequest *vr, gpointer param, gpointer *context) {
 	liPattern *pattern = param;
-	GMatchInfo *match_info = NULL;
+	liRegexMatch *match = NULL;
 
 	if (vr->action_stack.regex_stack->len) {
 		GArray *rs = vr->action_stack.regex_stack;
-		match_info = g_array_index(rs, liActionRegexStackElement, rs->len - 1).match_info;
+		match = &g_array_index(rs, liActionRegexStackElement, rs->len - 1).match;
 	}
 
 	UNUSED(context);
 
 	/* eval pattern, ignore $n */
 	g_string_truncate(vr->wrk->tmp_str, 0);
-	li_pattern_eval(vr, vr->wrk->tmp_str, pattern, NULL, NULL, li_pattern_regex_cb, match_info);
+	li_pattern_eval(vr, vr->wrk->tmp_str, pattern, NULL, NULL, li_pattern_regex_cb, match);
 
 	VR_INFO(vr, "%s", vr->wrk->tmp_str->str);
 
@@ -997,17 +1173,17 @@ static void core_env_set_add_free(liServer *srv, gpointer param) {
 
 static liHandlerResult core_handle_env_set(liVRequest *vr, gpointer param, gpointer *context) {
 	env_set_add_ctx *ctx = param;
-	GMatchInfo *match_info = NULL;
+	liRegexMatch *match = NULL;
 
 	UNUSED(context);
 
 	if (vr->action_stack.regex_stack->len) {
 		GArray *rs = vr->action_stack.regex_stack;
-		match_info = g_array_index(rs, liActionRegexStackElement, rs->len - 1).match_info;
+		match = &g_array_index(rs, liActionRegexStackElement, rs->len - 1).match;
 	}
 
 	g_string_truncate(vr->wrk->tmp_str, 0);
-	li_pattern_eval(vr, vr->wrk->tmp_str, ctx->pattern, NULL, NULL, li_pattern_regex_cb, match_info);
+	li_pattern_eval(vr, vr->wrk->tmp_str, ctx->pattern, NULL, NULL, li_pattern_regex_cb, match);
 	li_environment_set(&vr->env, GSTR_LEN(ctx->key), GSTR_LEN(vr->wrk->tmp_str));
 
 	return LI_HANDLER_GO_ON;
@@ -1042,17 +1218,17 @@ static liAction* core_env_set(liServer *srv, liWorker *wrk, liPlugin* p, liValue
 
 static liHandlerResult core_handle_env_add(liVRequest *vr, gpointer param, gpointer *context) {
 	env_set_add_ctx *ctx = param;
-	GMatchInfo *match_info = NULL;
+	liRegexMatch *match = NULL;
 
 	UNUSED(context);
 
 	if (vr->action_stack.regex_stack->len) {
 		GArray *rs = vr->action_stack.regex_stack;
-		match_info = g_array_index(rs, liActionRegexStackElement, rs->len - 1).match_info;
+		match = &g_array_index(rs, liActionRegexStackElement, rs->len - 1).match;
 	}
 
 	g_string_truncate(vr->wrk->tmp_str, 0);
-	li_pattern_eval(vr, vr->wrk->tmp_str, ctx->pattern, NULL, NULL, li_pattern_regex_cb, match_info);
+	li_pattern_eval(vr, vr->wrk->tmp_str, ctx->pattern, NULL, NULL, li_pattern_regex_cb, match);
 	li_environment_insert(&vr->env, GSTR_LEN(ctx->key), GSTR_LEN(vr->wrk->tmp_str));
 
 	return LI_HANDLER_GO_ON;
@@ -1159,6 +1335,41 @@ fail:
 	return FALSE;
 }
 
+static void core_listen_reuseport_prepare(liServer *srv, gpointer data, gboolean aborted) {
+	GString *str = data;
+
+	if (!aborted) li_angel_listen_reuseport(srv, str);
+
+	g_string_free(str, TRUE);
+}
+
+static gboolean core_listen_reuseport(liServer *srv, liPlugin* p, liValue *val, gpointer userdata) {
+	UNUSED(p); UNUSED(userdata);
+
+	val = li_value_get_single_argument(val);
+
+	if (NULL == val) goto fail;
+
+	/* the sockets are requested once the worker count is known */
+	if (LI_VALUE_STRING == li_value_type(val)) {
+		li_server_register_prepare_cb(srv, core_listen_reuseport_prepare, g_string_new_len(GSTR_LEN(val->data.string)));
+	} else if (LI_VALUE_LIST == li_value_type(val)) {
+		LI_VALUE_FOREACH(ip, val);
+			if (LI_VALUE_STRING != li_value_type(ip)) goto fail;
+		LI_VALUE_END_FOREACH()
+		LI_VALUE_FOREACH(ip, val);
+			li_server_register_prepare_cb(srv, core_listen_reuseport_prepare, g_string_new_len(GSTR_LEN(ip->data.string)));
+		LI_VALUE_END_FOREACH()
+	} else {
+		goto fail;
+	}
+
+	return TRUE;
+
+fail:
+	ERROR(srv, "%s", "listen.reuseport expects a string or list of strings as parameter");
+	return FALSE;
+}
 
 static gboolean core_workers(liServer *srv, liPlugin* p, liValue *val, gpointer userdata) {
 	gint workers;
@@ -1272,6 +1483,42 @@ static gboolean core_io_timeout(liServer *srv, liPlugin* p, liValue *val, gpoint
 	return TRUE;
 }
 
+static gboolean core_io_write_backend(liServer *srv, liPlugin* p, liValue *val, gpointer userdata) {
+	const gchar *name;
+	UNUSED(p); UNUSED(userdata);
+
+	val = li_value_get_single_argument(val);
+
+	if (LI_VALUE_STRING != li_value_type(val)) {
+		ERROR(srv, "%s", "io.write_backend expects a string as parameter");
+		return FALSE;
+	}
+
+	name = val->data.string->str;
+
+	if (g_str_equal(name, "writev")) {
+		srv->network_backend = LI_NETWORK_BACKEND_WRITEV;
+	} else if (g_str_equal(name, "sendfile")) {
+#ifdef USE_SENDFILE
+		srv->network_backend = LI_NETWORK_BACKEND_SENDFILE;
+#else
+		ERROR(srv, "%s", "io.write_backend: sendfile is not supported on this platform");
+		return FALSE;
+#endif
+	} else if (g_str_equal(name, "io_uring")) {
+		if (!li_network_io_uring_supported()) {
+			ERROR(srv, "%s", "io.write_backend: lighttpd was compiled without io_uring support");
+			return FALSE;
+		}
+		srv->network_backend = LI_NETWORK_BACKEND_IO_URING;
+	} else {
+		ERROR(srv, "io.write_backend: unknown backend '%s', expected one of 'writev', 'sendfile' or 'io_uring'", name);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static gboolean core_stat_cache_ttl(liServer *srv, liPlugin* p, liValue *val, gpointer userdata) {
 	UNUSED(p); UNUSED(userdata);
 
@@ -1287,6 +1534,82 @@ static gboolean core_stat_cache_ttl(liServer *srv, liPlugin* p, liValue *val, gp
 	return TRUE;
 }
 
+static gboolean core_stat_cache_mime_type_xattr(liServer *srv, liPlugin* p, liValue *val, gpointer userdata) {
+	UNUSED(p); UNUSED(userdata);
+
+	val = li_value_get_single_argument(val);
+
+	if (LI_VALUE_BOOLEAN != li_value_type(val)) {
+		ERROR(srv, "%s", "stat_cache.mime_type_xattr expects a boolean as parameter");
+		return FALSE;
+	}
+
+#ifndef HAVE_SYS_XATTR_H
+	if (val->data.boolean) {
+		ERROR(srv, "%s", "stat_cache.mime_type_xattr: xattr support not available");
+		return FALSE;
+	}
+#endif
+
+	srv->stat_cache_mime_type_xattr = val->data.boolean;
+
+	return TRUE;
+}
+
+static gboolean core_static_memory_cache(liServer *srv, liPlugin* p, liValue *val, gpointer userdata) {
+	gint64 max_file_size = 16*1024, max_size = 64*1024*1024;
+	UNUSED(p); UNUSED(userdata);
+
+	val = li_value_get_single_argument(val);
+
+	if (LI_VALUE_BOOLEAN == li_value_type(val)) {
+		if (!val->data.boolean) {
+			li_file_cache_free(srv->file_cache);
+			srv->file_cache = NULL;
+			return TRUE;
+		}
+	} else if (NULL == (val = li_value_to_key_value_list(val))) {
+		ERROR(srv, "%s", "static.memory_cache expects a boolean or a hash/key-value list as parameter");
+		return FALSE;
+	} else {
+		LI_VALUE_FOREACH(entry, val)
+			liValue *entryKey = li_value_list_at(entry, 0);
+			liValue *entryValue = li_value_list_at(entry, 1);
+			GString *entryKeyStr;
+
+			if (LI_VALUE_STRING != li_value_type(entryKey)) {
+				ERROR(srv, "%s", "static.memory_cache doesn't take default keys");
+				return FALSE;
+			}
+			entryKeyStr = entryKey->data.string; /* keys are either NONE or STRING */
+
+			if (LI_VALUE_NUMBER != li_value_type(entryValue) || entryValue->data.number <= 0) {
+				ERROR(srv, "static.memory_cache option '%s' expects positive integer as parameter", entryKeyStr->str);
+				return FALSE;
+			}
+
+			if (g_str_equal(entryKeyStr->str, "max-file-size")) {
+				max_file_size = entryValue->data.number;
+			} else if (g_str_equal(entryKeyStr->str, "max-size")) {
+				max_size = entryValue->data.number;
+			} else {
+				ERROR(srv, "unknown option for static.memory_cache '%s'", entryKeyStr->str);
+				return FALSE;
+			}
+		LI_VALUE_END_FOREACH()
+	}
+
+	if (max_file_size > max_size) {
+		ERROR(srv, "%s", "static.memory_cache: max-file-size must not be larger than max-size");
+		return FALSE;
+	}
+
+	li_file_cache_free(srv->file_cache);
+	srv->file_cache = li_file_cache_new(max_file_size, max_size);
+
+	return TRUE;
+}
+
 static gboolean core_tasklet_pool_threads(liServer *srv, liPlugin* p, liValue *val, gpointer userdata) {
 	UNUSED(p); UNUSED(userdata);
 
@@ -1569,17 +1892,17 @@ static void core_header_free(liServer *srv, gpointer param) {
 
 static liHandlerResult core_handle_header(liVRequest *vr, gpointer param, gpointer *context) {
 	header_ctx *ctx = param;
-	GMatchInfo *match_info = NULL;
+	liRegexMatch *match = NULL;
 
 	UNUSED(context);
 
 	if (vr->action_stack.regex_stack->len) {
 		GArray *rs = vr->action_stack.regex_stack;
-		match_info = g_array_index(rs, liActionRegexStackElement, rs->len - 1).match_info;
+		match = &g_array_index(rs, liActionRegexStackElement, rs->len - 1).match;
 	}
 
 	g_string_truncate(vr->wrk->tmp_str, 0);
-	li_pattern_eval(vr, vr->wrk->tmp_str, ctx->value, NULL, NULL, li_pattern_regex_cb, match_info);
+	li_pattern_eval(vr, vr->wrk->tmp_str, ctx->value, NULL, NULL, li_pattern_regex_cb, match);
 
 	ctx->cb(ctx->use_req_header ? vr->request.headers : vr->response.headers, GSTR_LEN(ctx->key), GSTR_LEN(vr->wrk->tmp_str));
 
@@ -2037,6 +2360,7 @@ static const liPluginOption options[] = {
 	{ "debug.log_request_handling", LI_VALUE_BOOLEAN, FALSE, NULL },
 
 	{ "static.range_requests", LI_VALUE_BOOLEAN, TRUE, NULL },
+	{ "static.precompressed", LI_VALUE_BOOLEAN, FALSE, NULL },
 
 	{ "keepalive.timeout", LI_VALUE_NUMBER, 5, NULL },
 	{ "keepalive.requests", LI_VALUE_NUMBER, 0, NULL },
@@ -2104,11 +2428,15 @@ static const liPluginAction actions[] = {
 
 static const liPluginSetup setups[] = {
 	{ "listen", core_listen, NULL },
+	{ "listen.reuseport", core_listen_reuseport, NULL },
 	{ "workers", core_workers, NULL },
 	{ "workers.cpu_affinity", core_workers_cpu_affinity, NULL },
 	{ "module_load", core_module_load, NULL },
 	{ "io.timeout", core_io_timeout, NULL },
+	{ "io.write_backend", core_io_write_backend, NULL },
 	{ "stat_cache.ttl", core_stat_cache_ttl, NULL },
+	{ "stat_cache.mime_type_xattr", core_stat_cache_mime_type_xattr, NULL },
+	{ "static.memory_cache", core_static_memory_cache, NULL },
 	{ "tasklet_pool.threads", core_tasklet_pool_threads, NULL },
 	{ "log", core_setup_log, NULL },
 	{ "log.timestamp", core_setup_log_timestamp, NULL },
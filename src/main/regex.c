@@ -0,0 +1,469 @@
+
+#include <lighttpd/base.h>
+
+#ifdef HAVE_PCRE2
+# define PCRE2_CODE_UNIT_WIDTH 8
+# include <pcre2.h>
+#endif
+
+/* initial size of the per-worker match data; grows for patterns with more groups */
+#define REGEX_MATCH_PAIRS 16
+
+#define REGEX_JIT_STACK_MIN (32*1024)
+#define REGEX_JIT_STACK_MAX (512*1024)
+
+struct liRegex {
+	gchar *pattern;
+	guint pairs; /* capture groups + 1 */
+#ifdef HAVE_PCRE2
+	pcre2_code *code;
+	gboolean jit;
+#else
+	GRegex *regex;
+#endif
+};
+
+struct liRegexMatchData {
+#ifdef HAVE_PCRE2
+	pcre2_match_data *md;
+	pcre2_match_context *ctx;
+	pcre2_jit_stack *jit_stack;
+#else
+	GArray *ovector; /* gsize */
+#endif
+	guint pairs;
+};
+
+GQuark li_regex_error_quark(void) {
+	return g_quark_from_static_string("li-regex-error-quark");
+}
+
+liRegex* li_regex_new(const gchar *pattern, GError **err) {
+	liRegex *regex;
+#ifdef HAVE_PCRE2
+	pcre2_code *code;
+	int errcode;
+	PCRE2_SIZE erroffset;
+	uint32_t capture_count = 0;
+
+	/* no PCRE2_UTF: match raw bytes */
+	code = pcre2_compile((PCRE2_SPTR) pattern, PCRE2_ZERO_TERMINATED, 0, &errcode, &erroffset, NULL);
+	if (NULL == code) {
+		PCRE2_UCHAR msg[256];
+		pcre2_get_error_message(errcode, msg, sizeof(msg));
+		g_set_error(err, LI_REGEX_ERROR, errcode, "%s at offset %" G_GSIZE_FORMAT, (const gchar*) msg, (gsize) erroffset);
+		return NULL;
+	}
+
+	pcre2_pattern_info(code, PCRE2_INFO_CAPTURECOUNT, &capture_count);
+
+	regex = g_slice_new0(liRegex);
+	regex->code = code;
+	/* without jit support (or if it fails for this pattern) pcre2_match uses the interpreter */
+	regex->jit = (0 == pcre2_jit_compile(code, PCRE2_JIT_COMPLETE));
+	regex->pairs = capture_count + 1;
+#else
+	GRegex *re;
+
+	re = g_regex_new(pattern, G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, err);
+	if (NULL == re) return NULL;
+
+	regex = g_slice_new0(liRegex);
+	regex->regex = re;
+	regex->pairs = g_regex_get_capture_count(re) + 1;
+#endif
+
+	regex->pattern = g_strdup(pattern);
+
+	return regex;
+}
+
+void li_regex_free(liRegex *regex) {
+	if (NULL == regex) return;
+
+#ifdef HAVE_PCRE2
+	pcre2_code_free(regex->code);
+#else
+	g_regex_unref(regex->regex);
+#endif
+	g_free(regex->pattern);
+
+	g_slice_free(liRegex, regex);
+}
+
+const gchar* li_regex_get_pattern(liRegex *regex) {
+	return regex->pattern;
+}
+
+gboolean li_regex_is_jit(liRegex *regex) {
+#ifdef HAVE_PCRE2
+	return regex->jit;
+#else
+	UNUSED(regex);
+	return FALSE;
+#endif
+}
+
+const gchar* li_regex_impl(void) {
+#ifdef HAVE_PCRE2
+	return "pcre2";
+#else
+	return "glib";
+#endif
+}
+
+liRegexMatchData* li_regex_match_data_new(void) {
+	liRegexMatchData *md = g_slice_new0(liRegexMatchData);
+
+	md->pairs = REGEX_MATCH_PAIRS;
+#ifdef HAVE_PCRE2
+	md->md = pcre2_match_data_create(md->pairs, NULL);
+	md->ctx = pcre2_match_context_create(NULL);
+	/* the default jit stack is only 32k on the machine stack */
+	md->jit_stack = pcre2_jit_stack_create(REGEX_JIT_STACK_MIN, REGEX_JIT_STACK_MAX, NULL);
+	if (NULL != md->jit_stack) pcre2_jit_stack_assign(md->ctx, NULL, md->jit_stack);
+#else
+	md->ovector = g_array_sized_new(FALSE, FALSE, sizeof(gsize), 2 * md->pairs);
+#endif
+
+	return md;
+}
+
+void li_regex_match_data_free(liRegexMatchData *md) {
+	if (NULL == md) return;
+
+#ifdef HAVE_PCRE2
+	pcre2_match_data_free(md->md);
+	pcre2_match_context_free(md->ctx);
+	if (NULL != md->jit_stack) pcre2_jit_stack_free(md->jit_stack);
+#else
+	g_array_free(md->ovector, TRUE);
+#endif
+
+	g_slice_free(liRegexMatchData, md);
+}
+
+gboolean li_regex_match(liRegex *regex, liRegexMatchData *md, const gchar *subject, gsize len, liRegexMatch *match) {
+#ifdef HAVE_PCRE2
+	int rc;
+
+	if (G_UNLIKELY(regex->pairs > md->pairs)) {
+		/* otherwise pcre2_match only reports the first md->pairs groups */
+		pcre2_match_data_free(md->md);
+		md->pairs = regex->pairs;
+		md->md = pcre2_match_data_create(md->pairs, NULL);
+	}
+
+	rc = pcre2_match(regex->code, (PCRE2_SPTR) subject, len, 0, 0, md->md, md->ctx);
+	/* PCRE2_ERROR_NOMATCH, or an error like hitting the match limit: treat both as no match, as GRegex did */
+	if (rc <= 0) return FALSE;
+
+	if (NULL != match) {
+		match->subject = subject;
+		match->count = rc;
+		match->ovector = pcre2_get_ovector_pointer(md->md);
+	}
+
+	return TRUE;
+#else
+	GMatchInfo *match_info = NULL;
+	gint i, count;
+
+	if (!g_regex_match_full(regex->regex, subject, len, 0, 0, NULL != match ? &match_info : NULL, NULL)) {
+		if (NULL != match_info) g_match_info_free(match_info);
+		return FALSE;
+	}
+
+	if (NULL != match) {
+		count = g_match_info_get_match_count(match_info);
+		if ((guint) count > md->pairs) md->pairs = count;
+		g_array_set_size(md->ovector, 2 * count);
+
+		for (i = 0; i < count; i++) {
+			gint start_pos, end_pos;
+			gsize *pair = &g_array_index(md->ovector, gsize, 2 * i);
+
+			if (g_match_info_fetch_pos(match_info, i, &start_pos, &end_pos) && start_pos >= 0) {
+				pair[0] = start_pos;
+				pair[1] = end_pos;
+			} else {
+				pair[0] = pair[1] = LI_REGEX_UNSET;
+			}
+		}
+
+		match->subject = subject;
+		match->count = count;
+		match->ovector = (gsize*) md->ovector->data;
+	}
+
+	if (NULL != match_info) g_match_info_free(match_info);
+
+	return TRUE;
+#endif
+}
+
+gboolean li_regex_match_fetch_pos(const liRegexMatch *match, guint n, gsize *start, gsize *end) {
+	if (n >= match->count || LI_REGEX_UNSET == match->ovector[2*n]) return FALSE;
+
+	*start = match->ovector[2*n];
+	*end = match->ovector[2*n+1];
+
+	return TRUE;
+}
+
+void li_regex_match_copy(liRegexMatch *dest, const liRegexMatch *src, const gchar *subject) {
+	dest->subject = subject;
+	dest->count = src->count;
+	dest->ovector = (0 != src->count) ? g_slice_copy(2 * src->count * sizeof(gsize), src->ovector) : NULL;
+}
+
+void li_regex_match_clear(liRegexMatch *match) {
+	if (NULL != match->ovector) g_slice_free1(2 * match->count * sizeof(gsize), match->ovector);
+
+	match->subject = NULL;
+	match->count = 0;
+	match->ovector = NULL;
+}
+
+/* skips a character class starting at c ('['), returns the position after the closing ']' or NULL */
+static const gchar* regex_skip_class(const gchar *c) {
+	c++;
+	if ('^' == *c) c++;
+	if (']' == *c) c++; /* a leading ']' is a literal */
+
+	for (;;) {
+		switch (*c) {
+		case '\0':
+			return NULL;
+		case '\\':
+			if ('\0' == c[1]) return NULL;
+			c += 2;
+			break;
+		case '[':
+			if (':' == c[1]) {
+				/* posix class like [:alpha:] */
+				const gchar *end = strstr(c + 2, ":]");
+				if (NULL == end) return NULL;
+				c = end + 2;
+			} else {
+				c++;
+			}
+			break;
+		case ']':
+			return c + 1;
+		default:
+			c++;
+			break;
+		}
+	}
+}
+
+/* skips a group starting at c ('('), returns the position after the closing ')' or NULL */
+static const gchar* regex_skip_group(const gchar *c) {
+	guint depth = 0;
+
+	for (;;) {
+		switch (*c) {
+		case '\0':
+			return NULL;
+		case '\\':
+			if ('\0' == c[1]) return NULL;
+			c += 2;
+			break;
+		case '[':
+			if (NULL == (c = regex_skip_class(c))) return NULL;
+			break;
+		case '(':
+			depth++;
+			c++;
+			break;
+		case ')':
+			c++;
+			if (0 == --depth) return c;
+			break;
+		default:
+			c++;
+			break;
+		}
+	}
+}
+
+/* skips an escape with a letter or digit starting at c ('\\'), returns the position after it (and its arguments) or NULL */
+static const gchar* regex_skip_escape(const gchar *c) {
+	const gchar *p = c + 2;
+
+	switch (c[1]) {
+	case 'c':
+		return ('\0' != *p) ? p + 1 : NULL;
+	case 'x':
+	case 'o':
+	case 'p':
+	case 'P':
+	case 'N':
+	case 'g':
+	case 'k':
+		switch (*p) {
+		case '{':
+			p = strchr(p, '}');
+			return (NULL != p) ? p + 1 : NULL;
+		case '<':
+			p = strchr(p, '>');
+			return (NULL != p) ? p + 1 : NULL;
+		case '\'':
+			p = strchr(p + 1, '\'');
+			return (NULL != p) ? p + 1 : NULL;
+		}
+		if ('x' == c[1]) {
+			if (g_ascii_isxdigit(*p)) p++;
+			if (g_ascii_isxdigit(*p)) p++;
+		} else if ('p' == c[1] || 'P' == c[1]) {
+			if ('\0' == *p) return NULL;
+			p++;
+		} else if ('g' == c[1]) {
+			if ('-' == *p || '+' == *p) p++;
+			while (g_ascii_isdigit(*p)) p++;
+		}
+		return p;
+	default:
+		/* back references and octal codes */
+		if (g_ascii_isdigit(c[1])) {
+			while (g_ascii_isdigit(*p)) p++;
+		}
+		return p;
+	}
+}
+
+/* the quantifier at c: 0 none, 1 optional ('?', '*', '{...}'), 2 at least once ('+'), 3 unknown;
+ * *next is the position after it
+ */
+static guint regex_quantifier(const gchar *c, const gchar **next) {
+	guint q;
+
+	switch (*c) {
+	case '?':
+	case '*':
+		q = 1;
+		c++;
+		break;
+	case '+':
+		q = 2;
+		c++;
+		break;
+	case '{':
+		/* {n}, {n,}, {n,m} or {,m}; for anything else we'd have to know whether pcre reads it as literal '{' */
+		{
+			const gchar *p = c + 1;
+			while (g_ascii_isdigit(*p) || ',' == *p || ' ' == *p) p++;
+			if ('}' != *p) return 3;
+			q = 1; /* even {n} would need the repeated string */
+			c = p + 1;
+		}
+		break;
+	default:
+		return 0;
+	}
+
+	/* lazy or possessive */
+	if ('?' == *c || '+' == *c) c++;
+
+	*next = c;
+	return q;
+}
+
+static void regex_literal_take(GString **best, GString *run) {
+	if (run->len > 0 && (NULL == *best || run->len > (*best)->len)) {
+		if (NULL == *best) *best = g_string_sized_new(run->len);
+		g_string_assign(*best, run->str);
+	}
+	g_string_truncate(run, 0);
+}
+
+GString* li_regex_required_literal(liRegex *regex) {
+	const gchar *pattern = regex->pattern, *c;
+	GString *best = NULL, *run;
+
+	/* option settings (like (?i) or (?x)), verbs and \Q...\E quoting change how the rest is read; don't follow them */
+	for (c = pattern; NULL != (c = strchr(c, '(')); c++) {
+		if ('*' == c[1]) return NULL;
+		if ('?' == c[1] && NULL == strchr(":=!<>", c[2])) return NULL;
+	}
+	if (NULL != strstr(pattern, "\\Q")) return NULL;
+
+	run = g_string_sized_new(15);
+
+	for (c = pattern; '\0' != *c; ) {
+		const gchar *next;
+		gboolean literal = FALSE;
+		gchar ch = '\0';
+
+		switch (*c) {
+		case '|':
+			/* alternatives on the top level: nothing is required */
+			goto none;
+		case ')':
+		case '?':
+		case '*':
+		case '+':
+			goto none;
+		case '(':
+			if (NULL == (next = regex_skip_group(c))) goto none;
+			break;
+		case '[':
+			if (NULL == (next = regex_skip_class(c))) goto none;
+			break;
+		case '\\':
+			if ('\0' == c[1]) goto none;
+			if (g_ascii_isalnum(c[1])) {
+				/* character types, anchors, back references, escaped codes */
+				if (NULL == (next = regex_skip_escape(c))) goto none;
+			} else {
+				literal = TRUE;
+				ch = c[1];
+				next = c + 2;
+			}
+			break;
+		case '.':
+		case '^':
+		case '$':
+			next = c + 1;
+			break;
+		default:
+			literal = TRUE;
+			ch = *c;
+			next = c + 1;
+			break;
+		}
+
+		c = next;
+
+		switch (regex_quantifier(c, &next)) {
+		case 0:
+			if (literal) {
+				g_string_append_c(run, ch);
+			} else {
+				regex_literal_take(&best, run);
+			}
+			break;
+		case 1:
+			regex_literal_take(&best, run);
+			c = next;
+			break;
+		case 2:
+			if (literal) g_string_append_c(run, ch);
+			regex_literal_take(&best, run);
+			c = next;
+			break;
+		default:
+			goto none;
+		}
+	}
+
+	regex_literal_take(&best, run);
+	g_string_free(run, TRUE);
+	return best;
+
+none:
+	g_string_free(run, TRUE);
+	if (NULL != best) g_string_free(best, TRUE);
+	return NULL;
+}
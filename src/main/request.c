@@ -105,8 +105,7 @@ static gboolean request_parse_url(liVRequest *vr) {
 	if (0 == strcmp(req->uri.path->str, "*") && req->http_method != LI_HTTP_METHOD_OPTIONS)
 		return FALSE;
 
-	li_url_decode(req->uri.path);
-	li_path_simplify(req->uri.path);
+	li_url_decode_path_simplify(req->uri.path);
 
 	if (0 == req->uri.raw_orig_path->len) {
 		g_string_append_len(req->uri.raw_orig_path, GSTR_LEN(req->uri.raw_path)); /* save orig raw uri */
@@ -147,9 +146,9 @@ gboolean li_request_validate_header(liConnection *con) {
 	}
 
 	/* get hostname */
-	l = li_http_header_find_first(req->headers, CONST_STR_LEN("host"));
+	l = li_http_header_find_first_id(req->headers, LI_HTTP_HEADER_HOST);
 	if (NULL != l) {
-		if (NULL != li_http_header_find_next(l, CONST_STR_LEN("host"))) {
+		if (NULL != li_http_header_find_next_id(l, LI_HTTP_HEADER_HOST)) {
 			/* more than one "host" header */
 			bad_request(con, 400); /* bad request */
 			return FALSE;
@@ -187,7 +186,7 @@ gboolean li_request_validate_header(liConnection *con) {
 	}
 
 	/* content-length */
-	hh = li_http_header_lookup(req->headers, CONST_STR_LEN("content-length"));
+	hh = li_http_header_lookup_id(req->headers, LI_HTTP_HEADER_CONTENT_LENGTH);
 	if (hh) {
 		const gchar *val = LI_HEADER_VALUE(hh);
 		gint64 r;
@@ -223,9 +222,9 @@ gboolean li_request_validate_header(liConnection *con) {
 	}
 
 	/* Transfer-Encoding: chunked */
-	l = li_http_header_find_first(req->headers, CONST_STR_LEN("transfer-encoding"));
+	l = li_http_header_find_first_id(req->headers, LI_HTTP_HEADER_TRANSFER_ENCODING);
 	if (l) {
-		for ( ; l ; l = li_http_header_find_next(l, CONST_STR_LEN("transfer-encoding")) ) {
+		for ( ; l ; l = li_http_header_find_next_id(l, LI_HTTP_HEADER_TRANSFER_ENCODING) ) {
 			hh = (liHttpHeader*) l->data;
 			if (0 == g_ascii_strcasecmp( LI_HEADER_VALUE(hh), "identity" )) {
 				/* ignore */
@@ -247,11 +246,11 @@ gboolean li_request_validate_header(liConnection *con) {
 	}
 
 	/* Expect: 100-continue */
-	l = li_http_header_find_first(req->headers, CONST_STR_LEN("expect"));
+	l = li_http_header_find_first_id(req->headers, LI_HTTP_HEADER_EXPECT);
 	if (l) {
 		gboolean expect_100_cont = FALSE;
 
-		for ( ; l ; l = li_http_header_find_next(l, CONST_STR_LEN("expect")) ) {
+		for ( ; l ; l = li_http_header_find_next_id(l, LI_HTTP_HEADER_EXPECT) ) {
 			hh = (liHttpHeader*) l->data;
 			if (0 == g_ascii_strcasecmp( LI_HEADER_VALUE(hh), "100-continue" )) {
 				expect_100_cont = TRUE;
@@ -24,8 +24,203 @@ void li_response_clear(liResponse *resp) {
 
 static void li_response_send_error_page(liVRequest *vr, liChunkQueue *response_body);
 
+#define RESPONSE_HEADER_BUF_SIZE (16*1024)
+
+liResponseWriter* li_response_writer_new(void) {
+	liResponseWriter *rw = g_slice_new0(liResponseWriter);
+
+	rw->date_line = g_string_sized_new(63);
+	rw->server_line = g_string_sized_new(63);
+
+	return rw;
+}
+
+void li_response_writer_free(liResponseWriter *rw) {
+	guint v, i;
+
+	if (NULL == rw) return;
+
+	li_buffer_release(rw->buf);
+	g_string_free(rw->date_line, TRUE);
+	g_string_free(rw->server_line, TRUE);
+	for (v = 0; v < 2; v++) {
+		for (i = 0; i < 500; i++) {
+			if (NULL != rw->status_lines[v][i]) g_string_free(rw->status_lines[v][i], TRUE);
+		}
+	}
+
+	g_slice_free(liResponseWriter, rw);
+}
+
+static void response_status_line(GString *line, gboolean http_1_1, gint status) {
+	guint len;
+	gchar status_str[4];
+	gchar *str = li_http_status_string(status, &len);
+
+	if (http_1_1) {
+		g_string_append_len(line, CONST_STR_LEN("HTTP/1.1 "));
+	} else {
+		g_string_append_len(line, CONST_STR_LEN("HTTP/1.0 "));
+	}
+	li_http_status_to_str(status, status_str);
+	status_str[3] = ' ';
+	g_string_append_len(line, status_str, 4);
+	g_string_append_len(line, str, len);
+	g_string_append_len(line, CONST_STR_LEN("\r\n"));
+}
+
+/* returns the cached status line; statuses >= 600 are written to tmp */
+static GString* response_writer_status_line(liResponseWriter *rw, gboolean http_1_1, gint status, GString *tmp) {
+	GString **line;
+
+	if (status >= 600) {
+		g_string_truncate(tmp, 0);
+		response_status_line(tmp, http_1_1, status);
+		return tmp;
+	}
+
+	line = &rw->status_lines[http_1_1 ? 1 : 0][status - 100];
+	if (NULL == *line) {
+		*line = g_string_sized_new(63);
+		response_status_line(*line, http_1_1, status);
+	}
+
+	return *line;
+}
+
+static GString* response_writer_date_line(liResponseWriter *rw, liWorker *wrk) {
+	time_t now = (time_t) li_cur_ts(wrk);
+
+	if (now != rw->date_ts || 0 == rw->date_line->len) {
+		GString *d = li_worker_current_timestamp(wrk, LI_GMTIME, LI_TS_FORMAT_HEADER);
+
+		g_string_truncate(rw->date_line, 0);
+		if (NULL != d) {
+			g_string_append_len(rw->date_line, CONST_STR_LEN("Date: "));
+			g_string_append_len(rw->date_line, GSTR_LEN(d));
+			g_string_append_len(rw->date_line, CONST_STR_LEN("\r\n"));
+		}
+		rw->date_ts = now;
+	}
+
+	return rw->date_line;
+}
+
+static GString* response_writer_server_line(liResponseWriter *rw, GString *tag) {
+	GString *line = rw->server_line;
+
+	if (0 == tag->len) return NULL;
+
+	/* "Server: " + tag + "\r\n" */
+	if (line->len != tag->len + 10 || 0 != memcmp(line->str + 8, tag->str, tag->len)) {
+		g_string_truncate(line, 0);
+		g_string_append_len(line, CONST_STR_LEN("Server: "));
+		g_string_append_len(line, GSTR_LEN(tag));
+		g_string_append_len(line, CONST_STR_LEN("\r\n"));
+	}
+
+	return line;
+}
+
+/* space for len bytes in the shared buffer of the worker; NULL if the headers don't fit in a fresh buffer */
+static liBuffer* response_writer_buffer(liResponseWriter *rw, gsize len) {
+	liBuffer *buf = rw->buf;
+
+	if (NULL != buf) {
+		/* all responses using the buffer are sent, start from the beginning */
+		if (1 == g_atomic_int_get(&buf->refcount)) buf->used = 0;
+
+		if (buf->alloc_size - buf->used >= len) return buf;
+
+		li_buffer_release(buf);
+		rw->buf = NULL;
+	}
+
+	if (len > RESPONSE_HEADER_BUF_SIZE) return NULL;
+
+	return rw->buf = li_buffer_new(RESPONSE_HEADER_BUF_SIZE);
+}
+
+#define RESPONSE_WRITE(p, s, len) do { memcpy(p, s, len); p += len; } while (0)
+
+static void response_write_headers(liVRequest *vr, liChunkQueue *raw_out, gboolean upgraded) {
+	liResponseWriter *rw = vr->wrk->response_writer;
+	gboolean http_1_1 = (vr->request.http_version == LI_HTTP_VERSION_1_1);
+	GString *status_line, *date_line = NULL, *server_line = NULL;
+	const gchar *connection = NULL;
+	gsize connection_len = 0, len, offset;
+	gboolean have_date = FALSE, have_server = FALSE;
+	liHttpHeader *header;
+	GList *iter;
+	liBuffer *buf;
+	gchar *p;
+
+	status_line = response_writer_status_line(rw, http_1_1, vr->response.http_status, vr->wrk->tmp_str);
+
+	/* connection header, if needed. connection entries in the list are ignored below, send them directly */
+	if (upgraded) {
+		connection = "Connection: Upgrade\r\n";
+	} else if (http_1_1) {
+		if (!vr->coninfo->keep_alive) connection = "Connection: close\r\n";
+	} else {
+		if (vr->coninfo->keep_alive) connection = "Connection: keep-alive\r\n";
+	}
+	if (NULL != connection) connection_len = strlen(connection);
+
+	/* first pass: size */
+	len = status_line->len + connection_len + 2;
+	for (iter = g_queue_peek_head_link(&vr->response.headers->entries); iter; iter = g_list_next(iter)) {
+		header = (liHttpHeader*) iter->data;
+		/* ignore connection headers from backends. set con->info.keep_alive = FALSE to disable keep-alive */
+		if (LI_HTTP_HEADER_CONNECTION == header->id) continue;
+		len += header->data->len + 2;
+		if (LI_HTTP_HEADER_DATE == header->id) have_date = TRUE;
+		if (LI_HTTP_HEADER_SERVER == header->id) have_server = TRUE;
+	}
+
+	if (!have_date) {
+		/* HTTP/1.1 requires a Date: header */
+		date_line = response_writer_date_line(rw, vr->wrk);
+		len += date_line->len;
+	}
+
+	if (!have_server) {
+		server_line = response_writer_server_line(rw, CORE_OPTIONPTR(LI_CORE_OPTION_SERVER_TAG).string);
+		if (NULL != server_line) len += server_line->len;
+	}
+
+	if (NULL != (buf = response_writer_buffer(rw, len))) {
+		li_buffer_acquire(buf);
+	} else {
+		/* huge headers: use a buffer only for this response */
+		buf = li_buffer_new(len);
+	}
+
+	/* second pass: write */
+	p = buf->addr + buf->used;
+	RESPONSE_WRITE(p, status_line->str, status_line->len);
+	if (NULL != connection) RESPONSE_WRITE(p, connection, connection_len);
+	for (iter = g_queue_peek_head_link(&vr->response.headers->entries); iter; iter = g_list_next(iter)) {
+		header = (liHttpHeader*) iter->data;
+		if (LI_HTTP_HEADER_CONNECTION == header->id) continue;
+		RESPONSE_WRITE(p, header->data->str, header->data->len);
+		RESPONSE_WRITE(p, "\r\n", 2);
+	}
+	if (NULL != date_line) RESPONSE_WRITE(p, date_line->str, date_line->len);
+	if (NULL != server_line) RESPONSE_WRITE(p, server_line->str, server_line->len);
+	RESPONSE_WRITE(p, "\r\n", 2);
+
+	LI_FORCE_ASSERT((gsize) (p - (buf->addr + buf->used)) == len);
+
+	/* the chunk has to be within buf->used */
+	offset = buf->used;
+	buf->used += len;
+	li_chunkqueue_append_buffer2(raw_out, buf, offset, len);
+}
+
+#undef RESPONSE_WRITE
+
 void li_response_send_headers(liVRequest *vr, liChunkQueue *raw_out, liChunkQueue *response_body, gboolean upgraded) {
-	GString *head;
 	gboolean have_real_body, response_complete;
 	liChunkQueue *tmp_cq = NULL;
 
@@ -39,8 +234,6 @@ void li_response_send_headers(liVRequest *vr, liChunkQueue *raw_out, liChunkQueu
 	have_real_body = (NULL != response_body) && ((response_body->length > 0) || !response_body->is_closed);
 	response_complete = (NULL != response_body) && response_body->is_closed;
 
-	head = g_string_sized_new(8*1024-1);
-
 	if (!have_real_body && vr->response.http_status >= 400 && vr->response.http_status < 600) {
 		tmp_cq = li_chunkqueue_new(); /* create a temporary cq for the response body */
 		response_body = tmp_cq;
@@ -78,72 +271,7 @@ void li_response_send_headers(liVRequest *vr, liChunkQueue *raw_out, liChunkQueu
 		if (!upgraded) raw_out->is_closed = TRUE;
 	}
 
-	/* Status line */
-	if (vr->request.http_version == LI_HTTP_VERSION_1_1) {
-		g_string_append_len(head, CONST_STR_LEN("HTTP/1.1 "));
-	} else {
-		g_string_append_len(head, CONST_STR_LEN("HTTP/1.0 "));
-	}
-
-	{
-		guint len;
-		gchar status_str[4];
-		gchar *str = li_http_status_string(vr->response.http_status, &len);
-		li_http_status_to_str(vr->response.http_status, status_str);
-		status_str[3] = ' ';
-		g_string_append_len(head, status_str, 4);
-		g_string_append_len(head, str, len);
-		g_string_append_len(head, CONST_STR_LEN("\r\n"));
-	}
-
-	/* connection header, if needed. connection entries in the list are ignored below, send them directly */
-	if (upgraded) {
-		g_string_append_len(head, CONST_STR_LEN("Connection: Upgrade\r\n"));
-	} else if (vr->request.http_version == LI_HTTP_VERSION_1_1) {
-		if (!vr->coninfo->keep_alive)
-			g_string_append_len(head, CONST_STR_LEN("Connection: close\r\n"));
-	} else {
-		if (vr->coninfo->keep_alive)
-			g_string_append_len(head, CONST_STR_LEN("Connection: keep-alive\r\n"));
-	}
-
-	/* Append headers */
-	{
-		liHttpHeader *header;
-		GList *iter;
-		gboolean have_date = FALSE, have_server = FALSE;
-
-		for (iter = g_queue_peek_head_link(&vr->response.headers->entries); iter; iter = g_list_next(iter)) {
-			header = (liHttpHeader*) iter->data;
-			/* ignore connection headers from backends. set con->info.keep_alive = FALSE to disable keep-alive */
-			if (li_http_header_key_is(header, CONST_STR_LEN("connection"))) continue;
-			g_string_append_len(head, GSTR_LEN(header->data));
-			g_string_append_len(head, CONST_STR_LEN("\r\n"));
-			if (!have_date && li_http_header_key_is(header, CONST_STR_LEN("date"))) have_date = TRUE;
-			if (!have_server && li_http_header_key_is(header, CONST_STR_LEN("server"))) have_server = TRUE;
-		}
-
-		if (!have_date) {
-			GString *d = li_worker_current_timestamp(vr->wrk, LI_GMTIME, LI_TS_FORMAT_HEADER);
-			/* HTTP/1.1 requires a Date: header */
-			g_string_append_len(head, CONST_STR_LEN("Date: "));
-			g_string_append_len(head, GSTR_LEN(d));
-			g_string_append_len(head, CONST_STR_LEN("\r\n"));
-		}
-
-		if (!have_server) {
-			GString *tag = CORE_OPTIONPTR(LI_CORE_OPTION_SERVER_TAG).string;
-
-			if (tag->len) {
-				g_string_append_len(head, CONST_STR_LEN("Server: "));
-				g_string_append_len(head, GSTR_LEN(tag));
-				g_string_append_len(head, CONST_STR_LEN("\r\n"));
-			}
-		}
-	}
-
-	g_string_append_len(head, CONST_STR_LEN("\r\n"));
-	li_chunkqueue_append_string(raw_out, head);
+	response_write_headers(vr, raw_out, upgraded);
 
 	if (NULL != tmp_cq) {
 		li_chunkqueue_steal_all(raw_out, tmp_cq);
@@ -16,13 +16,19 @@ static void li_server_stop(liServer *srv);
 static void state_ready_cb(liEventBase *watcher, int events);
 static void li_server_1sec_timer(liEventBase *watcher, int events);
 
-static liServerSocket* server_socket_new(liServer *srv, int fd) {
+static liServerSocket* server_socket_new(liServer *srv, liWorker *wrk, int fd) {
 	liServerSocket *sock = g_slice_new0(liServerSocket);
 
 	sock->local_addr = li_sockaddr_local_from_socket(fd);
 	sock->refcount = 1;
+	sock->wrk = wrk;
 	li_fd_no_block(fd);
-	li_event_io_init(&srv->main_worker->loop, "server socket", &sock->watcher, li_server_listen_cb, fd, LI_EV_READ);
+	if (NULL == wrk) {
+		li_event_io_init(&srv->main_worker->loop, "server socket", &sock->watcher, li_server_listen_cb, fd, LI_EV_READ);
+	} else {
+		/* attached to the worker loop from the worker thread */
+		li_event_io_init(NULL, "server socket (reuseport)", &sock->watcher, li_server_listen_cb, fd, LI_EV_READ);
+	}
 	return sock;
 }
 
@@ -142,6 +148,11 @@ liServer* li_server_new(const gchar *module_dir, gboolean module_resident) {
 #endif
 
 	srv->io_timeout = 300; /* default I/O timeout */
+#ifdef USE_SENDFILE
+	srv->network_backend = LI_NETWORK_BACKEND_SENDFILE;
+#else
+	srv->network_backend = LI_NETWORK_BACKEND_WRITEV;
+#endif
 	srv->keep_alive_queue_timeout = 5;
 	srv->stat_cache_ttl = 10.0; /* default stat cache ttl */
 	srv->tasklet_pool_threads = 4; /* default per-worker tasklet_pool threads */
@@ -245,6 +256,9 @@ void li_server_free(liServer* srv) {
 	g_hash_table_destroy(srv->fetch_backends);
 	g_mutex_free(srv->fetch_backends_mutex);
 
+	li_file_cache_free(srv->file_cache);
+	srv->file_cache = NULL;
+
 	g_mutex_free(srv->action_mutex);
 
 #ifdef LIGHTY_OS_LINUX
@@ -312,6 +326,7 @@ static void li_server_1sec_timer(liEventBase *watcher, int events) {
 
 			for (i = 0; i < srv->sockets->len; i++) {
 				liServerSocket *sock = g_ptr_array_index(srv->sockets, i);
+				if (NULL != sock->wrk) continue; /* workers handle their own sockets */
 				li_event_start(&sock->watcher);
 			}
 			srv->connection_limit_hit = FALSE;
@@ -371,30 +386,45 @@ static void server_connection_limit_hit(liServer *srv) {
 
 	for (i = 0; i < srv->sockets->len; i++) {
 		liServerSocket *sock = g_ptr_array_index(srv->sockets, i);
+		if (NULL != sock->wrk) continue; /* workers handle their own sockets */
 		li_event_stop(&sock->watcher);
 	}
 
 	srv->connection_limit_hit = TRUE;
 }
 
+/* wake up workers which got new connections from the main worker */
+static void server_new_con_flush(liServer *srv) {
+	guint i;
+
+	for (i = 1; i < srv->worker_count; i++) {
+		liWorker *wrk = g_array_index(srv->workers, liWorker*, i);
+		li_worker_new_con_flush(srv->main_worker, wrk);
+	}
+}
+
 static void li_server_listen_cb(liEventBase *watcher, int events) {
 	liServerSocket *sock = LI_CONTAINER_OF(li_event_io_from(watcher), liServerSocket, watcher);
 	liServer *srv = sock->srv;
 	int s;
-	liSocketAddress remote_addr;
 	liSockAddr sa;
 	socklen_t l;
 	int fd = li_event_io_fd(li_event_io_from(watcher));
 	UNUSED(events);
 
 	for ( ;; ) {
-		liWorker *wrk;
+		liWorker *wrk, *ctx;
 		guint i, min_load, srv_cur_load, srv_max_load;
 
 		srv_cur_load = g_atomic_int_get(&srv->connection_load);
 		srv_max_load = g_atomic_int_get(&srv->max_connections);
 		if (srv_cur_load >= srv_max_load) {
-			server_connection_limit_hit(srv);
+			if (NULL != sock->wrk) {
+				li_worker_listen_limit_hit(sock->wrk);
+			} else {
+				server_connection_limit_hit(srv);
+				server_new_con_flush(srv);
+			}
 			return;
 		}
 
@@ -413,30 +443,34 @@ static void li_server_listen_cb(liEventBase *watcher, int events) {
 		li_fd_no_block(s); /* we don't fork, don't care about FD_CLOEXEC */
 #endif
 
-		wrk = srv->main_worker;
-		min_load = g_atomic_int_get(&wrk->connection_load);
-
-		if (l <= sizeof(sa)) {
-			remote_addr.addr = g_slice_alloc(l);
-			remote_addr.len = l;
-			memcpy(remote_addr.addr, &sa, l);
+		if (NULL != sock->wrk) {
+			/* the kernel already balanced the connection (SO_REUSEPORT); keep it in the accepting worker */
+			wrk = ctx = sock->wrk;
 		} else {
-			remote_addr = li_sockaddr_remote_from_socket(s);
-		}
-
-		for (i = 1; i < srv->worker_count; i++) {
-			liWorker *wt = g_array_index(srv->workers, liWorker*, i);
-			guint load = g_atomic_int_get(&wt->connection_load);
-			if (load < min_load) {
-				wrk = wt;
-				min_load = load;
+			wrk = ctx = srv->main_worker;
+			min_load = g_atomic_int_get(&wrk->connection_load);
+
+			for (i = 1; i < srv->worker_count; i++) {
+				liWorker *wt = g_array_index(srv->workers, liWorker*, i);
+				guint load = g_atomic_int_get(&wt->connection_load);
+				if (load < min_load) {
+					wrk = wt;
+					min_load = load;
+				}
 			}
 		}
 
 		g_atomic_int_inc((gint*) &wrk->connection_load);
 		g_atomic_int_inc((gint*) &srv->connection_load);
 		li_server_socket_acquire(sock);
-		li_worker_new_con(srv->main_worker, wrk, remote_addr, s, sock);
+
+		if (l <= sizeof(sa)) {
+			li_worker_new_con(ctx, wrk, &sa, l, s, sock);
+		} else {
+			liSocketAddress remote_addr = li_sockaddr_remote_from_socket(s);
+			li_worker_new_con(ctx, wrk, remote_addr.addr, remote_addr.len, s, sock);
+			li_sockaddr_clear(&remote_addr);
+		}
 	}
 
 #ifdef _WIN32
@@ -462,11 +496,14 @@ static void li_server_listen_cb(liEventBase *watcher, int events) {
 		ERROR(srv, "accept failed on fd=%d with error: %s", fd, g_strerror(errno));
 		break;
 	}
+
+	/* one wakeup per worker for the whole batch */
+	if (NULL == sock->wrk) server_new_con_flush(srv);
 }
 
 /* main worker only */
 liServerSocket* li_server_listen(liServer *srv, int fd) {
-	liServerSocket *sock = server_socket_new(srv, fd);
+	liServerSocket *sock = server_socket_new(srv, NULL, fd);
 
 	sock->srv = srv;
 	g_ptr_array_add(srv->sockets, sock);
@@ -476,13 +513,51 @@ liServerSocket* li_server_listen(liServer *srv, int fd) {
 	return sock;
 }
 
+/* main worker only */
+liServerSocket* li_server_listen_reuseport(liServer *srv, int fd) {
+	liServerSocket *sock;
+	liWorker *wrk;
+
+	LI_FORCE_ASSERT(srv->worker_count > 0 && srv->workers->len == srv->worker_count);
+
+	wrk = g_array_index(srv->workers, liWorker*, srv->listen_reuseport_sockets % srv->worker_count);
+	srv->listen_reuseport_sockets++;
+
+	sock = server_socket_new(srv, wrk, fd);
+	sock->srv = srv;
+	g_ptr_array_add(srv->sockets, sock);
+
+	/* the worker starts the watcher if listen_reuseport_active is set */
+	li_worker_add_listen_socket(srv->main_worker, wrk, sock);
+
+	return sock;
+}
+
+/* tell the workers to start/stop accepting on their own sockets */
+static void server_listen_reuseport_update(liServer *srv, gboolean active) {
+	guint i;
+
+	g_atomic_int_set(&srv->listen_reuseport_active, active);
+
+	if (0 == srv->listen_reuseport_sockets) return;
+
+	for (i = 0; i < srv->worker_count; i++) {
+		liWorker *wrk;
+		wrk = g_array_index(srv->workers, liWorker*, i);
+		li_worker_listen(srv->main_worker, wrk);
+	}
+}
+
 static void li_server_start_listen(liServer *srv) {
 	guint i;
 
 	for (i = 0; i < srv->sockets->len; i++) {
 		liServerSocket *sock = g_ptr_array_index(srv->sockets, i);
+		if (NULL != sock->wrk) continue;
 		li_event_start(&sock->watcher);
 	}
+
+	server_listen_reuseport_update(srv, TRUE);
 }
 
 static void li_server_stop_listen(liServer *srv) {
@@ -490,10 +565,13 @@ static void li_server_stop_listen(liServer *srv) {
 
 	for (i = 0; i < srv->sockets->len; i++) {
 		liServerSocket *sock = g_ptr_array_index(srv->sockets, i);
+		if (NULL != sock->wrk) continue;
 		li_event_stop(&sock->watcher);
 	}
 	srv->connection_limit_hit = FALSE; /* reset flag */
 
+	server_listen_reuseport_update(srv, FALSE);
+
 	/* suspend all workers (close keep-alive connections) */
 	for (i = 0; i < srv->worker_count; i++) {
 		liWorker *wrk;
@@ -507,9 +585,11 @@ static void li_server_stop(liServer *srv) {
 
 	for (i = 0; i < srv->sockets->len; i++) {
 		liServerSocket *sock = g_ptr_array_index(srv->sockets, i);
+		if (NULL != sock->wrk) continue; /* stopped by li_worker_stop */
 		li_event_stop(&sock->watcher);
 	}
 	srv->connection_limit_hit = FALSE; /* reset flag */
+	g_atomic_int_set(&srv->listen_reuseport_active, FALSE);
 
 	/* stop all workers */
 	for (i = 0; i < srv->worker_count; i++) {
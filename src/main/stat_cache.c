@@ -4,11 +4,59 @@
 
 #include <lighttpd/plugin_core.h>
 
+#ifdef HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+# define USE_INOTIFY
+#endif
+
+#ifdef HAVE_SYS_XATTR_H
+# include <sys/xattr.h>
+#endif
+
+#ifdef HAVE_SYS_RESOURCE_H
+# include <sys/resource.h>
+#endif
+
+struct liStatCacheWatch {
+	GString *path;                    /* directory, without trailing slash (except for "/") */
+	int wd;                           /* -1 if the directory isn't watched */
+	gboolean missing;                 /* not watched because the directory doesn't exist; the parent watch sees it appear */
+	guint64 changed;                  /* sc->generation of the last change of the directory entries */
+	guint refcount;                   /* cache entries for this directory, negative entries and watches of its subdirectories */
+	liStatCacheWatch *parent;
+};
+
+#define STAT_CACHE_NEGATIVE_SIZE 4096 /* must be a power of 2 */
+#define STAT_CACHE_MAX_OPEN_FILES 1024 /* per worker, if RLIMIT_NOFILE doesn't require less */
+
 static void stat_cache_delete_cb(liWaitQueue *wq, gpointer daa);
 
 static void stat_cache_entry_release(liStatCacheEntry *sce);
 static void stat_cache_entry_acquire(liStatCacheEntry *sce);
 
+static void stat_cache_watch_release(liStatCache *sc, liStatCacheWatch *w);
+static void stat_cache_negative_clear(liStatCache *sc);
+#ifdef USE_INOTIFY
+static void stat_cache_inotify_cb(liEventBase *watcher, int events);
+#endif
+
+/* the open files of the cache may use at most a quarter of the fd limit (shared by all workers) */
+static guint stat_cache_max_open_files(liServer *srv) {
+	guint limit = STAT_CACHE_MAX_OPEN_FILES;
+#ifdef HAVE_SYS_RESOURCE_H
+	struct rlimit rlim;
+
+	if (0 == getrlimit(RLIMIT_NOFILE, &rlim) && RLIM_INFINITY != rlim.rlim_cur) {
+		rlim_t share = rlim.rlim_cur / 4 / MAX(srv->worker_count, 1);
+		if (share < limit) limit = share;
+	}
+#else
+	UNUSED(srv);
+#endif
+
+	return limit;
+}
+
 liStatCache* li_stat_cache_new(liWorker *wrk, gdouble ttl) {
 	liStatCache *sc;
 
@@ -27,10 +75,44 @@ liStatCache* li_stat_cache_new(liWorker *wrk, gdouble ttl) {
 
 	li_waitqueue_init(&sc->delete_queue, &wrk->loop, stat_cache_delete_cb, ttl, sc);
 
+	sc->watches = g_hash_table_new((GHashFunc)g_string_hash, (GEqualFunc)g_string_equal);
+	sc->watch_descriptors = g_hash_table_new(NULL, NULL);
+	sc->inotify_path = g_string_sized_new(255);
+	sc->inotify_fd = -1;
+	sc->negative = g_new0(liStatCacheNegativeEntry, STAT_CACHE_NEGATIVE_SIZE);
+	sc->negative_seed = ((guint64) g_random_int() << 32) | g_random_int();
+	sc->mime_type_xattr = wrk->srv->stat_cache_mime_type_xattr;
+	g_queue_init(&sc->open_files);
+	sc->max_open_files = stat_cache_max_open_files(wrk->srv);
+
+#ifdef USE_INOTIFY
+	if (-1 == (sc->inotify_fd = inotify_init())) {
+		WARNING(wrk->srv, "couldn't initialize inotify, stat cache entries are only removed after the ttl: %s", g_strerror(errno));
+	} else {
+		li_fd_no_block(sc->inotify_fd);
+		li_fd_close_on_exec(sc->inotify_fd);
+		li_event_io_init(&wrk->loop, "stat cache inotify", &sc->inotify_watcher, stat_cache_inotify_cb, sc->inotify_fd, LI_EV_READ);
+		li_event_set_keep_loop_alive(&sc->inotify_watcher, FALSE);
+		li_event_start(&sc->inotify_watcher);
+	}
+#endif
+
 	return sc;
 }
 
+/* the cache doesn't keep the file open anymore; requests using it still have their own reference */
+static void stat_cache_close_file(liStatCache *sc, liStatCacheEntry *sce) {
+	if (NULL != sce->open_files_link.data) {
+		g_queue_unlink(&sc->open_files, &sce->open_files_link);
+		sce->open_files_link.data = NULL;
+	}
+	li_chunkfile_release(sce->file);
+	sce->file = NULL;
+}
+
 static void stat_cache_remove_from_cache(liStatCache *sc, liStatCacheEntry *sce) {
+	/* while the tasklet is running it owns sce->file; stat_cache_finished drops it for removed entries */
+	if (g_atomic_int_get(&sce->state) == STAT_CACHE_ENTRY_FINISHED) stat_cache_close_file(sc, sce);
 	if (sce->cached) {
 		if (sce->type == STAT_CACHE_ENTRY_SINGLE) {
 			g_hash_table_remove(sc->entries, sce->data.path);
@@ -38,6 +120,8 @@ static void stat_cache_remove_from_cache(liStatCache *sc, liStatCacheEntry *sce)
 			g_hash_table_remove(sc->dirlists, sce->data.path);
 		}
 		sce->cached = FALSE;
+		stat_cache_watch_release(sc, sce->watch);
+		sce->watch = NULL;
 	}
 	sce->sc = NULL;
 	stat_cache_entry_release(sce);
@@ -57,8 +141,25 @@ void li_stat_cache_free(liStatCache *sc) {
 		stat_cache_remove_from_cache(sc, sce);
 	}
 
+	stat_cache_negative_clear(sc);
+	{
+		guint i;
+		for (i = 0; i < STAT_CACHE_NEGATIVE_SIZE; i++) {
+			if (NULL != sc->negative[i].path) g_string_free(sc->negative[i].path, TRUE);
+		}
+	}
+	g_free(sc->negative);
+
+	if (-1 != sc->inotify_fd) {
+		li_event_clear(&sc->inotify_watcher);
+		close(sc->inotify_fd);
+	}
+
 	g_hash_table_destroy(sc->entries);
 	g_hash_table_destroy(sc->dirlists);
+	g_hash_table_destroy(sc->watches);
+	g_hash_table_destroy(sc->watch_descriptors);
+	g_string_free(sc->inotify_path, TRUE);
 	g_slice_free(liStatCache, sc);
 }
 
@@ -76,13 +177,408 @@ static void stat_cache_delete_cb(liWaitQueue *wq, gpointer data) {
 	li_waitqueue_update(wq);
 }
 
+static void stat_cache_watch_unwatch(liStatCache *sc, liStatCacheWatch *w) {
+	GSList *l;
+
+	if (-1 == w->wd) return;
+
+	/* the same inode can be watched through different paths (symlinks) */
+	l = g_hash_table_lookup(sc->watch_descriptors, GINT_TO_POINTER(w->wd));
+	l = g_slist_remove(l, w);
+	if (NULL == l) {
+		g_hash_table_remove(sc->watch_descriptors, GINT_TO_POINTER(w->wd));
+#ifdef USE_INOTIFY
+		inotify_rm_watch(sc->inotify_fd, w->wd);
+#endif
+	} else {
+		g_hash_table_insert(sc->watch_descriptors, GINT_TO_POINTER(w->wd), l);
+	}
+	w->wd = -1;
+}
+
+static void stat_cache_watch_release(liStatCache *sc, liStatCacheWatch *w) {
+	while (NULL != w && 0 == --w->refcount) {
+		liStatCacheWatch *parent = w->parent;
+
+		g_hash_table_remove(sc->watches, w->path);
+		stat_cache_watch_unwatch(sc, w);
+
+		g_string_free(w->path, TRUE);
+		g_slice_free(liStatCacheWatch, w);
+
+		w = parent;
+	}
+}
+
+/* whether the directory and all its parents are still the same (no entries added, removed or renamed) since generation */
+static gboolean stat_cache_watch_unchanged(liStatCacheWatch *w, guint64 generation) {
+	for (; NULL != w; w = w->parent) {
+		if (w->changed > generation) return FALSE;
+		if (-1 == w->wd && !w->missing) return FALSE;
+	}
+	return TRUE;
+}
+
+/* FNV-1a with a random start value; only selects the slot, hits compare the complete path */
+static guint64 stat_cache_negative_hash(liStatCache *sc, GString *path) {
+	guint64 h = G_GUINT64_CONSTANT(14695981039346656037) ^ sc->negative_seed;
+	gsize i;
+
+	for (i = 0; i < path->len; i++) {
+		h ^= (guchar) path->str[i];
+		h *= G_GUINT64_CONSTANT(1099511628211);
+	}
+
+	return h;
+}
+
+static void stat_cache_negative_clear(liStatCache *sc) {
+	guint i;
+
+	for (i = 0; i < STAT_CACHE_NEGATIVE_SIZE; i++) {
+		liStatCacheNegativeEntry *ne = &sc->negative[i];
+		if (NULL != ne->watch) {
+			stat_cache_watch_release(sc, ne->watch);
+			ne->watch = NULL;
+		}
+	}
+}
+
+/* remember a failed (ENOENT/ENOTDIR) lookup. only possible if all directories in the path are watched (or don't exist) */
+static gboolean stat_cache_negative_add(liStatCache *sc, liStatCacheEntry *sce) {
+	liStatCacheNegativeEntry *ne;
+	guint64 hash;
+
+	if (NULL == sce->watch || !stat_cache_watch_unchanged(sce->watch, sce->generation)) return FALSE;
+
+	hash = stat_cache_negative_hash(sc, sce->data.path);
+	ne = &sc->negative[hash & (STAT_CACHE_NEGATIVE_SIZE - 1)];
+
+	sce->watch->refcount++;
+	if (NULL != ne->watch) stat_cache_watch_release(sc, ne->watch);
+
+	if (NULL == ne->path) {
+		ne->path = g_string_new_len(GSTR_LEN(sce->data.path));
+	} else {
+		g_string_truncate(ne->path, 0);
+		g_string_append_len(ne->path, GSTR_LEN(sce->data.path));
+	}
+	ne->generation = sce->generation;
+	ne->watch = sce->watch;
+	ne->err = sce->data.err;
+
+	return TRUE;
+}
+
+static gboolean stat_cache_negative_lookup(liStatCache *sc, GString *path, int *err) {
+	liStatCacheNegativeEntry *ne;
+	guint64 hash = stat_cache_negative_hash(sc, path);
+
+	ne = &sc->negative[hash & (STAT_CACHE_NEGATIVE_SIZE - 1)];
+	if (NULL == ne->watch || !g_string_equal(ne->path, path)) return FALSE;
+
+	if (!stat_cache_watch_unchanged(ne->watch, ne->generation)) {
+		stat_cache_watch_release(sc, ne->watch);
+		ne->watch = NULL;
+		return FALSE;
+	}
+
+	*err = ne->err;
+	return TRUE;
+}
+
+#ifdef USE_INOTIFY
+
+#define STAT_CACHE_INOTIFY_MASK (IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO \
+	| IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+static void stat_cache_watch_watch(liStatCache *sc, liStatCacheWatch *w) {
+	if (-1 != (w->wd = inotify_add_watch(sc->inotify_fd, w->path->str, STAT_CACHE_INOTIFY_MASK))) {
+		GSList *l = g_hash_table_lookup(sc->watch_descriptors, GINT_TO_POINTER(w->wd));
+		g_hash_table_insert(sc->watch_descriptors, GINT_TO_POINTER(w->wd), g_slist_prepend(l, w));
+		w->missing = FALSE;
+	} else {
+		w->missing = (ENOENT == errno || ENOTDIR == errno);
+	}
+	w->changed = ++sc->generation;
+}
+
+/* the path of the directory (or one of its parents) now refers to something else: watch it again */
+static void stat_cache_watch_rearm_below(liStatCache *sc, GString *path) {
+	GPtrArray *list = g_ptr_array_new();
+	GHashTableIter iter;
+	gpointer key, value;
+	guint i;
+
+	g_hash_table_iter_init(&iter, sc->watches);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		GString *p = key;
+		if (p->len >= path->len && 0 == memcmp(p->str, path->str, path->len) && (p->len == path->len || p->str[path->len] == '/')) {
+			g_ptr_array_add(list, value);
+		}
+	}
+
+	for (i = 0; i < list->len; i++) {
+		liStatCacheWatch *w = g_ptr_array_index(list, i);
+		stat_cache_watch_unwatch(sc, w);
+		stat_cache_watch_watch(sc, w);
+	}
+
+	g_ptr_array_free(list, TRUE);
+}
+
+/* returns a new reference to the watch for the directory dir (and its parents) */
+static liStatCacheWatch* stat_cache_watch_get(liStatCache *sc, const gchar *dir, gsize len) {
+	const GString key = li_const_gstring(dir, len);
+	liStatCacheWatch *w;
+	gsize parent_len;
+
+	if (NULL != (w = g_hash_table_lookup(sc->watches, &key))) {
+		w->refcount++;
+		return w;
+	}
+
+	w = g_slice_new0(liStatCacheWatch);
+	w->path = g_string_new_len(dir, len);
+	w->refcount = 1;
+
+	/* watch all parent directories too: a rename of one of them (or of a symlink) changes what the path refers to */
+	if (len > 1) {
+		parent_len = len - 1;
+		while (parent_len > 0 && dir[parent_len] != '/') parent_len--;
+		if (0 == parent_len) parent_len = 1; /* "/" */
+		w->parent = stat_cache_watch_get(sc, dir, parent_len);
+	}
+
+	stat_cache_watch_watch(sc, w);
+
+	g_hash_table_insert(sc->watches, w->path, w);
+
+	return w;
+}
+
+/* has to be called before the tasklet runs, so no change after the stat() can be missed */
+static void stat_cache_watch_entry(liStatCache *sc, liStatCacheEntry *sce) {
+	const gchar *path = sce->data.path->str;
+	gsize len = sce->data.path->len;
+
+	if (-1 == sc->inotify_fd || 0 == len || path[0] != '/') return;
+
+	/* ignore trailing slash */
+	if (len > 1 && path[len-1] == '/') len--;
+
+	if (sce->type == STAT_CACHE_ENTRY_SINGLE && len > 1) {
+		/* watch the parent directory */
+		do { len--; } while (len > 0 && path[len] != '/');
+		if (0 == len) len = 1; /* "/" */
+	}
+
+	sce->watch = stat_cache_watch_get(sc, path, len);
+	sce->generation = sc->generation;
+}
+
+static void stat_cache_invalidate(liStatCache *sc, liStatCacheEntry *sce) {
+	sc->invalidations++;
+	li_waitqueue_remove(&sc->delete_queue, &sce->queue_elem);
+	stat_cache_remove_from_cache(sc, sce);
+}
+
+/* path and path + "/" */
+static void stat_cache_invalidate_path(liStatCache *sc, GString *path) {
+	liStatCacheEntry *sce;
+	guint i;
+
+	for (i = 0; i < 2; i++) {
+		if (1 == i) g_string_append_c(path, '/');
+
+		if (NULL != (sce = g_hash_table_lookup(sc->entries, path))) stat_cache_invalidate(sc, sce);
+		if (NULL != (sce = g_hash_table_lookup(sc->dirlists, path))) stat_cache_invalidate(sc, sce);
+	}
+
+	g_string_truncate(path, path->len - 1);
+}
+
+/* all entries below the directory path */
+static void stat_cache_invalidate_below(liStatCache *sc, GString *path) {
+	GPtrArray *list = g_ptr_array_new();
+	GHashTable *tables[2] = { sc->entries, sc->dirlists };
+	GHashTableIter iter;
+	gpointer key, value;
+	gsize len = path->len;
+	guint i;
+
+	if (0 == len || path->str[len-1] != '/') len++;
+
+	for (i = 0; i < 2; i++) {
+		g_hash_table_iter_init(&iter, tables[i]);
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			GString *p = key;
+			if (p->len > len && 0 == memcmp(p->str, path->str, len - 1) && p->str[len-1] == '/') {
+				g_ptr_array_add(list, value);
+			}
+		}
+	}
+
+	for (i = 0; i < list->len; i++) {
+		stat_cache_invalidate(sc, g_ptr_array_index(list, i));
+	}
+
+	g_ptr_array_free(list, TRUE);
+}
+
+static void stat_cache_invalidate_all(liStatCache *sc) {
+	liWaitQueueElem *wqe;
+
+	while (NULL != (wqe = li_waitqueue_pop_force(&sc->delete_queue))) {
+		sc->invalidations++;
+		stat_cache_remove_from_cache(sc, wqe->data);
+	}
+
+	stat_cache_negative_clear(sc);
+}
+
+static void stat_cache_inotify_event(liStatCache *sc, struct inotify_event *ev) {
+	GPtrArray *dirs;
+	GSList *l;
+	GString *path = sc->inotify_path;
+	guint i;
+
+	if (ev->mask & IN_Q_OVERFLOW) {
+		/* lost events */
+		stat_cache_invalidate_all(sc);
+		return;
+	}
+
+	if (NULL == (l = g_hash_table_lookup(sc->watch_descriptors, GINT_TO_POINTER(ev->wd)))) return;
+
+	/* invalidating entries may free the watches */
+	dirs = g_ptr_array_new();
+	for (; NULL != l; l = l->next) {
+		liStatCacheWatch *w = l->data;
+		g_ptr_array_add(dirs, g_string_new_len(GSTR_LEN(w->path)));
+		if (ev->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_UNMOUNT)) {
+			/* invalidates negative entries */
+			w->changed = ++sc->generation;
+		}
+		if (ev->mask & IN_IGNORED) {
+			w->wd = -1;
+			w->missing = FALSE;
+		}
+	}
+	if (ev->mask & IN_IGNORED) {
+		/* watch was removed by the kernel */
+		g_slist_free(g_hash_table_lookup(sc->watch_descriptors, GINT_TO_POINTER(ev->wd)));
+		g_hash_table_remove(sc->watch_descriptors, GINT_TO_POINTER(ev->wd));
+	}
+
+	for (i = 0; i < dirs->len; i++) {
+		GString *dir = g_ptr_array_index(dirs, i);
+
+		/* the directory itself changed (mtime, dirlist) */
+		g_string_assign(path, dir->str);
+		stat_cache_invalidate_path(sc, path);
+
+		if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_UNMOUNT)) {
+			stat_cache_invalidate_below(sc, path);
+		} else if (ev->len > 0) {
+			if (path->len > 1) g_string_append_c(path, '/');
+			g_string_append(path, ev->name);
+			stat_cache_invalidate_path(sc, path);
+
+			/* a directory (or symlink) we watch has been replaced (or created) */
+			if ((ev->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) && NULL != g_hash_table_lookup(sc->watches, path)) {
+				stat_cache_watch_rearm_below(sc, path);
+				stat_cache_invalidate_below(sc, path);
+			}
+		}
+
+		g_string_free(dir, TRUE);
+	}
+
+	g_ptr_array_free(dirs, TRUE);
+}
+
+static void stat_cache_inotify_cb(liEventBase *watcher, int events) {
+	liStatCache *sc = LI_CONTAINER_OF(li_event_io_from(watcher), liStatCache, inotify_watcher);
+	guint64 buf[512]; /* aligned for struct inotify_event */
+	ssize_t r;
+	gchar *p;
+	UNUSED(events);
+
+	for (;;) {
+		r = read(sc->inotify_fd, buf, sizeof(buf));
+
+		if (-1 == r) {
+			switch (errno) {
+			case EINTR:
+				continue;
+			case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+			case EWOULDBLOCK:
+#endif
+				return;
+			default:
+				break;
+			}
+		}
+		if (r <= 0) break;
+
+		for (p = (gchar*) buf; p < (gchar*) buf + r; ) {
+			struct inotify_event *ev = (struct inotify_event*) p;
+			stat_cache_inotify_event(sc, ev);
+			p += sizeof(struct inotify_event) + ev->len;
+		}
+	}
+
+	/* shouldn't happen; fall back to ttl only */
+	stat_cache_invalidate_all(sc);
+	li_event_clear(&sc->inotify_watcher);
+	close(sc->inotify_fd);
+	sc->inotify_fd = -1;
+}
+
+#else /* USE_INOTIFY */
+
+static void stat_cache_watch_entry(liStatCache *sc, liStatCacheEntry *sce) {
+	UNUSED(sc); UNUSED(sce);
+}
+
+#endif /* USE_INOTIFY */
+
 static void stat_cache_finished(gpointer data) {
 	liStatCacheEntry *sce = data;
 	guint i;
 	liVRequest *vr;
 
-	if (sce->data.failed) {
-		if (NULL != sce->sc) sce->sc->errors++;
+	if (sce->data.failed && NULL != sce->sc) {
+		liStatCache *sc = sce->sc;
+
+		sc->errors++;
+
+		if (sce->type == STAT_CACHE_ENTRY_SINGLE && (ENOENT == sce->data.err || ENOTDIR == sce->data.err) && sce->cached) {
+			if (stat_cache_negative_add(sc, sce)) {
+				/* the negative set answers further lookups, don't keep the entry */
+				sc->negative_misses++;
+				li_waitqueue_remove(&sc->delete_queue, &sce->queue_elem);
+				stat_cache_remove_from_cache(sc, sce);
+			}
+		}
+	}
+
+	if (NULL != sce->file) {
+		liStatCache *sc = sce->sc;
+
+		if (NULL == sc || !sce->cached) {
+			/* removed while the tasklet was running: nobody finds it anymore */
+			li_chunkfile_release(sce->file);
+			sce->file = NULL;
+		} else {
+			sce->open_files_link.data = sce;
+			g_queue_push_tail_link(&sc->open_files, &sce->open_files_link);
+			while (sc->open_files.length > sc->max_open_files) {
+				stat_cache_close_file(sc, g_queue_peek_head(&sc->open_files));
+			}
+		}
 	}
 
 	/* queue pending vrequests */
@@ -95,10 +591,82 @@ static void stat_cache_finished(gpointer data) {
 	stat_cache_entry_release(sce);
 }
 
+#ifdef HAVE_SYS_XATTR_H
+/* the value ends up in a response header */
+static gboolean stat_cache_mime_type_valid(const gchar *s, gsize len) {
+	gsize i;
+
+	for (i = 0; i < len; i++) {
+		if (s[i] < 0x20 || s[i] > 0x7e) return FALSE;
+	}
+
+	return TRUE;
+}
+#endif
+
+/* stat, and for regular files open + fstat in the tasklet; regular files stay open in sce->file, so cache hits
+ * don't need any syscall. other file types (fifos, devices, ...) are never opened.
+ */
+static void stat_cache_run_single(liStatCacheEntry *sce) {
+	struct stat st;
+	int fd;
+
+	if (-1 == stat(sce->data.path->str, &sce->data.st)) {
+		sce->data.failed = TRUE;
+		sce->data.err = errno;
+		return;
+	}
+
+	sce->data.failed = FALSE;
+
+	if (!S_ISREG(sce->data.st.st_mode)) return;
+
+	/* O_NONBLOCK: don't hang if it was replaced by a fifo in the meantime; it has no effect on regular files */
+	while (-1 == (fd = open(sce->data.path->str, O_RDONLY | O_NONBLOCK | O_NOCTTY))) {
+		if (errno == EINTR)
+			continue;
+
+		/* not readable (EACCES): keep the stat() result */
+		return;
+	}
+
+	if (-1 == fstat(fd, &st)) {
+		close(fd);
+		return;
+	}
+
+	sce->data.st = st;
+
+	if (S_ISREG(st.st_mode)) {
+		li_fd_close_on_exec(fd);
+		sce->file = li_chunkfile_new(sce->data.path, fd, FALSE);
+
+#ifdef HAVE_SYS_XATTR_H
+		if (sce->mime_type_xattr) {
+			gchar buf[256];
+			ssize_t len = fgetxattr(fd, "user.mime_type", buf, sizeof(buf));
+			if (len > 0 && stat_cache_mime_type_valid(buf, len)) {
+				sce->data.content_type = g_string_new_len(buf, len);
+			}
+		}
+#endif
+	} else {
+		close(fd);
+	}
+}
+
 static void stat_cache_run(gpointer data) {
 	liStatCacheEntry *sce = data;
 
-	if (stat(sce->data.path->str, &sce->data.st) == -1) {
+	if (sce->type == STAT_CACHE_ENTRY_SINGLE) {
+		stat_cache_run_single(sce);
+
+		if (!sce->data.failed) {
+			gchar buf[64];
+			gsize len = li_etag_last_modified(buf, sizeof(buf), sce->data.st.st_mtime);
+			if (0 != len) sce->data.last_modified = g_string_new_len(buf, len);
+		}
+	} else if (stat(sce->data.path->str, &sce->data.st) == -1) {
 		sce->data.failed = TRUE;
 		sce->data.err = errno;
 	} else {
@@ -136,6 +704,7 @@ static void stat_cache_run(gpointer data) {
 					continue;
 				}
 
+				memset(&sced, 0, sizeof(sced));
 				sced.path = g_string_sized_new(63);
 				g_string_assign(sced.path, result->d_name);
 
@@ -180,21 +749,30 @@ static liStatCacheEntry *stat_cache_entry_new(liStatCache *sc, GString *path) {
 	sce->queue_elem.data = sce;
 	sce->refcount = 1;
 	sce->cached = TRUE;
+	sce->mime_type_xattr = sc->mime_type_xattr;
 
 	return sce;
 }
 
+static void stat_cache_entry_data_clear(liStatCacheEntryData *sced) {
+	g_string_free(sced->path, TRUE);
+	if (NULL != sced->etag) g_string_free(sced->etag, TRUE);
+	if (NULL != sced->last_modified) g_string_free(sced->last_modified, TRUE);
+	if (NULL != sced->content_type) g_string_free(sced->content_type, TRUE);
+}
+
 static void stat_cache_entry_free(liStatCacheEntry *sce) {
 	guint i;
 
 	LI_FORCE_ASSERT(sce->vrequests->len == 0);
 
-	g_string_free(sce->data.path, TRUE);
+	stat_cache_entry_data_clear(&sce->data);
 	g_ptr_array_free(sce->vrequests, TRUE);
+	li_chunkfile_release(sce->file);
 
 	if (NULL != sce->dirlist) {
 		for (i = 0; i < sce->dirlist->len; i++) {
-			g_string_free(g_array_index(sce->dirlist, liStatCacheEntryData, i).path, TRUE);
+			stat_cache_entry_data_clear(&g_array_index(sce->dirlist, liStatCacheEntryData, i));
 		}
 
 		g_array_free(sce->dirlist, TRUE);
@@ -261,6 +839,7 @@ liHandlerResult li_stat_cache_get_dirlist(liVRequest *vr, GString *path, liStatC
 		/* uses initial reference of sce */
 		li_waitqueue_push(&sc->delete_queue, &sce->queue_elem);
 		g_hash_table_insert(sc->dirlists, sce->data.path, sce);
+		stat_cache_watch_entry(sc, sce);
 
 		sce->refcount++;
 		li_tasklet_push(vr->wrk->tasklets, stat_cache_run, stat_cache_finished, sce);
@@ -270,17 +849,37 @@ liHandlerResult li_stat_cache_get_dirlist(liVRequest *vr, GString *path, liStatC
 	}
 }
 
-static liHandlerResult stat_cache_get(liVRequest *vr, GString *path, struct stat *st, int *err, int *fd, gboolean async) {
+static liStatCacheEntry* stat_cache_vr_entry(liVRequest *vr, GString *path) {
+	guint i;
+
+	for (i = 0; i < vr->stat_cache_entries->len; i++) {
+		liStatCacheEntry *sce = g_ptr_array_index(vr->stat_cache_entries, i);
+		if (!sce->cached && sce->type == STAT_CACHE_ENTRY_SINGLE && g_string_equal(sce->data.path, path)) return sce;
+	}
+
+	return NULL;
+}
+
+static liHandlerResult stat_cache_get(liVRequest *vr, GString *path, struct stat *st, int *err, int *fd, liChunkFile **file, liStatCacheEntryData **data, gboolean async) {
 	liStatCache *sc;
 	liStatCacheEntry *sce;
 	guint i;
 
+	if (NULL != data) *data = NULL;
+
 	/* force blocking call if we are not in a vrequest context or stat cache is disabled */
 	if (!vr || !(sc = vr->wrk->stat_cache) || !CORE_OPTION(LI_CORE_OPTION_ASYNC_STAT).boolean)
 		async = FALSE;
 
 	if (async) {
-		sce = g_hash_table_lookup(sc->entries, path);
+		if (NULL == (sce = g_hash_table_lookup(sc->entries, path))) {
+			/* a lookup of this vrequest may have been removed from the cache already (negative set, inotify) */
+			sce = stat_cache_vr_entry(vr, path);
+			if (NULL != sce && g_atomic_int_get(&sce->state) == STAT_CACHE_ENTRY_FINISHED && sce->data.failed) {
+				*err = sce->data.err;
+				return LI_HANDLER_ERROR;
+			}
+		}
 
 		if (sce) {
 			/* cache hit, check state */
@@ -296,6 +895,33 @@ static liHandlerResult stat_cache_get(liVRequest *vr, GString *path, struct stat
 			}
 
 			sc->hits++;
+
+			if (NULL != sce->open_files_link.data) {
+				/* most recently used */
+				g_queue_unlink(&sc->open_files, &sce->open_files_link);
+				g_queue_push_tail_link(&sc->open_files, &sce->open_files_link);
+			}
+
+			/* failed lookups and regular files we couldn't open (or closed because of the limit) are checked again below */
+			if (!sce->data.failed && (NULL != sce->file || !S_ISREG(sce->data.st.st_mode) || (NULL == fd && NULL == file))) {
+				*st = sce->data.st;
+				if (NULL != data) *data = &sce->data;
+				if (NULL != file) {
+					if (NULL != (*file = sce->file)) li_chunkfile_acquire(sce->file);
+				} else if (NULL != fd) {
+					if (NULL == sce->file) {
+						*fd = -1;
+					} else if (-1 == (*fd = dup(sce->file->fd))) {
+						*err = errno;
+						return LI_HANDLER_ERROR;
+					}
+				}
+				return LI_HANDLER_GO_ON;
+			}
+		} else if (stat_cache_negative_lookup(sc, path, err)) {
+			/* known to be missing */
+			sc->negative_hits++;
+			return LI_HANDLER_ERROR;
 		} else {
 			/* cache miss, allocate new entry */
 			sce = stat_cache_entry_new(sc, path);
@@ -306,6 +932,7 @@ static liHandlerResult stat_cache_get(liVRequest *vr, GString *path, struct stat
 			/* uses initial reference of sce */
 			li_waitqueue_push(&sc->delete_queue, &sce->queue_elem);
 			g_hash_table_insert(sc->entries, sce->data.path, sce);
+			stat_cache_watch_entry(sc, sce);
 
 			sce->refcount++;
 			li_tasklet_push(vr->wrk->tasklets, stat_cache_run, stat_cache_finished, sce);
@@ -315,7 +942,29 @@ static liHandlerResult stat_cache_get(liVRequest *vr, GString *path, struct stat
 		}
 	}
 
-	if (fd) {
+	if (file) {
+		int tmpfd;
+
+		/* open + fstat */
+		*file = NULL;
+		while (-1 == (tmpfd = open(path->str, O_RDONLY))) {
+			if (errno == EINTR)
+				continue;
+
+			*err = errno;
+			return LI_HANDLER_ERROR;
+		}
+		if (-1 == fstat(tmpfd, st)) {
+			*err = errno;
+			close(tmpfd);
+			return LI_HANDLER_ERROR;
+		}
+		if (S_ISREG(st->st_mode)) {
+			*file = li_chunkfile_new(path, tmpfd, FALSE);
+		} else {
+			close(tmpfd);
+		}
+	} else if (fd) {
 		/* open + fstat */
 		while (-1 == (*fd = open(path->str, O_RDONLY))) {
 			if (errno == EINTR)
@@ -342,10 +991,51 @@ static liHandlerResult stat_cache_get(liVRequest *vr, GString *path, struct stat
 }
 
 liHandlerResult li_stat_cache_get(liVRequest *vr, GString *path, struct stat *st, int *err, int *fd) {
-	return stat_cache_get(vr, path, st, err, fd, TRUE);
+	return stat_cache_get(vr, path, st, err, fd, NULL, NULL, TRUE);
+}
+
+liHandlerResult li_stat_cache_get_file(liVRequest *vr, GString *path, struct stat *st, int *err, liChunkFile **file, liStatCacheEntryData **data) {
+	return stat_cache_get(vr, path, st, err, NULL, file, data, TRUE);
+}
+
+GString* li_stat_cache_etag(liVRequest *vr, liStatCacheEntryData *sced) {
+	guint flags = CORE_OPTION(LI_CORE_OPTION_ETAG_FLAGS).number;
+
+	if (0 == flags) return NULL;
+
+	if (NULL == sced->etag) {
+		sced->etag = g_string_sized_new(15);
+	} else if (sced->etag_flags == flags) {
+		return sced->etag;
+	}
+
+	li_etag_create(sced->etag, &sced->st, flags);
+	sced->etag_flags = flags;
+
+	return sced->etag;
+}
+
+GString* li_stat_cache_content_type(liVRequest *vr, liStatCacheEntryData *sced) {
+	gpointer mime_types = CORE_OPTIONPTR(LI_CORE_OPTION_MIME_TYPES).ptr;
+	GString *mime_str;
+
+	if (NULL != sced->content_type && (NULL == sced->content_type_mime_types || mime_types == sced->content_type_mime_types)) {
+		return sced->content_type;
+	}
+
+	if (NULL == (mime_str = li_mimetype_get(vr, sced->path))) return NULL;
+
+	if (NULL == sced->content_type) {
+		sced->content_type = g_string_new_len(GSTR_LEN(mime_str));
+	} else {
+		g_string_assign(sced->content_type, mime_str->str);
+	}
+	sced->content_type_mime_types = mime_types;
+
+	return sced->content_type;
 }
 
 /* doesn't return HANDLER_WAIT_FOR_EVENT, blocks instead of async lookup */
 liHandlerResult li_stat_cache_get_sync(liVRequest *vr, GString *path, struct stat *st, int *err, int *fd) {
-	return stat_cache_get(vr, path, st, err, fd, FALSE);
+	return stat_cache_get(vr, path, st, err, fd, NULL, NULL, FALSE);
 }
@@ -18,9 +18,9 @@ static void check_response_header(liStreamHttpResponse* shr) {
 	shr->transfer_encoding_chunked = FALSE;
 
 	/* Transfer-Encoding: chunked */
-	l = li_http_header_find_first(resp->headers, CONST_STR_LEN("transfer-encoding"));
+	l = li_http_header_find_first_id(resp->headers, LI_HTTP_HEADER_TRANSFER_ENCODING);
 	if (l) {
-		for ( ; l ; l = li_http_header_find_next(l, CONST_STR_LEN("transfer-encoding")) ) {
+		for ( ; l ; l = li_http_header_find_next_id(l, LI_HTTP_HEADER_TRANSFER_ENCODING) ) {
 			liHttpHeader *hh = (liHttpHeader*) l->data;
 			if (0 == g_ascii_strcasecmp( LI_HEADER_VALUE(hh), "identity" )) {
 				/* ignore */
@@ -46,7 +46,7 @@ static void check_response_header(liStreamHttpResponse* shr) {
 	}
 
 	/* Upgrade: */
-	l = li_http_header_find_first(resp->headers, CONST_STR_LEN("upgrade"));
+	l = li_http_header_find_first_id(resp->headers, LI_HTTP_HEADER_UPGRADE);
 	if (l) {
 		gboolean have_connection_upgrade = FALSE;
 		liHttpHeaderTokenizer header_tokenizer;
@@ -132,7 +132,7 @@ static void stream_simple_socket_write(liIOStream *stream) {
 			}
 		}
 
-		res = li_network_write(fd, raw_out, write_max, &err);
+		res = li_network_write(wrk, fd, raw_out, write_max, &err);
 
 		if (NULL != stream->throttle_out) {
 			li_throttle_update(stream->throttle_out, raw_out->bytes_out - current_out_bytes);
@@ -117,8 +117,7 @@ gboolean li_parse_raw_path(liRequestUri *uri, GString *input) {
 	%% write exec;
 
 	if (cs >= url_parser_first_final) {
-		li_url_decode(uri->path);
-		li_path_simplify(uri->path);
+		li_url_decode_path_simplify(uri->path);
 	}
 
 	return (cs >= url_parser_first_final);
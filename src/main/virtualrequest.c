@@ -8,6 +8,52 @@ static void vrequest_job_cb(liJob *job) {
 	li_vrequest_state_machine(vr);
 }
 
+/* back to the server defaults: only the slots actions changed */
+static void vrequest_restore_options(liVRequest *vr) {
+	liServer *srv = vr->wrk->srv;
+	guint i;
+
+	for (i = 0; i < vr->options_changed->len; i++) {
+		guint ndx = g_array_index(vr->options_changed, guint, i);
+		vr->options[ndx] = g_array_index(srv->option_def_values, liOptionValue, ndx);
+	}
+	g_array_set_size(vr->options_changed, 0);
+
+	for (i = 0; i < vr->optionptrs_changed->len; i++) {
+		guint ndx = g_array_index(vr->optionptrs_changed, guint, i);
+		liOptionPtrValue *def = g_array_index(srv->optionptr_def_values, liOptionPtrValue*, ndx);
+		if (vr->optionptrs[ndx] != def) {
+			li_release_optionptr(srv, vr->optionptrs[ndx]);
+			vr->optionptrs[ndx] = def;
+		}
+	}
+	g_array_set_size(vr->optionptrs_changed, 0);
+}
+
+void li_vrequest_set_option(liVRequest *vr, guint ndx, liOptionValue value) {
+	vr->options[ndx] = value;
+	g_array_append_val(vr->options_changed, ndx);
+}
+
+void li_vrequest_set_optionptr(liVRequest *vr, guint ndx, liOptionPtrValue *value) {
+	liServer *srv = vr->wrk->srv;
+	liOptionPtrValue *def = g_array_index(srv->optionptr_def_values, liOptionPtrValue*, ndx);
+	liOptionPtrValue *cur = vr->optionptrs[ndx];
+
+	if (cur == value) return;
+
+	/* only slots that differ from the default hold a reference */
+	if (cur != def) {
+		li_release_optionptr(srv, cur);
+	} else {
+		g_array_append_val(vr->optionptrs_changed, ndx);
+	}
+	if (value != def && NULL != value) {
+		g_atomic_int_inc(&value->refcount);
+	}
+	vr->optionptrs[ndx] = value;
+}
+
 liVRequest* li_vrequest_new(liWorker *wrk, liConInfo *coninfo) {
 	liServer *srv = wrk->srv;
 	liVRequest *vr = g_slice_new0(liVRequest);
@@ -24,15 +70,10 @@ liVRequest* li_vrequest_new(liWorker *wrk, liConInfo *coninfo) {
 	vr->plugin_ctx = g_ptr_array_new();
 	g_ptr_array_set_size(vr->plugin_ctx, g_hash_table_size(srv->plugins));
 	vr->options = g_slice_copy(srv->option_def_values->len * sizeof(liOptionValue), srv->option_def_values->data);
+	/* borrowed from the server defaults, which live as long as the workers */
 	vr->optionptrs = g_slice_copy(srv->optionptr_def_values->len * sizeof(liOptionPtrValue*), srv->optionptr_def_values->data);
-	{
-		guint i;
-		for (i = 0; i < srv->optionptr_def_values->len; i++) {
-			if (vr->optionptrs[i]) {
-				g_atomic_int_inc(&vr->optionptrs[i]->refcount);
-			}
-		}
-	}
+	vr->options_changed = g_array_new(FALSE, FALSE, sizeof(guint));
+	vr->optionptrs_changed = g_array_new(FALSE, FALSE, sizeof(guint));
 
 	li_request_init(&vr->request);
 	li_physical_init(&vr->physical);
@@ -79,13 +120,10 @@ void li_vrequest_free(liVRequest* vr) {
 
 	li_job_clear(&vr->job);
 
+	vrequest_restore_options(vr);
+	g_array_free(vr->options_changed, TRUE);
+	g_array_free(vr->optionptrs_changed, TRUE);
 	g_slice_free1(srv->option_def_values->len * sizeof(liOptionValue), vr->options);
-	{
-		guint i;
-		for (i = 0; i < srv->optionptr_def_values->len; i++) {
-			li_release_optionptr(srv, vr->optionptrs[i]);
-		}
-	}
 	g_slice_free1(srv->optionptr_def_values->len * sizeof(liOptionPtrValue*), vr->optionptrs);
 
 	li_log_context_set(&vr->log_context, NULL);
@@ -96,6 +134,8 @@ void li_vrequest_free(liVRequest* vr) {
 	}
 	g_ptr_array_free(vr->stat_cache_entries, TRUE);
 
+	li_condition_cache_free(vr);
+
 	g_slice_free(liVRequest, vr);
 }
 
@@ -150,19 +190,9 @@ void li_vrequest_reset(liVRequest *vr, gboolean keepalive) {
 		li_stat_cache_entry_release(vr, sce);
 	}
 
-	memcpy(vr->options, srv->option_def_values->data, srv->option_def_values->len * sizeof(liOptionValue));
-	{
-		guint i;
-		for (i = 0; i < srv->optionptr_def_values->len; i++) {
-			liOptionPtrValue *oval = g_array_index(srv->optionptr_def_values, liOptionPtrValue*, i);
-			if (vr->optionptrs[i] != oval) {
-				li_release_optionptr(srv, vr->optionptrs[i]);
-				if (oval)
-					g_atomic_int_inc(&oval->refcount);
-				vr->optionptrs[i] = oval;
-			}
-		}
-	}
+	li_condition_cache_reset(vr);
+
+	vrequest_restore_options(vr);
 
 	li_log_context_set(&vr->log_context, NULL);
 }
@@ -193,38 +193,127 @@ static void li_worker_exit_cb(liEventBase *watcher, int events) {
 	li_worker_exit(wrk, wrk);
 }
 
-typedef struct li_worker_new_con_data li_worker_new_con_data;
-struct li_worker_new_con_data {
-	liSocketAddress remote_addr;
-	int s;
-	liServerSocket *srv_sock;
-};
-
 /* new con watcher */
-void li_worker_new_con(liWorker *ctx, liWorker *wrk, liSocketAddress remote_addr, int s, liServerSocket *srv_sock) {
+void li_worker_new_con(liWorker *ctx, liWorker *wrk, const liSockAddr *remote_addr, socklen_t remote_addr_len, int s, liServerSocket *srv_sock) {
 	if (ctx == wrk) {
 		liConnection *con = worker_con_get(wrk);
+		liSocketAddress addr;
+
+		addr.len = remote_addr_len;
+		addr.addr = g_slice_alloc(remote_addr_len);
+		memcpy(addr.addr, remote_addr, remote_addr_len);
 
-		li_connection_start(con, remote_addr, s, srv_sock);
+		li_connection_start(con, addr, s, srv_sock);
 	} else {
-		li_worker_new_con_data *d = g_slice_new(li_worker_new_con_data);
-		d->remote_addr = remote_addr;
-		d->s = s;
-		d->srv_sock = srv_sock;
-		g_async_queue_push(wrk->new_con_queue, d);
+		liWorkerNewConRing *ring = wrk->new_con_ring;
+		guint head = ring->head;
+		liWorkerNewCon *nc;
+
+		if (head - (guint) g_atomic_int_get((gint*) &ring->tail) >= LI_WORKER_NEW_CON_RING_SIZE
+		    || remote_addr_len > sizeof(nc->remote_addr)) {
+			/* wrk is far behind (or the address doesn't fit in the slot); don't wait for it */
+			g_atomic_int_add((gint*) &wrk->connection_load, -1);
+			g_atomic_int_inc((gint*) &ctx->connection_load);
+			li_worker_new_con_flush(ctx, wrk);
+			li_worker_new_con(ctx, ctx, remote_addr, remote_addr_len, s, srv_sock);
+			return;
+		}
+
+		nc = &ring->cons[head & (LI_WORKER_NEW_CON_RING_SIZE - 1)];
+		memcpy(&nc->remote_addr, remote_addr, remote_addr_len);
+		nc->remote_addr_len = remote_addr_len;
+		nc->s = s;
+		nc->srv_sock = srv_sock;
+
+		/* publish slot */
+		g_atomic_int_set((gint*) &ring->head, head + 1);
+
+		/* don't let a long accept burst fill the ring before wrk even knows about it */
+		if (head + 1 - ring->flushed >= LI_WORKER_NEW_CON_RING_SIZE / 4) {
+			li_worker_new_con_flush(ctx, wrk);
+		}
+	}
+}
+
+void li_worker_new_con_flush(liWorker *ctx, liWorker *wrk) {
+	liWorkerNewConRing *ring = wrk->new_con_ring;
+
+	if (ctx == wrk || ring->flushed == ring->head) return;
+	ring->flushed = ring->head;
+
+	/* if a wakeup is still pending the consumer will see the new slots anyway */
+	if (g_atomic_int_compare_and_exchange(&ring->wakeup, FALSE, TRUE)) {
 		li_event_async_send(&wrk->new_con_watcher);
 	}
 }
 
 static void li_worker_new_con_cb(liEventBase *watcher, int events) {
 	liWorker *wrk = LI_CONTAINER_OF(li_event_async_from(watcher), liWorker, new_con_watcher);
-	li_worker_new_con_data *d;
+	liWorkerNewConRing *ring = wrk->new_con_ring;
+	guint tail, head;
 	UNUSED(events);
 
-	while (NULL != (d = g_async_queue_try_pop(wrk->new_con_queue))) {
-		li_worker_new_con(wrk, wrk, d->remote_addr, d->s, d->srv_sock);
-		g_slice_free(li_worker_new_con_data, d);
+	/* reset before reading head: slots published after this trigger a new wakeup */
+	g_atomic_int_set(&ring->wakeup, FALSE);
+
+	tail = ring->tail;
+	head = (guint) g_atomic_int_get((gint*) &ring->head);
+
+	for (; tail != head; tail++) {
+		liWorkerNewCon *nc = &ring->cons[tail & (LI_WORKER_NEW_CON_RING_SIZE - 1)];
+		li_worker_new_con(wrk, wrk, &nc->remote_addr, nc->remote_addr_len, nc->s, nc->srv_sock);
 	}
+
+	/* release slots */
+	g_atomic_int_set((gint*) &ring->tail, tail);
+}
+
+/* listening sockets owned by the worker */
+static void worker_listen_update(liWorker *wrk) {
+	liServerSocket *sock;
+	gboolean active;
+	guint i;
+
+	while (NULL != (sock = g_async_queue_try_pop(wrk->new_listen_queue))) {
+		li_event_attach(&wrk->loop, &sock->watcher);
+		g_ptr_array_add(wrk->listen_sockets, sock);
+	}
+
+	active = g_atomic_int_get(&wrk->srv->listen_reuseport_active) && !wrk->listen_limit_hit;
+
+	for (i = 0; i < wrk->listen_sockets->len; i++) {
+		sock = g_ptr_array_index(wrk->listen_sockets, i);
+		if (active) {
+			li_event_start(&sock->watcher);
+		} else {
+			li_event_stop(&sock->watcher);
+		}
+	}
+}
+
+void li_worker_add_listen_socket(liWorker *ctx, liWorker *wrk, liServerSocket *srv_sock) {
+	g_async_queue_push(wrk->new_listen_queue, srv_sock);
+	li_worker_listen(ctx, wrk);
+}
+
+void li_worker_listen(liWorker *ctx, liWorker *wrk) {
+	if (ctx == wrk) {
+		worker_listen_update(wrk);
+	} else {
+		li_event_async_send(&wrk->listen_watcher);
+	}
+}
+
+static void li_worker_listen_cb(liEventBase *watcher, int events) {
+	liWorker *wrk = LI_CONTAINER_OF(li_event_async_from(watcher), liWorker, listen_watcher);
+	UNUSED(events);
+
+	worker_listen_update(wrk);
+}
+
+void li_worker_listen_limit_hit(liWorker *wrk) {
+	wrk->listen_limit_hit = TRUE;
+	worker_listen_update(wrk);
 }
 
 /* stats watcher */
@@ -233,6 +322,13 @@ static void worker_stats_watcher_cb(liEventBase *watcher, int events) {
 	li_tstamp now = li_cur_ts(wrk);
 	UNUSED(events);
 
+	if (wrk->stats.next_update > 0) {
+		li_tstamp lag = li_event_time() - wrk->stats.next_update;
+		if (lag < 0) lag = 0;
+		/* smooth over a few seconds */
+		wrk->stats.loop_lag = (3 * wrk->stats.loop_lag + lag) / 4;
+	}
+
 	if (wrk->stats.last_update && now != wrk->stats.last_update) {
 		wrk->stats.requests_per_sec =
 			(wrk->stats.requests - wrk->stats.last_requests) / (now - wrk->stats.last_update);
@@ -271,7 +367,17 @@ static void worker_stats_watcher_cb(liEventBase *watcher, int events) {
 	wrk->stats.last_requests = wrk->stats.requests;
 	wrk->stats.last_update = now;
 
+	if (wrk->listen_limit_hit) {
+		guint srv_cur_load = g_atomic_int_get(&wrk->srv->connection_load);
+		guint srv_max_load = g_atomic_int_get(&wrk->srv->max_connections);
+		if (srv_cur_load <= (srv_max_load - srv_max_load/8)) { /* cur_load <= 7/8 * max_load */
+			wrk->listen_limit_hit = FALSE;
+			worker_listen_update(wrk);
+		}
+	}
+
 	/* and run again next second */
+	wrk->stats.next_update = now + 1;
 	li_event_timer_once(&wrk->stats_watcher, 1);
 }
 
@@ -292,6 +398,8 @@ liWorker* li_worker_new(liServer *srv, struct ev_loop *loop) {
 
 	wrk->tmp_str = g_string_sized_new(255);
 
+	wrk->regex_match_data = li_regex_match_data_new();
+
 	wrk->timestamps_gmt = g_array_sized_new(FALSE, TRUE, sizeof(liWorkerTS), srv->ts_formats->len);
 	g_array_set_size(wrk->timestamps_gmt, srv->ts_formats->len);
 	{
@@ -314,7 +422,11 @@ liWorker* li_worker_new(liServer *srv, struct ev_loop *loop) {
 	li_event_async_init(&wrk->loop, "worker suspend", &wrk->worker_suspend_watcher, li_worker_suspend_cb);
 
 	li_event_async_init(&wrk->loop, "worker new connection", &wrk->new_con_watcher, li_worker_new_con_cb);
-	wrk->new_con_queue = g_async_queue_new();
+	wrk->new_con_ring = g_slice_new0(liWorkerNewConRing);
+
+	li_event_async_init(&wrk->loop, "worker listen", &wrk->listen_watcher, li_worker_listen_cb);
+	wrk->new_listen_queue = g_async_queue_new();
+	wrk->listen_sockets = g_ptr_array_new();
 
 	li_event_timer_init(&wrk->loop, "worker stats update", &wrk->stats_watcher, worker_stats_watcher_cb);
 	li_event_set_keep_loop_alive(&wrk->stats_watcher, FALSE);
@@ -333,6 +445,11 @@ liWorker* li_worker_new(liServer *srv, struct ev_loop *loop) {
 
 	wrk->network_read_buf = NULL;
 
+	wrk->response_writer = li_response_writer_new();
+
+	wrk->network_io_uring = NULL;
+	wrk->network_io_uring_failed = FALSE;
+
 	return wrk;
 }
 
@@ -379,8 +496,15 @@ struct ev_loop* li_worker_free(liWorker *wrk) {
 	li_event_clear(&wrk->worker_exit_watcher);
 
 	li_event_clear(&wrk->new_con_watcher);
-	g_async_queue_unref(wrk->new_con_queue);
-	wrk->new_con_queue = NULL;
+	g_slice_free(liWorkerNewConRing, wrk->new_con_ring);
+	wrk->new_con_ring = NULL;
+
+	/* sockets are owned by the server (srv->sockets) */
+	li_event_clear(&wrk->listen_watcher);
+	g_async_queue_unref(wrk->new_listen_queue);
+	wrk->new_listen_queue = NULL;
+	g_ptr_array_free(wrk->listen_sockets, TRUE);
+	wrk->listen_sockets = NULL;
 
 	li_event_clear(&wrk->stats_watcher);
 
@@ -393,6 +517,9 @@ struct ev_loop* li_worker_free(liWorker *wrk) {
 
 	g_string_free(wrk->tmp_str, TRUE);
 
+	li_regex_match_data_free(wrk->regex_match_data);
+	wrk->regex_match_data = NULL;
+
 	li_stat_cache_free(wrk->stat_cache);
 
 	li_tasklet_pool_free(wrk->tasklets);
@@ -401,6 +528,11 @@ struct ev_loop* li_worker_free(liWorker *wrk) {
 
 	li_buffer_release(wrk->network_read_buf);
 
+	li_response_writer_free(wrk->response_writer);
+
+	li_network_io_uring_free(wrk->network_io_uring);
+	wrk->network_io_uring = NULL;
+
 	evloop = li_event_loop_clear(&wrk->loop);
 
 	g_slice_free(liWorker, wrk);
@@ -445,6 +577,12 @@ void li_worker_stop(liWorker *context, liWorker *wrk) {
 
 		li_event_stop(&wrk->new_con_watcher);
 
+		li_event_stop(&wrk->listen_watcher);
+		for (i = 0; i < wrk->listen_sockets->len; i++) {
+			liServerSocket *sock = g_ptr_array_index(wrk->listen_sockets, i);
+			li_event_stop(&sock->watcher);
+		}
+
 		if (wrk->stat_cache)
 			li_waitqueue_stop(&wrk->stat_cache->delete_queue);
 		/* handle remaining new connections. there shouldn't be any, we'll kill them soon anyway */
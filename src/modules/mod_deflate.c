@@ -9,6 +9,9 @@
 #include <lighttpd/base.h>
 #include <lighttpd/plugin_core.h>
 
+#include <sys/stat.h>
+#include <fcntl.h>
+
 LI_API gboolean mod_deflate_init(liModules *mods, liModule *mod);
 LI_API gboolean mod_deflate_free(liModules *mods, liModule *mod);
 
@@ -20,9 +23,14 @@ LI_API gboolean mod_deflate_free(liModules *mods, liModule *mod);
 #define ENCODING_NAME_COMPRESS   "compress"
 #define ENCODING_NAME_BZIP2      "bzip2"
 #define ENCODING_NAME_X_BZIP2    "x-bzip2"
+#define ENCODING_NAME_BROTLI     "br"
+#define ENCODING_NAME_ZSTD       "zstd"
 
+/* the order is the preference if the client accepts more than one */
 typedef enum {
 	ENCODING_IDENTITY,
+	ENCODING_BROTLI,
+	ENCODING_ZSTD,
 	ENCODING_BZIP2,
 	ENCODING_X_BZIP2,
 	ENCODING_GZIP,
@@ -33,6 +41,8 @@ typedef enum {
 
 static const char* encoding_names[] = {
 	"identity",
+	"br",
+	"zstd",
 	"bzip2",
 	"x-bzip2",
 	"gzip",
@@ -49,6 +59,12 @@ static const guint encoding_available_mask = 0
 #ifdef HAVE_ZLIB
 	| (1 << ENCODING_GZIP) | (1 << ENCODING_X_GZIP) | (1 << ENCODING_DEFLATE)
 #endif
+#ifdef HAVE_BROTLI
+	| (1 << ENCODING_BROTLI)
+#endif
+#ifdef HAVE_ZSTD
+	| (1 << ENCODING_ZSTD)
+#endif
 ;
 
 typedef struct deflate_config deflate_config;
@@ -56,13 +72,89 @@ struct deflate_config {
 	liPlugin *p;
 	guint allowed_encodings;
 	guint blocksize, output_buffer, compression_level;
+	guint brotli_quality, brotli_window, zstd_level, zstd_window; /* zstd_window 0: library default */
+	goffset offload_threshold; /* 0: never offload */
+
+	/* adaptive levels: scale down towards min_compression_level (0: disabled) with the worker load */
+	guint min_compression_level;
+	guint load_lag;            /* event loop lag (ms) that counts as full load */
+	guint load_requests;       /* requests per second (per worker) that count as full load, 0: ignore */
+	goffset load_min_size;     /* don't compress smaller responses (if the length is known) at full load */
+};
+
+/* initialized compression contexts are kept per worker and reused for later responses with the same parameters,
+ * as setting up a z_stream (or zstd context) allocates and clears a lot of memory */
+#define DEFLATE_CONTEXT_CACHE_SIZE 16 /* idle contexts per worker and encoding */
+
+typedef struct deflate_worker_data deflate_worker_data;
+struct deflate_worker_data {
+	GQueue zlib_contexts; /* idle contexts, most recently used first */
+	GQueue zstd_contexts;
+};
+
+typedef struct deflate_cache deflate_cache;
+
+typedef struct deflate_plugin_data deflate_plugin_data;
+struct deflate_plugin_data {
+	guint worker_count;
+	deflate_worker_data *worker_data; /* NULL until the workers are prepared */
+	deflate_cache *cache; /* deflate.cache setup, NULL if disabled */
+};
+
+static deflate_worker_data* deflate_worker_data_get(liVRequest *vr, deflate_config *conf) {
+	deflate_plugin_data *pd = conf->p->data;
+
+	if (NULL == pd->worker_data) return NULL;
+
+	return &pd->worker_data[vr->wrk->ndx];
+}
+
+/* link->data is the context; drops the least recently used one if the cache is full */
+static void deflate_context_cache_put(GQueue *cache, GList *link, GDestroyNotify free_ctx) {
+	g_queue_push_head_link(cache, link);
+
+	if (cache->length > DEFLATE_CONTEXT_CACHE_SIZE) {
+		GList *old = g_queue_pop_tail_link(cache);
+		free_ctx(old->data);
+	}
+}
+
+/* compresses (part of) f->in into f->out; vr is NULL if running in a tasklet */
+typedef liHandlerResult (*deflate_compress_cb)(liVRequest *vr, liFilter *f, gpointer ctx);
+
+/* the out filter param for all encodings */
+typedef struct deflate_filter_data deflate_filter_data;
+struct deflate_filter_data {
+	deflate_compress_cb compress;
+	GDestroyNotify free_ctx;
+	gpointer ctx;
+
+	goffset offload_threshold, offload_size;
+
+	/* offloaded compression: the tasklet works on private queues; while it runs we hold a reference to the filter
+	 * stream and don't touch ctx from the worker */
+	liFilter *filter;
+	gboolean offload_running;
+	liHandlerResult offload_res;
+	liFilter offload;
 };
 
 /**********************************************************************************/
 
 #ifdef HAVE_ZLIB
 
-# include <zlib.h>
+# ifdef HAVE_ZLIB_NG
+/* native zlib-ng API (with its SIMD kernels), mapped to the zlib names */
+#  include <zlib-ng.h>
+#  define z_stream zng_stream
+#  define deflateInit2 zng_deflateInit2
+#  define deflate zng_deflate
+#  define deflateEnd zng_deflateEnd
+#  define deflateReset zng_deflateReset
+#  define crc32 zng_crc32
+# else
+#  include <zlib.h>
+# endif
 
 /* Copied gzip_header from apache 2.2's mod_deflate.c */
 /* RFC 1952 Section 2.3 defines the gzip header:
@@ -85,6 +177,9 @@ struct deflate_context_zlib {
 	GByteArray *buf;
 	gboolean is_gzip, gzip_header;
 	unsigned long crc;
+
+	deflate_worker_data *wd; /* cache to return the context to, may be NULL */
+	GList cache_link;
 };
 
 static void deflate_context_zlib_free(deflate_context_zlib *ctx) {
@@ -99,14 +194,59 @@ static void deflate_context_zlib_free(deflate_context_zlib *ctx) {
 	g_slice_free(deflate_context_zlib, ctx);
 }
 
+/* the filter is done with the context: reset it and keep it for the next response */
+static void deflate_context_zlib_release(deflate_context_zlib *ctx) {
+	if (!ctx) return;
+
+	if (NULL == ctx->wd || Z_OK != deflateReset(&ctx->z)) {
+		deflate_context_zlib_free(ctx);
+		return;
+	}
+
+	deflate_context_cache_put(&ctx->wd->zlib_contexts, &ctx->cache_link, (GDestroyNotify) deflate_context_zlib_free);
+}
+
+/* window bits and memory level are the same for all contexts, so the level (and the buffer size) is the key */
+static deflate_context_zlib* deflate_context_zlib_from_cache(deflate_worker_data *wd, deflate_config *conf, gboolean is_gzip) {
+	GList *link;
+
+	if (NULL == wd) return NULL;
+
+	for (link = wd->zlib_contexts.head; NULL != link; link = link->next) {
+		deflate_context_zlib *ctx = link->data;
+
+		if (ctx->conf.compression_level != conf->compression_level || ctx->conf.output_buffer != conf->output_buffer) continue;
+
+		g_queue_unlink(&wd->zlib_contexts, link);
+
+		ctx->conf = *conf;
+		ctx->is_gzip = is_gzip;
+		ctx->gzip_header = FALSE;
+		ctx->crc = 0;
+		ctx->z.next_out = ctx->buf->data;
+		ctx->z.avail_out = ctx->buf->len;
+
+		return ctx;
+	}
+
+	return NULL;
+}
+
 static deflate_context_zlib* deflate_context_zlib_create(liVRequest *vr, deflate_config *conf, gboolean is_gzip) {
-	deflate_context_zlib *ctx = g_slice_new0(deflate_context_zlib);
-	z_stream *z = &ctx->z;
+	deflate_worker_data *wd = deflate_worker_data_get(vr, conf);
+	deflate_context_zlib *ctx;
+	z_stream *z;
 	guint compression_level = conf->compression_level;
 	guint window_size = -MAX_WBITS; /* supress zlib-header */
 	guint mem_level = 8;
 
+	if (NULL != (ctx = deflate_context_zlib_from_cache(wd, conf, is_gzip))) return ctx;
+
+	ctx = g_slice_new0(deflate_context_zlib);
+	z = &ctx->z;
 	ctx->conf = *conf;
+	ctx->wd = wd;
+	ctx->cache_link.data = ctx;
 
 	z->zalloc = Z_NULL;
 	z->zfree = Z_NULL;
@@ -138,15 +278,8 @@ static deflate_context_zlib* deflate_context_zlib_create(liVRequest *vr, deflate
 	return ctx;
 }
 
-static void deflate_filter_zlib_free(liVRequest *vr, liFilter *f) {
-	deflate_context_zlib *ctx = (deflate_context_zlib*) f->param;
-	UNUSED(vr);
-
-	deflate_context_zlib_free(ctx);
-}
-
-static liHandlerResult deflate_filter_zlib(liVRequest *vr, liFilter *f) {
-	deflate_context_zlib *ctx = (deflate_context_zlib*) f->param;
+static liHandlerResult deflate_compress_zlib(liVRequest *vr, liFilter *f, gpointer param) {
+	deflate_context_zlib *ctx = (deflate_context_zlib*) param;
 	const off_t blocksize = ctx->conf.blocksize;
 	const off_t max_compress = 4 * blocksize;
 	gboolean debug = (NULL != vr) && _OPTION(vr, ctx->conf.p, 0).boolean;
@@ -180,7 +313,7 @@ static liHandlerResult deflate_filter_zlib(liVRequest *vr, liFilter *f) {
 		/* as the buffer is unused it really should be big enough */
 		if (z->avail_out < sizeof(gzip_header)) {
 			f->out->is_closed = TRUE;
-			VR_ERROR(vr, "deflate error: %s", z->msg);
+			if (NULL != vr) VR_ERROR(vr, "deflate error: %s", z->msg);
 			return LI_HANDLER_ERROR;
 		}
 
@@ -355,15 +488,8 @@ static deflate_context_bzip2* deflate_context_bzip2_create(liVRequest *vr, defla
 	return ctx;
 }
 
-static void deflate_filter_bzip2_free(liVRequest *vr, liFilter *f) {
-	deflate_context_bzip2 *ctx = (deflate_context_bzip2*) f->param;
-	UNUSED(vr);
-
-	deflate_context_bzip2_free(ctx);
-}
-
-static liHandlerResult deflate_filter_bzip2(liVRequest *vr, liFilter *f) {
-	deflate_context_bzip2 *ctx = (deflate_context_bzip2*) f->param;
+static liHandlerResult deflate_compress_bzip2(liVRequest *vr, liFilter *f, gpointer param) {
+	deflate_context_bzip2 *ctx = (deflate_context_bzip2*) param;
 	const off_t blocksize = ctx->conf.blocksize;
 	const off_t max_compress = 4 * blocksize;
 	gboolean debug = (NULL != vr) && _OPTION(vr, ctx->conf.p, 0).boolean;
@@ -467,197 +593,1338 @@ static liHandlerResult deflate_filter_bzip2(liVRequest *vr, liFilter *f) {
 }
 #endif /* HAVE_BZIP */
 
-static liHandlerResult deflate_filter_null(liVRequest *vr, liFilter *f) {
-	UNUSED(vr);
-	if (NULL != f->in) {
-		li_chunkqueue_skip_all(f->in);
-		li_stream_disconnect(&f->stream);
-	}
-	return LI_HANDLER_GO_ON;
-}
-
 /**********************************************************************************/
 
-/* returns TRUE if handled with 304, FALSE otherwise */
-static gboolean cached_handle_etag(liVRequest *vr, gboolean debug, liHttpHeader *hh_etag, const char* enc_name) {
-	GString *s = vr->wrk->tmp_str;
+#ifdef HAVE_BROTLI
 
-	if (!hh_etag) return FALSE;
+# include <brotli/encode.h>
 
-	g_string_truncate(s, 0);
-	g_string_append_len(s, LI_HEADER_VALUE_LEN(hh_etag));
-	g_string_append_len(s, CONST_STR_LEN("-"));
-	g_string_append_len(s, enc_name, strlen(enc_name));
-	li_etag_mutate(s, s);
-	g_string_truncate(hh_etag->data, hh_etag->keylen + 2);
-	g_string_append_len(hh_etag->data, GSTR_LEN(s));
+typedef struct deflate_context_brotli deflate_context_brotli;
+struct deflate_context_brotli {
+	deflate_config conf;
 
-	if (200 == vr->response.http_status && li_http_response_handle_cachable(vr)) {
-		if (debug || CORE_OPTION(LI_CORE_OPTION_DEBUG_REQUEST_HANDLING).boolean) {
-			VR_DEBUG(vr, "%s", "deflate: etag handling => 304 Not Modified");
-		}
-		vr->response.http_status = 304;
-		return TRUE;
-	}
-	return FALSE;
+	BrotliEncoderState *state;
+	GByteArray *buf;
+	uint8_t *next_out;
+	size_t avail_out;
+	guint64 total_in;
+};
+
+static void deflate_context_brotli_free(deflate_context_brotli *ctx) {
+	if (!ctx) return;
+
+	BrotliEncoderDestroyInstance(ctx->state);
+
+	g_byte_array_free(ctx->buf, TRUE);
+
+	g_slice_free(deflate_context_brotli, ctx);
 }
 
-static guint header_to_endocing_mask(const gchar *s) {
-	guint encoding_mask = 0, i;
+static deflate_context_brotli* deflate_context_brotli_create(liVRequest *vr, deflate_config *conf) {
+	deflate_context_brotli *ctx = g_slice_new0(deflate_context_brotli);
 
-	for (i = 1; encoding_names[i]; i++) {
-		const gchar *p = strstr(s, encoding_names[i]);
-		if (NULL != p && (p == s || p[-1] == ' ' || p[-1] == ',')) {
-			encoding_mask |= 1 << i;
-		}
+	ctx->conf = *conf;
+
+	if (NULL == (ctx->state = BrotliEncoderCreateInstance(NULL, NULL, NULL))) {
+		VR_ERROR(vr, "%s", "Couldn't create brotli encoder");
+		g_slice_free(deflate_context_brotli, ctx);
+		return NULL;
 	}
 
-	return encoding_mask;
+	BrotliEncoderSetParameter(ctx->state, BROTLI_PARAM_MODE, BROTLI_MODE_TEXT);
+	BrotliEncoderSetParameter(ctx->state, BROTLI_PARAM_QUALITY, conf->brotli_quality);
+	BrotliEncoderSetParameter(ctx->state, BROTLI_PARAM_LGWIN, conf->brotli_window);
+
+	ctx->buf = g_byte_array_new();
+	g_byte_array_set_size(ctx->buf, conf->output_buffer);
+
+	ctx->next_out = ctx->buf->data;
+	ctx->avail_out = ctx->buf->len;
+
+	return ctx;
 }
 
-static liHandlerResult deflate_handle(liVRequest *vr, gpointer param, gpointer *context) {
-	deflate_config *config = (deflate_config*) param;
-	GList *hh_encoding_entry, *hh_etag_entry;
-	liHttpHeader *hh_encoding, *hh_etag = NULL;
-	guint encoding_mask = 0, i;
-	gboolean debug = _OPTION(vr, config->p, 0).boolean;
-	gboolean is_head_request = (vr->request.http_method == LI_HTTP_METHOD_HEAD);
+static void deflate_brotli_flush_buffer(deflate_context_brotli *ctx, liChunkQueue *out) {
+	if (0 < ctx->buf->len - ctx->avail_out) {
+		li_chunkqueue_append_mem(out, ctx->buf->data, ctx->buf->len - ctx->avail_out);
+		ctx->next_out = ctx->buf->data;
+		ctx->avail_out = ctx->buf->len;
+	}
+}
 
-	UNUSED(context);
+/* runs op until all input is consumed and (for flush/finish) all output is available */
+static gboolean deflate_brotli_run(deflate_context_brotli *ctx, liChunkQueue *out, BrotliEncoderOperation op, const uint8_t *data, size_t len) {
+	BrotliEncoderState *s = ctx->state;
 
-	LI_VREQUEST_WAIT_FOR_RESPONSE_HEADERS(vr);
+	do {
+		if (!BrotliEncoderCompressStream(s, op, &len, &data, &ctx->avail_out, &ctx->next_out, NULL)) return FALSE;
 
-	/* disable compression for some http status types. */
-	switch(vr->response.http_status) {
-	case 100:
-	case 101:
-	case 204:
-	case 205:
-	case 206:
-	case 304:
-		/* disable compression as we have no response entity */
+		if (0 == ctx->avail_out) deflate_brotli_flush_buffer(ctx, out);
+	} while (len > 0 || BrotliEncoderHasMoreOutput(s) || (BROTLI_OPERATION_FINISH == op && !BrotliEncoderIsFinished(s)));
+
+	return TRUE;
+}
+
+static liHandlerResult deflate_compress_brotli(liVRequest *vr, liFilter *f, gpointer param) {
+	deflate_context_brotli *ctx = (deflate_context_brotli*) param;
+	const off_t blocksize = ctx->conf.blocksize;
+	const off_t max_compress = 4 * blocksize;
+	gboolean debug = (NULL != vr) && _OPTION(vr, ctx->conf.p, 0).boolean;
+	off_t l = 0;
+	liHandlerResult res;
+
+	if (NULL == f->in) {
+		f->out->is_closed = TRUE;
 		return LI_HANDLER_GO_ON;
-	default:
-		break;
 	}
 
-	/* response already encoded */
-	if (li_http_header_find_first(vr->response.headers, CONST_STR_LEN("content-encoding"))) {
-		if (debug) {
-			VR_DEBUG(vr, "%s", "deflate: Content-Encoding already set => not compressing");
-		}
+	if (f->in->is_closed && 0 == f->in->length && f->out->is_closed) {
+		/* nothing to do anymore */
 		return LI_HANDLER_GO_ON;
 	}
 
-	/* don't mess with content after transfer-encoding */
-	if (li_http_header_find_first(vr->response.headers, CONST_STR_LEN("transfer-encoding"))) {
+	if (f->out->is_closed) {
+		li_chunkqueue_skip_all(f->in);
+		li_stream_disconnect(&f->stream);
 		if (debug) {
-			VR_DEBUG(vr, "%s", "deflate: Transfer-Encoding set => not compressing");
+			VR_DEBUG(vr, "deflate out stream closed: in: %"G_GUINT64_FORMAT, ctx->total_in);
 		}
 		return LI_HANDLER_GO_ON;
 	}
 
-	/* announce that we have looked for accept-encoding */
-	li_http_header_append(vr->response.headers, CONST_STR_LEN("Vary"), CONST_STR_LEN("Accept-Encoding"));
+	while (l < max_compress) {
+		char *data;
+		off_t len;
+		liChunkIter ci;
+		GError *err = NULL;
 
-	hh_encoding_entry = li_http_header_find_first(vr->request.headers, CONST_STR_LEN("accept-encoding"));
-	while (hh_encoding_entry) {
-		hh_encoding = (liHttpHeader*) hh_encoding_entry->data;
-		encoding_mask |= header_to_endocing_mask(LI_HEADER_VALUE(hh_encoding));
-		hh_encoding_entry = li_http_header_find_next(hh_encoding_entry, CONST_STR_LEN("accept-encoding"));
-	}
+		if (0 == f->in->length) break;
 
-	if (0 == encoding_mask)
-		return LI_HANDLER_GO_ON; /* no known encoding found */
+		ci = li_chunkqueue_iter(f->in);
 
-	encoding_mask &= encoding_available_mask & config->allowed_encodings;
-	if (0 == encoding_mask) {
-		if (debug) {
-			VR_DEBUG(vr, "%s", "no common encoding found => not compressing");
+		if (LI_HANDLER_GO_ON != (res = li_chunkiter_read(ci, 0, blocksize, &data, &len, &err))) {
+			if (NULL != err) {
+				if (NULL != vr) VR_ERROR(vr, "Couldn't read data from chunkqueue: %s", err->message);
+				g_error_free(err);
+			}
+			return res;
 		}
-		return LI_HANDLER_GO_ON; /* no common encoding found */
-	}
-
-	/* find best encoding (first in list) */
-	for (i = 1; 0 == (encoding_mask & (1 << i)) ; i++) ;
 
-	hh_etag_entry = li_http_header_find_first(vr->response.headers, CONST_STR_LEN("etag"));
-	if (hh_etag_entry) {
-		if (li_http_header_find_next(hh_etag_entry, CONST_STR_LEN("etag"))) {
-			if (debug || CORE_OPTION(LI_CORE_OPTION_DEBUG_REQUEST_HANDLING).boolean) {
-				VR_DEBUG(vr, "%s", "duplicate etag header in response, will not deflate it");
-			}
-			return LI_HANDLER_GO_ON;
+		if (!deflate_brotli_run(ctx, f->out, BROTLI_OPERATION_PROCESS, (const uint8_t*) data, len)) {
+			f->out->is_closed = TRUE;
+			if (NULL != vr) VR_ERROR(vr, "%s", "brotli compression failed");
+			return LI_HANDLER_ERROR;
 		}
-		hh_etag = (liHttpHeader*) hh_etag_entry->data;
-	}
 
-	if (debug || CORE_OPTION(LI_CORE_OPTION_DEBUG_REQUEST_HANDLING).boolean) {
-		VR_DEBUG(vr, "deflate: compressing using %s encoding", encoding_names[i]);
+		li_chunkqueue_skip(f->in, len);
+		ctx->total_in += len;
+		l += len;
 	}
 
-	switch ((encodings) i) {
-	case ENCODING_IDENTITY:
-		return LI_HANDLER_GO_ON;
-	case ENCODING_BZIP2:
-	case ENCODING_X_BZIP2:
-#ifdef HAVE_BZIP
-		if (cached_handle_etag(vr, debug, hh_etag, encoding_names[i])) return LI_HANDLER_GO_ON;
-		if (!is_head_request) {
-			deflate_context_bzip2 *ctx;
-			ctx = deflate_context_bzip2_create(vr, config);
-			if (!ctx) return LI_HANDLER_GO_ON;
-			li_vrequest_add_filter_out(vr, deflate_filter_bzip2, deflate_filter_bzip2_free, NULL, ctx);
-		}
-		break;
-#endif
-		return LI_HANDLER_GO_ON;
-	case ENCODING_GZIP:
-	case ENCODING_X_GZIP:
-#ifdef HAVE_ZLIB
-		if (cached_handle_etag(vr, debug, hh_etag, encoding_names[i])) return LI_HANDLER_GO_ON;
-		if (!is_head_request) {
-			deflate_context_zlib *ctx;
-			ctx = deflate_context_zlib_create(vr, config, TRUE);
-			if (!ctx) return LI_HANDLER_GO_ON;
-			li_vrequest_add_filter_out(vr, deflate_filter_zlib, deflate_filter_zlib_free, NULL, ctx);
+	if (0 == f->in->length && f->in->is_closed) {
+		if (!deflate_brotli_run(ctx, f->out, BROTLI_OPERATION_FINISH, NULL, 0)) {
+			f->out->is_closed = TRUE;
+			if (NULL != vr) VR_ERROR(vr, "%s", "brotli compression failed");
+			return LI_HANDLER_ERROR;
 		}
-		break;
-#endif
-		return LI_HANDLER_GO_ON;
-	case ENCODING_DEFLATE:
-#ifdef HAVE_ZLIB
-		if (cached_handle_etag(vr, debug, hh_etag, encoding_names[i])) return LI_HANDLER_GO_ON;
-		if (!is_head_request) {
-			deflate_context_zlib *ctx;
-			ctx = deflate_context_zlib_create(vr, config, FALSE);
-			if (!ctx) return LI_HANDLER_GO_ON;
-			li_vrequest_add_filter_out(vr, deflate_filter_zlib, deflate_filter_zlib_free, NULL, ctx);
+		deflate_brotli_flush_buffer(ctx, f->out);
+
+		if (debug) {
+			VR_DEBUG(vr, "deflate finished: in: %"G_GUINT64_FORMAT", out : %"G_GUINT64_FORMAT, ctx->total_in, (guint64) f->out->bytes_in);
 		}
-		break;
-#endif
-		return LI_HANDLER_GO_ON;
-	case ENCODING_COMPRESS:
-		return LI_HANDLER_GO_ON;
-	}
 
-	if (is_head_request) {
-		/* kill content so response.c doesn't send wrong content-length */
-		liFilter *f = li_vrequest_add_filter_out(vr, deflate_filter_null, NULL, NULL, NULL);
 		f->out->is_closed = TRUE;
+	} else if (l > 0 && 0 == f->in->length) { /* flush brotli stream */
+		if (!deflate_brotli_run(ctx, f->out, BROTLI_OPERATION_FLUSH, NULL, 0)) {
+			if (NULL != vr) VR_ERROR(vr, "%s", "brotli compression failed");
+			return LI_HANDLER_ERROR;
+		}
 	}
 
-	li_http_header_insert(vr->response.headers, CONST_STR_LEN("Content-Encoding"), encoding_names[i], strlen(encoding_names[i]));
-	li_http_header_remove(vr->response.headers, CONST_STR_LEN("content-length"));
+	/* flush output buffer if there is no more data pending */
+	if (0 == f->in->length) deflate_brotli_flush_buffer(ctx, f->out);
 
-	return LI_HANDLER_GO_ON;
+	return 0 == f->in->length ? LI_HANDLER_GO_ON : LI_HANDLER_COMEBACK;
 }
+#endif /* HAVE_BROTLI */
 
-static void deflate_free(liServer *srv, gpointer param) {
-	deflate_config *conf = (deflate_config*) param;
-	UNUSED(srv);
+/**********************************************************************************/
 
-	g_slice_free(deflate_config, conf);
+#ifdef HAVE_ZSTD
+
+# include <zstd.h>
+
+typedef struct deflate_context_zstd deflate_context_zstd;
+struct deflate_context_zstd {
+	deflate_config conf;
+
+	ZSTD_CCtx *cctx;
+	GByteArray *buf;
+	ZSTD_outBuffer out;
+	guint64 total_in;
+
+	deflate_worker_data *wd; /* cache to return the context to, may be NULL */
+	GList cache_link;
+};
+
+static void deflate_context_zstd_free(deflate_context_zstd *ctx) {
+	if (!ctx) return;
+
+	ZSTD_freeCCtx(ctx->cctx);
+
+	g_byte_array_free(ctx->buf, TRUE);
+
+	g_slice_free(deflate_context_zstd, ctx);
+}
+
+/* the filter is done with the context: reset the session (keeps the parameters) and keep it for the next response */
+static void deflate_context_zstd_release(deflate_context_zstd *ctx) {
+	if (!ctx) return;
+
+	if (NULL == ctx->wd || ZSTD_isError(ZSTD_CCtx_reset(ctx->cctx, ZSTD_reset_session_only))) {
+		deflate_context_zstd_free(ctx);
+		return;
+	}
+
+	deflate_context_cache_put(&ctx->wd->zstd_contexts, &ctx->cache_link, (GDestroyNotify) deflate_context_zstd_free);
+}
+
+static deflate_context_zstd* deflate_context_zstd_from_cache(deflate_worker_data *wd, deflate_config *conf) {
+	GList *link;
+
+	if (NULL == wd) return NULL;
+
+	for (link = wd->zstd_contexts.head; NULL != link; link = link->next) {
+		deflate_context_zstd *ctx = link->data;
+
+		if (ctx->conf.zstd_level != conf->zstd_level || ctx->conf.zstd_window != conf->zstd_window
+				|| ctx->conf.output_buffer != conf->output_buffer) continue;
+
+		g_queue_unlink(&wd->zstd_contexts, link);
+
+		ctx->conf = *conf;
+		ctx->total_in = 0;
+		ctx->out.pos = 0;
+
+		return ctx;
+	}
+
+	return NULL;
+}
+
+static deflate_context_zstd* deflate_context_zstd_create(liVRequest *vr, deflate_config *conf) {
+	deflate_worker_data *wd = deflate_worker_data_get(vr, conf);
+	deflate_context_zstd *ctx;
+
+	if (NULL != (ctx = deflate_context_zstd_from_cache(wd, conf))) return ctx;
+
+	ctx = g_slice_new0(deflate_context_zstd);
+	ctx->conf = *conf;
+	ctx->wd = wd;
+	ctx->cache_link.data = ctx;
+
+	if (NULL == (ctx->cctx = ZSTD_createCCtx())) {
+		VR_ERROR(vr, "%s", "Couldn't create zstd context");
+		g_slice_free(deflate_context_zstd, ctx);
+		return NULL;
+	}
+
+	if (ZSTD_isError(ZSTD_CCtx_setParameter(ctx->cctx, ZSTD_c_compressionLevel, conf->zstd_level))
+			|| (0 != conf->zstd_window && ZSTD_isError(ZSTD_CCtx_setParameter(ctx->cctx, ZSTD_c_windowLog, conf->zstd_window)))) {
+		VR_ERROR(vr, "%s", "Couldn't set zstd parameters");
+		ZSTD_freeCCtx(ctx->cctx);
+		g_slice_free(deflate_context_zstd, ctx);
+		return NULL;
+	}
+
+	ctx->buf = g_byte_array_new();
+	g_byte_array_set_size(ctx->buf, conf->output_buffer);
+
+	ctx->out.dst = ctx->buf->data;
+	ctx->out.size = ctx->buf->len;
+	ctx->out.pos = 0;
+
+	return ctx;
+}
+
+static void deflate_zstd_flush_buffer(deflate_context_zstd *ctx, liChunkQueue *out) {
+	if (0 < ctx->out.pos) {
+		li_chunkqueue_append_mem(out, ctx->buf->data, ctx->out.pos);
+		ctx->out.pos = 0;
+	}
+}
+
+/* runs mode until all input is consumed and (for flush/end) all output is available */
+static gboolean deflate_zstd_run(deflate_context_zstd *ctx, liChunkQueue *out, ZSTD_EndDirective mode, const char *data, size_t len) {
+	ZSTD_inBuffer in = { data, len, 0 };
+	size_t remaining;
+
+	do {
+		remaining = ZSTD_compressStream2(ctx->cctx, &ctx->out, &in, mode);
+		if (ZSTD_isError(remaining)) return FALSE;
+
+		if (ctx->out.pos == ctx->out.size) deflate_zstd_flush_buffer(ctx, out);
+	} while (in.pos < in.size || (ZSTD_e_continue != mode && 0 != remaining));
+
+	return TRUE;
+}
+
+static liHandlerResult deflate_compress_zstd(liVRequest *vr, liFilter *f, gpointer param) {
+	deflate_context_zstd *ctx = (deflate_context_zstd*) param;
+	const off_t blocksize = ctx->conf.blocksize;
+	const off_t max_compress = 4 * blocksize;
+	gboolean debug = (NULL != vr) && _OPTION(vr, ctx->conf.p, 0).boolean;
+	off_t l = 0;
+	liHandlerResult res;
+
+	if (NULL == f->in) {
+		f->out->is_closed = TRUE;
+		return LI_HANDLER_GO_ON;
+	}
+
+	if (f->in->is_closed && 0 == f->in->length && f->out->is_closed) {
+		/* nothing to do anymore */
+		return LI_HANDLER_GO_ON;
+	}
+
+	if (f->out->is_closed) {
+		li_chunkqueue_skip_all(f->in);
+		li_stream_disconnect(&f->stream);
+		if (debug) {
+			VR_DEBUG(vr, "deflate out stream closed: in: %"G_GUINT64_FORMAT, ctx->total_in);
+		}
+		return LI_HANDLER_GO_ON;
+	}
+
+	while (l < max_compress) {
+		char *data;
+		off_t len;
+		liChunkIter ci;
+		GError *err = NULL;
+
+		if (0 == f->in->length) break;
+
+		ci = li_chunkqueue_iter(f->in);
+
+		if (LI_HANDLER_GO_ON != (res = li_chunkiter_read(ci, 0, blocksize, &data, &len, &err))) {
+			if (NULL != err) {
+				if (NULL != vr) VR_ERROR(vr, "Couldn't read data from chunkqueue: %s", err->message);
+				g_error_free(err);
+			}
+			return res;
+		}
+
+		if (!deflate_zstd_run(ctx, f->out, ZSTD_e_continue, data, len)) {
+			f->out->is_closed = TRUE;
+			if (NULL != vr) VR_ERROR(vr, "%s", "zstd compression failed");
+			return LI_HANDLER_ERROR;
+		}
+
+		li_chunkqueue_skip(f->in, len);
+		ctx->total_in += len;
+		l += len;
+	}
+
+	if (0 == f->in->length && f->in->is_closed) {
+		if (!deflate_zstd_run(ctx, f->out, ZSTD_e_end, NULL, 0)) {
+			f->out->is_closed = TRUE;
+			if (NULL != vr) VR_ERROR(vr, "%s", "zstd compression failed");
+			return LI_HANDLER_ERROR;
+		}
+		deflate_zstd_flush_buffer(ctx, f->out);
+
+		if (debug) {
+			VR_DEBUG(vr, "deflate finished: in: %"G_GUINT64_FORMAT", out : %"G_GUINT64_FORMAT, ctx->total_in, (guint64) f->out->bytes_in);
+		}
+
+		f->out->is_closed = TRUE;
+	} else if (l > 0 && 0 == f->in->length) { /* flush zstd stream */
+		if (!deflate_zstd_run(ctx, f->out, ZSTD_e_flush, NULL, 0)) {
+			if (NULL != vr) VR_ERROR(vr, "%s", "zstd compression failed");
+			return LI_HANDLER_ERROR;
+		}
+	}
+
+	/* flush output buffer if there is no more data pending */
+	if (0 == f->in->length) deflate_zstd_flush_buffer(ctx, f->out);
+
+	return 0 == f->in->length ? LI_HANDLER_GO_ON : LI_HANDLER_COMEBACK;
+}
+#endif /* HAVE_ZSTD */
+
+/**********************************************************************************/
+
+/* runs in a tasklet thread: only touches the private queues and ctx */
+static void deflate_offload_run(gpointer data) {
+	deflate_filter_data *fd = (deflate_filter_data*) data;
+
+	do {
+		fd->offload_res = fd->compress(NULL, &fd->offload, fd->ctx);
+	} while (LI_HANDLER_COMEBACK == fd->offload_res);
+}
+
+static void deflate_offload_finished(gpointer data) {
+	deflate_filter_data *fd = (deflate_filter_data*) data;
+	liFilter *f = fd->filter;
+
+	fd->offload_running = FALSE;
+
+	if (LI_HANDLER_ERROR == fd->offload_res) {
+		li_chunkqueue_skip_all(fd->offload.in);
+		li_chunkqueue_skip_all(fd->offload.out);
+		f->in = NULL;
+		if (NULL != f->vr) {
+			VR_ERROR(f->vr, "%s", "deflate: compression failed");
+			li_vrequest_error(f->vr);
+		}
+		li_stream_reset(&f->stream);
+	} else if (NULL != f->out && !f->out->is_closed) {
+		li_chunkqueue_steal_all(f->out, fd->offload.out);
+		if (fd->offload.out->is_closed) f->out->is_closed = TRUE;
+		li_stream_notify(&f->stream);
+		li_stream_again(&f->stream);
+	} else {
+		li_chunkqueue_skip_all(fd->offload.out);
+	}
+
+	/* may destroy the filter (and fd) */
+	li_stream_release(&f->stream);
+}
+
+/* moves the next part of the input to the private queue and starts a tasklet for it */
+static liHandlerResult deflate_offload_start(liVRequest *vr, liFilter *f, deflate_filter_data *fd) {
+	liChunkIter ci;
+	GError *err = NULL;
+
+	if (0 == f->in->length && !f->in->is_closed) return LI_HANDLER_GO_ON;
+
+	li_chunkqueue_steal_len(fd->offload.in, f->in, fd->offload_size);
+	fd->offload.in->is_closed = (f->in->is_closed && 0 == f->in->length);
+
+	/* the tasklet must not open (possibly shared) files */
+	if (fd->offload.in->length > 0) {
+		ci = li_chunkqueue_iter(fd->offload.in);
+		do {
+			liChunk *c = li_chunkiter_chunk(ci);
+			if (FILE_CHUNK == c->type && LI_HANDLER_GO_ON != li_chunkfile_open(c->data.file.file, &err)) {
+				VR_ERROR(vr, "deflate: couldn't open file: %s", NULL != err ? err->message : "unknown error");
+				if (NULL != err) g_error_free(err);
+				return LI_HANDLER_ERROR;
+			}
+		} while (li_chunkiter_next(&ci));
+	}
+
+	fd->offload_running = TRUE;
+	li_stream_acquire(&f->stream);
+	li_tasklet_push(vr->wrk->tasklets, deflate_offload_run, deflate_offload_finished, fd);
+
+	return LI_HANDLER_WAIT_FOR_EVENT;
+}
+
+static liHandlerResult deflate_filter(liVRequest *vr, liFilter *f) {
+	deflate_filter_data *fd = (deflate_filter_data*) f->param;
+
+	/* deflate_offload_finished triggers us again */
+	if (fd->offload_running) return LI_HANDLER_WAIT_FOR_EVENT;
+
+	if (NULL != vr && NULL != f->in && !f->out->is_closed
+			&& 0 != fd->offload_threshold && f->in->bytes_in >= fd->offload_threshold) {
+		return deflate_offload_start(vr, f, fd);
+	}
+
+	return fd->compress(vr, f, fd->ctx);
+}
+
+static void deflate_filter_free(liVRequest *vr, liFilter *f) {
+	deflate_filter_data *fd = (deflate_filter_data*) f->param;
+	UNUSED(vr);
+
+	LI_FORCE_ASSERT(!fd->offload_running);
+
+	fd->free_ctx(fd->ctx);
+	li_chunkqueue_free(fd->offload.in);
+	li_chunkqueue_free(fd->offload.out);
+
+	g_slice_free(deflate_filter_data, fd);
+}
+
+static void deflate_add_filter(liVRequest *vr, deflate_config *conf, deflate_compress_cb compress, GDestroyNotify free_ctx, gpointer ctx) {
+	deflate_filter_data *fd = g_slice_new0(deflate_filter_data);
+	liFilter *f;
+
+	fd->compress = compress;
+	fd->free_ctx = free_ctx;
+	fd->ctx = ctx;
+	fd->offload_threshold = conf->offload_threshold;
+	fd->offload_size = 4 * conf->blocksize; /* same amount as compressed in one round without offloading */
+	fd->offload.in = li_chunkqueue_new();
+	fd->offload.out = li_chunkqueue_new();
+	fd->offload.param = fd;
+
+	if (NULL == (f = li_vrequest_add_filter_out(vr, deflate_filter, deflate_filter_free, NULL, fd))) {
+		deflate_filter_free(vr, &fd->offload);
+		return;
+	}
+
+	fd->filter = f;
+}
+
+static liHandlerResult deflate_filter_null(liVRequest *vr, liFilter *f) {
+	UNUSED(vr);
+	if (NULL != f->in) {
+		li_chunkqueue_skip_all(f->in);
+		li_stream_disconnect(&f->stream);
+	}
+	return LI_HANDLER_GO_ON;
+}
+
+/**********************************************************************************/
+
+/* returns TRUE if handled with 304, FALSE otherwise */
+static gboolean cached_handle_etag(liVRequest *vr, gboolean debug, liHttpHeader *hh_etag, const char* enc_name) {
+	GString *s = vr->wrk->tmp_str;
+
+	if (!hh_etag) return FALSE;
+
+	g_string_truncate(s, 0);
+	g_string_append_len(s, LI_HEADER_VALUE_LEN(hh_etag));
+	g_string_append_len(s, CONST_STR_LEN("-"));
+	g_string_append_len(s, enc_name, strlen(enc_name));
+	li_etag_mutate(s, s);
+	g_string_truncate(hh_etag->data, hh_etag->keylen + 2);
+	g_string_append_len(hh_etag->data, GSTR_LEN(s));
+
+	if (200 == vr->response.http_status && li_http_response_handle_cachable(vr)) {
+		if (debug || CORE_OPTION(LI_CORE_OPTION_DEBUG_REQUEST_HANDLING).boolean) {
+			VR_DEBUG(vr, "%s", "deflate: etag handling => 304 Not Modified");
+		}
+		vr->response.http_status = 304;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/* the static handler (static.precompressed) may have announced it already */
+static gboolean vary_has_accept_encoding(liVRequest *vr) {
+	GList *l;
+
+	for (l = li_http_header_find_first(vr->response.headers, CONST_STR_LEN("vary")); NULL != l;
+			l = li_http_header_find_next(l, CONST_STR_LEN("vary"))) {
+		liHttpHeader *h = (liHttpHeader*) l->data;
+		if (NULL != g_strstr_len(LI_HEADER_VALUE(h), -1, "Accept-Encoding")) return TRUE;
+	}
+
+	return FALSE;
+}
+
+static guint header_to_endocing_mask(const gchar *s) {
+	guint encoding_mask = 0, i;
+
+	for (i = 1; encoding_names[i]; i++) {
+		const gchar *p = strstr(s, encoding_names[i]);
+		if (NULL != p && (p == s || p[-1] == ' ' || p[-1] == ',')) {
+			encoding_mask |= 1 << i;
+		}
+	}
+
+	return encoding_mask;
+}
+
+/* 0: idle .. 1: full load */
+static double deflate_load(liWorker *wrk, deflate_config *conf) {
+	double load = 0, l;
+
+	if (conf->load_lag > 0) {
+		load = wrk->stats.loop_lag * 1000 / conf->load_lag;
+	}
+	if (conf->load_requests > 0) {
+		l = wrk->stats.requests_per_sec / conf->load_requests;
+		if (l > load) load = l;
+	}
+
+	return MIN(load, 1.0);
+}
+
+static guint deflate_scale_level(guint level, guint min_level, double load) {
+	if (min_level >= level) return level;
+	return level - (guint) (load * (level - min_level) + 0.5);
+}
+
+/* level actually used for encoding i, exported as DEFLATE_LEVEL */
+static guint deflate_encoding_level(deflate_config *conf, encodings i) {
+	switch (i) {
+	case ENCODING_BROTLI:
+		return conf->brotli_quality;
+	case ENCODING_ZSTD:
+		return conf->zstd_level;
+	default:
+		return conf->compression_level;
+	}
+}
+
+static goffset deflate_response_length(liVRequest *vr) {
+	GList *l = li_http_header_find_first(vr->response.headers, CONST_STR_LEN("content-length"));
+	gchar *end;
+	gint64 len;
+
+	if (NULL == l) return -1;
+
+	len = g_ascii_strtoll(LI_HEADER_VALUE((liHttpHeader*) l->data), &end, 10);
+	if ('\0' != *end || len < 0) return -1;
+
+	return len;
+}
+
+/* disk cache for compressed static files (deflate.cache setup)
+ *
+ * If a response is an unmodified static file, the compressed output is written to a temporary file in the cache
+ * directory (like mod_cache_disk_etag) and renamed when complete; later requests for the same file and encoding are
+ * served from it (as file chunk, i.e. with sendfile). Entries are keyed by physical path and encoding and are only
+ * valid for the inode, mtime and size of the file when they were created, so a changed file (as reported by the stat
+ * cache) drops its old variants. The total size is bounded, the least recently used files are removed first.
+ * The index is shared by all workers. At setup the cache directory is scanned to rebuild it from the files of a previous
+ * run: left over temporary files and older variants of the same key are removed, and the total size is bounded again.
+ */
+
+typedef struct deflate_cache_entry deflate_cache_entry;
+struct deflate_cache_entry {
+	GString *key;      /* physical path + "." + encoding */
+	GString *filename;
+	ino_t ino;
+	time_t mtime;
+	off_t size;        /* of the uncompressed file */
+	goffset length;    /* of the compressed file */
+	GList lru_link;
+};
+
+struct deflate_cache {
+	GMutex *mutex;
+	GString *path;
+	goffset max_size, size;
+	GHashTable *entries; /* key -> entry */
+	GQueue lru;          /* most recently used first */
+};
+
+typedef struct deflate_cache_file deflate_cache_file;
+struct deflate_cache_file {
+	deflate_cache *cache;
+	GString *key, *filename, *tmpfilename;
+	struct stat st;
+	int fd;
+	goffset length;
+};
+
+static deflate_cache* deflate_cache_new(GString *path, goffset max_size) {
+	deflate_cache *cache = g_slice_new0(deflate_cache);
+
+	cache->mutex = g_mutex_new();
+	cache->path = path;
+	cache->max_size = max_size;
+	cache->entries = g_hash_table_new((GHashFunc) g_string_hash, (GEqualFunc) g_string_equal);
+	g_queue_init(&cache->lru);
+
+	return cache;
+}
+
+/* needs lock; doesn't remove the file */
+static void deflate_cache_remove(deflate_cache *cache, deflate_cache_entry *ce) {
+	g_queue_unlink(&cache->lru, &ce->lru_link);
+	g_hash_table_remove(cache->entries, ce->key);
+	cache->size -= ce->length;
+
+	g_string_free(ce->key, TRUE);
+	g_string_free(ce->filename, TRUE);
+	g_slice_free(deflate_cache_entry, ce);
+}
+
+/* needs lock */
+static void deflate_cache_drop(deflate_cache *cache, deflate_cache_entry *ce) {
+	unlink(ce->filename->str);
+	deflate_cache_remove(cache, ce);
+}
+
+static void deflate_cache_free(deflate_cache *cache) {
+	if (NULL == cache) return;
+
+	while (NULL != cache->lru.head) {
+		deflate_cache_remove(cache, cache->lru.head->data);
+	}
+
+	g_hash_table_destroy(cache->entries);
+	g_string_free(cache->path, TRUE);
+	g_mutex_free(cache->mutex);
+	g_slice_free(deflate_cache, cache);
+}
+
+/* needs lock */
+static void deflate_cache_insert(deflate_cache *cache, GString *key, GString *filename, struct stat *st, goffset length) {
+	deflate_cache_entry *ce;
+
+	if (NULL != (ce = g_hash_table_lookup(cache->entries, key))) {
+		/* another request might have stored the same file (same name) before, don't remove the new one */
+		if (!g_string_equal(ce->filename, filename)) unlink(ce->filename->str);
+		deflate_cache_remove(cache, ce);
+	}
+
+	while (cache->size + length > cache->max_size && NULL != cache->lru.tail) {
+		deflate_cache_drop(cache, cache->lru.tail->data);
+	}
+
+	ce = g_slice_new0(deflate_cache_entry);
+	ce->key = g_string_new_len(GSTR_LEN(key));
+	ce->filename = g_string_new_len(GSTR_LEN(filename));
+	ce->ino = st->st_ino;
+	ce->mtime = st->st_mtime;
+	ce->size = st->st_size;
+	ce->length = length;
+	ce->lru_link.data = ce;
+
+	g_hash_table_insert(cache->entries, ce->key, ce);
+	g_queue_push_head_link(&cache->lru, &ce->lru_link);
+	cache->size += length;
+}
+
+static void deflate_cache_names(deflate_cache *cache, liVRequest *vr, struct stat *st, const char *enc_name, GString *key, GString *filename) {
+	g_string_truncate(key, 0);
+	g_string_append_len(key, GSTR_LEN(vr->physical.path));
+	g_string_append_c(key, '.');
+	g_string_append(key, enc_name);
+
+	g_string_truncate(filename, 0);
+	g_string_append_len(filename, GSTR_LEN(cache->path));
+	if (key->str[0] != '/') g_string_append_c(filename, '/');
+	g_string_append_len(filename, GSTR_LEN(key));
+	g_string_append_printf(filename, "-%" G_GINT64_MODIFIER "x-%" G_GINT64_MODIFIER "x-%" G_GINT64_MODIFIER "x",
+		(guint64) st->st_ino, (guint64) st->st_mtime, (guint64) st->st_size);
+}
+
+/* strips a "-<hex>" suffix from s[0..*len) */
+static gboolean deflate_cache_parse_hex(const gchar *s, gsize *len, guint64 *value) {
+	gsize i = *len;
+
+	while (i > 0 && g_ascii_isxdigit(s[i-1])) i--;
+	if (i == *len || *len - i > 16 || i < 2 || '-' != s[i-1]) return FALSE;
+
+	*value = g_ascii_strtoull(s + i, NULL, 16);
+	*len = i - 1;
+	return TRUE;
+}
+
+/* parses the names created by deflate_cache_names: <key>-<ino>-<mtime>-<size>, the key ends in .<encoding> */
+static gboolean deflate_cache_parse_name(const gchar *s, gsize len, gsize *key_len, struct stat *st) {
+	guint64 ino, mtime, size;
+	guint i;
+
+	if (!deflate_cache_parse_hex(s, &len, &size)) return FALSE;
+	if (!deflate_cache_parse_hex(s, &len, &mtime)) return FALSE;
+	if (!deflate_cache_parse_hex(s, &len, &ino)) return FALSE;
+
+	for (i = 0; i < G_N_ELEMENTS(encoding_names) && NULL != encoding_names[i]; i++) {
+		gsize n = strlen(encoding_names[i]);
+		if (len > n + 1 && '.' == s[len - n - 1] && 0 == memcmp(s + len - n, encoding_names[i], n)) {
+			*key_len = len;
+			st->st_ino = ino;
+			st->st_mtime = mtime;
+			st->st_size = size;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+typedef struct deflate_cache_scan_entry deflate_cache_scan_entry;
+struct deflate_cache_scan_entry {
+	GString *key, *filename;
+	struct stat st;    /* ino, mtime and size of the uncompressed file */
+	goffset length;
+	time_t written;    /* mtime of the cached file */
+};
+
+static void deflate_cache_scan_dir(liServer *srv, deflate_cache *cache, GString *dirname, GPtrArray *found) {
+	GDir *dir;
+	GError *err = NULL;
+	const gchar *name;
+	gsize dirlen = dirname->len;
+
+	if (NULL == (dir = g_dir_open(dirname->str, 0, &err))) {
+		if (!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+			ERROR(srv, "deflate.cache: couldn't scan cache directory: %s", err->message);
+		}
+		g_error_free(err);
+		return;
+	}
+
+	while (NULL != (name = g_dir_read_name(dir))) {
+		struct stat st, orig_st;
+		gsize key_len;
+
+		g_string_truncate(dirname, dirlen);
+		g_string_append_c(dirname, '/');
+		g_string_append(dirname, name);
+
+		if (-1 == lstat(dirname->str, &st)) continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			deflate_cache_scan_dir(srv, cache, dirname, found);
+		} else if (!S_ISREG(st.st_mode)) {
+			continue;
+		} else if (deflate_cache_parse_name(dirname->str, dirname->len, &key_len, &orig_st)) {
+			deflate_cache_scan_entry *se = g_slice_new0(deflate_cache_scan_entry);
+			se->key = g_string_new_len(dirname->str + cache->path->len, key_len - cache->path->len);
+			se->filename = g_string_new_len(GSTR_LEN(dirname));
+			se->st = orig_st;
+			se->length = st.st_size;
+			se->written = st.st_mtime;
+			g_ptr_array_add(found, se);
+		} else if (dirname->len > 7 && '-' == dirname->str[dirname->len - 7]
+				&& deflate_cache_parse_name(dirname->str, dirname->len - 7, &key_len, &orig_st)) {
+			/* temporary file (mkstemp suffix) of an interrupted store */
+			unlink(dirname->str);
+		}
+	}
+
+	g_string_truncate(dirname, dirlen);
+	g_dir_close(dir);
+}
+
+static gint deflate_cache_scan_entry_cmp(gconstpointer a, gconstpointer b) {
+	const deflate_cache_scan_entry *sa = *(const deflate_cache_scan_entry* const*) a;
+	const deflate_cache_scan_entry *sb = *(const deflate_cache_scan_entry* const*) b;
+
+	return (sa->written < sb->written) ? -1 : (sa->written > sb->written);
+}
+
+/* rebuilds the index from the files in the cache directory; the most recently written files are kept */
+static void deflate_cache_scan(liServer *srv, deflate_cache *cache) {
+	GPtrArray *found = g_ptr_array_new();
+	GString *dirname = g_string_new_len(GSTR_LEN(cache->path));
+	guint i;
+
+	deflate_cache_scan_dir(srv, cache, dirname, found);
+	g_string_free(dirname, TRUE);
+
+	/* oldest first: later variants of the same key replace (and remove) earlier ones, and the
+	 * least recently written files are evicted first if the cache is too big */
+	g_ptr_array_sort(found, deflate_cache_scan_entry_cmp);
+
+	g_mutex_lock(cache->mutex);
+	for (i = 0; i < found->len; i++) {
+		deflate_cache_scan_entry *se = g_ptr_array_index(found, i);
+
+		if (0 == se->length || se->length > cache->max_size) {
+			unlink(se->filename->str);
+		} else {
+			deflate_cache_insert(cache, se->key, se->filename, &se->st, se->length);
+		}
+
+		g_string_free(se->key, TRUE);
+		g_string_free(se->filename, TRUE);
+		g_slice_free(deflate_cache_scan_entry, se);
+	}
+	g_mutex_unlock(cache->mutex);
+
+	g_ptr_array_free(found, TRUE);
+}
+
+/* whether the response (headers) is the unmodified static file vr->physical.path; fills st */
+static liHandlerResult deflate_cache_check_static(liVRequest *vr, struct stat *st) {
+	liStatCacheEntryData *sced = NULL;
+	liChunkFile *cf = NULL;
+	liHttpHeader *hh;
+	GList *l;
+	int err;
+	liHandlerResult res;
+
+	if (200 != vr->response.http_status || NULL == vr->direct_out || !vr->direct_out->is_closed) return LI_HANDLER_ERROR;
+	if (NULL != vr->filters_out_first) return LI_HANDLER_ERROR; /* someone else modifies the content */
+	if (0 == vr->physical.path->len) return LI_HANDLER_ERROR;
+	if (deflate_response_length(vr) < 0) return LI_HANDLER_ERROR;
+
+	res = li_stat_cache_get_file(vr, vr->physical.path, st, &err, &cf, &sced);
+	if (LI_HANDLER_WAIT_FOR_EVENT == res) return res;
+	li_chunkfile_release(cf);
+	if (LI_HANDLER_GO_ON != res || NULL == sced || NULL == sced->last_modified) return LI_HANDLER_ERROR;
+
+	if (!S_ISREG(st->st_mode) || st->st_size != deflate_response_length(vr)) return LI_HANDLER_ERROR;
+
+	/* the static handler sets Last-Modified from the stat cache */
+	if (NULL == (l = li_http_header_find_first(vr->response.headers, CONST_STR_LEN("last-modified")))) return LI_HANDLER_ERROR;
+	hh = (liHttpHeader*) l->data;
+	if (0 != strcmp(LI_HEADER_VALUE(hh), sced->last_modified->str)) return LI_HANDLER_ERROR;
+
+	return LI_HANDLER_GO_ON;
+}
+
+static liHandlerResult deflate_cache_filter_hit(liVRequest *vr, liFilter *f) {
+	UNUSED(vr);
+
+	if (NULL != f->in) {
+		li_chunkqueue_skip_all(f->in);
+		li_stream_disconnect(&f->stream);
+	}
+
+	return LI_HANDLER_GO_ON;
+}
+
+/* returns the length of the cached file it added to the response, -1 on a cache miss */
+static goffset deflate_cache_hit(liVRequest *vr, deflate_cache *cache, struct stat *st, const char *enc_name) {
+	deflate_cache_entry *ce;
+	GString *key, *filename;
+	struct stat cst;
+	liFilter *f;
+	int fd;
+
+	if (NULL == cache) return -1;
+
+	key = g_string_sized_new(vr->physical.path->len + 8);
+	filename = g_string_sized_new(cache->path->len + vr->physical.path->len + 64);
+	deflate_cache_names(cache, vr, st, enc_name, key, filename);
+
+	g_mutex_lock(cache->mutex);
+	if (NULL != (ce = g_hash_table_lookup(cache->entries, key))) {
+		if (ce->ino == st->st_ino && ce->mtime == st->st_mtime && ce->size == st->st_size) {
+			g_queue_unlink(&cache->lru, &ce->lru_link);
+			g_queue_push_head_link(&cache->lru, &ce->lru_link);
+		} else {
+			/* file changed */
+			deflate_cache_drop(cache, ce);
+		}
+	}
+	g_mutex_unlock(cache->mutex);
+
+	if (-1 == (fd = open(filename->str, O_RDONLY))) goto miss;
+	if (-1 == fstat(fd, &cst) || !S_ISREG(cst.st_mode) || 0 == cst.st_size) {
+		close(fd);
+		goto miss;
+	}
+
+	/* (re)register it: files from a previous run or removed by someone else */
+	g_mutex_lock(cache->mutex);
+	ce = g_hash_table_lookup(cache->entries, key);
+	if (NULL == ce || ce->length != cst.st_size) {
+		deflate_cache_insert(cache, key, filename, st, cst.st_size);
+	}
+	g_mutex_unlock(cache->mutex);
+
+	f = li_vrequest_add_filter_out(vr, deflate_cache_filter_hit, NULL, NULL, NULL);
+	if (NULL == f) {
+		close(fd);
+		goto miss;
+	}
+	li_chunkqueue_append_file_fd(f->out, NULL, 0, cst.st_size, fd);
+	f->out->is_closed = TRUE;
+
+	g_string_free(key, TRUE);
+	g_string_free(filename, TRUE);
+	return cst.st_size;
+
+miss:
+	g_mutex_lock(cache->mutex);
+	if (NULL != (ce = g_hash_table_lookup(cache->entries, key))) deflate_cache_remove(cache, ce);
+	g_mutex_unlock(cache->mutex);
+
+	g_string_free(key, TRUE);
+	g_string_free(filename, TRUE);
+	return -1;
+}
+
+static gboolean deflate_cache_mkdir_for_file(liVRequest *vr, char *filename) {
+	char *p = filename;
+
+	if (!filename || !filename[0])
+		return FALSE;
+
+	while ((p = strchr(p + 1, '/')) != NULL) {
+		*p = '\0';
+		if ((mkdir(filename, 0700) != 0) && (errno != EEXIST)) {
+			VR_ERROR(vr, "creating deflate cache directory '%s' failed: %s", filename, g_strerror(errno));
+			*p = '/';
+			return FALSE;
+		}
+
+		*p++ = '/';
+		if (!*p) {
+			VR_ERROR(vr, "unexpected trailing slash for filename '%s'", filename);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static void deflate_cache_file_free(deflate_cache_file *cfile) {
+	if (!cfile) return;
+
+	if (-1 != cfile->fd) {
+		close(cfile->fd);
+		unlink(cfile->tmpfilename->str);
+	}
+	g_string_free(cfile->key, TRUE);
+	g_string_free(cfile->filename, TRUE);
+	g_string_free(cfile->tmpfilename, TRUE);
+	g_slice_free(deflate_cache_file, cfile);
+}
+
+static void deflate_cache_file_finish(liVRequest *vr, deflate_cache_file *cfile) {
+	close(cfile->fd);
+	cfile->fd = -1;
+
+	if (-1 == rename(cfile->tmpfilename->str, cfile->filename->str)) {
+		if (NULL != vr) VR_ERROR(vr, "Couldn't move temporary deflate cache file '%s': '%s'", cfile->tmpfilename->str, g_strerror(errno));
+		unlink(cfile->tmpfilename->str);
+	} else if (cfile->length > cfile->cache->max_size) {
+		unlink(cfile->filename->str);
+	} else {
+		g_mutex_lock(cfile->cache->mutex);
+		deflate_cache_insert(cfile->cache, cfile->key, cfile->filename, &cfile->st, cfile->length);
+		g_mutex_unlock(cfile->cache->mutex);
+	}
+
+	deflate_cache_file_free(cfile);
+}
+
+static void deflate_cache_filter_store_free(liVRequest *vr, liFilter *f) {
+	deflate_cache_file *cfile = (deflate_cache_file*) f->param;
+	UNUSED(vr);
+	f->param = NULL;
+
+	deflate_cache_file_free(cfile);
+}
+
+/* forwards the compressed data and writes a copy to the temporary cache file */
+static liHandlerResult deflate_cache_filter_store(liVRequest *vr, liFilter *f) {
+	deflate_cache_file *cfile = (deflate_cache_file*) f->param;
+	ssize_t res;
+	gchar *buf;
+	off_t buflen;
+	liChunkIter citer;
+	GError *err = NULL;
+
+	if (NULL == f->in) {
+		deflate_cache_filter_store_free(vr, f);
+		/* didn't handle f->in->is_closed? abort forwarding */
+		if (!f->out->is_closed) li_stream_reset(&f->stream);
+		return LI_HANDLER_GO_ON;
+	}
+
+	if (NULL == cfile) goto forward;
+
+	if (f->in->length > 0) {
+		citer = li_chunkqueue_iter(f->in);
+		if (LI_HANDLER_GO_ON != li_chunkiter_read(citer, 0, 64*1024, &buf, &buflen, &err)) {
+			if (NULL != err) {
+				if (NULL != vr) VR_ERROR(vr, "Couldn't read data from chunkqueue: %s", err->message);
+				g_error_free(err);
+			} else {
+				if (NULL != vr) VR_ERROR(vr, "%s", "Couldn't read data from chunkqueue");
+			}
+			deflate_cache_filter_store_free(vr, f);
+			goto forward;
+		}
+
+		res = write(cfile->fd, buf, buflen);
+		if (res < 0) {
+			switch (errno) {
+			case EINTR:
+			case EAGAIN:
+				return LI_HANDLER_COMEBACK;
+			default:
+				if (NULL != vr) VR_ERROR(vr, "Couldn't write to temporary deflate cache file '%s': %s",
+					cfile->tmpfilename->str, g_strerror(errno));
+				deflate_cache_filter_store_free(vr, f);
+				goto forward;
+			}
+		} else {
+			cfile->length += res;
+			if (!f->out->is_closed) {
+				li_chunkqueue_steal_len(f->out, f->in, res);
+			} else {
+				li_chunkqueue_skip(f->in, res);
+			}
+		}
+	}
+
+	if (0 == f->in->length && f->in->is_closed) {
+		f->out->is_closed = TRUE;
+		f->param = NULL;
+		deflate_cache_file_finish(vr, cfile);
+		return LI_HANDLER_GO_ON;
+	}
+
+	return LI_HANDLER_GO_ON;
+
+forward:
+	if (f->out->is_closed) {
+		li_chunkqueue_skip_all(f->in);
+		li_stream_disconnect(&f->stream);
+	} else {
+		li_chunkqueue_steal_all(f->out, f->in);
+		if (f->in->is_closed) f->out->is_closed = f->in->is_closed;
+	}
+	return LI_HANDLER_GO_ON;
+}
+
+/* adds a filter after the compression filter writing the output to the cache */
+static void deflate_cache_store(liVRequest *vr, deflate_cache *cache, struct stat *st, const char *enc_name) {
+	deflate_cache_file *cfile;
+
+	if (NULL == cache || st->st_size > cache->max_size) return;
+
+	cfile = g_slice_new0(deflate_cache_file);
+	cfile->cache = cache;
+	cfile->st = *st;
+	cfile->fd = -1;
+	cfile->key = g_string_sized_new(vr->physical.path->len + 8);
+	cfile->filename = g_string_sized_new(cache->path->len + vr->physical.path->len + 64);
+	deflate_cache_names(cache, vr, st, enc_name, cfile->key, cfile->filename);
+
+	cfile->tmpfilename = g_string_sized_new(cfile->filename->len + 7);
+	g_string_append_len(cfile->tmpfilename, GSTR_LEN(cfile->filename));
+	g_string_append_len(cfile->tmpfilename, CONST_STR_LEN("-XXXXXX"));
+
+	if (!deflate_cache_mkdir_for_file(vr, cfile->tmpfilename->str)) {
+		deflate_cache_file_free(cfile);
+		return;
+	}
+
+	errno = 0; /* posix doesn't define any errors */
+	if (-1 == (cfile->fd = mkstemp(cfile->tmpfilename->str))) {
+		VR_ERROR(vr, "Couldn't create deflate cache tempfile '%s': %s", cfile->tmpfilename->str, g_strerror(errno));
+		deflate_cache_file_free(cfile);
+		return;
+	}
+
+	li_vrequest_add_filter_out(vr, deflate_cache_filter_store, deflate_cache_filter_store_free, NULL, cfile);
+}
+
+static liHandlerResult deflate_handle(liVRequest *vr, gpointer param, gpointer *context) {
+	deflate_config *config = (deflate_config*) param;
+	deflate_config conf = *config;
+	GList *hh_encoding_entry, *hh_etag_entry;
+	liHttpHeader *hh_encoding, *hh_etag = NULL;
+	guint encoding_mask = 0, i;
+	gboolean debug = _OPTION(vr, config->p, 0).boolean;
+	gboolean is_head_request = (vr->request.http_method == LI_HTTP_METHOD_HEAD);
+	deflate_cache *cache = ((deflate_plugin_data*) config->p->data)->cache;
+	struct stat st;
+	goffset cached_length = -1;
+
+	UNUSED(context);
+
+	LI_VREQUEST_WAIT_FOR_RESPONSE_HEADERS(vr);
+
+	/* disable compression for some http status types. */
+	switch(vr->response.http_status) {
+	case 100:
+	case 101:
+	case 204:
+	case 205:
+	case 206:
+	case 304:
+		/* disable compression as we have no response entity */
+		return LI_HANDLER_GO_ON;
+	default:
+		break;
+	}
+
+	/* response already encoded */
+	if (li_http_header_find_first(vr->response.headers, CONST_STR_LEN("content-encoding"))) {
+		if (debug) {
+			VR_DEBUG(vr, "%s", "deflate: Content-Encoding already set => not compressing");
+		}
+		return LI_HANDLER_GO_ON;
+	}
+
+	/* don't mess with content after transfer-encoding */
+	if (li_http_header_find_first(vr->response.headers, CONST_STR_LEN("transfer-encoding"))) {
+		if (debug) {
+			VR_DEBUG(vr, "%s", "deflate: Transfer-Encoding set => not compressing");
+		}
+		return LI_HANDLER_GO_ON;
+	}
+
+	/* announce that we have looked for accept-encoding */
+	if (!vary_has_accept_encoding(vr)) {
+		li_http_header_append(vr->response.headers, CONST_STR_LEN("Vary"), CONST_STR_LEN("Accept-Encoding"));
+	}
+
+	hh_encoding_entry = li_http_header_find_first(vr->request.headers, CONST_STR_LEN("accept-encoding"));
+	while (hh_encoding_entry) {
+		hh_encoding = (liHttpHeader*) hh_encoding_entry->data;
+		encoding_mask |= header_to_endocing_mask(LI_HEADER_VALUE(hh_encoding));
+		hh_encoding_entry = li_http_header_find_next(hh_encoding_entry, CONST_STR_LEN("accept-encoding"));
+	}
+
+	if (0 == encoding_mask)
+		return LI_HANDLER_GO_ON; /* no known encoding found */
+
+	encoding_mask &= encoding_available_mask & config->allowed_encodings;
+	if (0 == encoding_mask) {
+		if (debug) {
+			VR_DEBUG(vr, "%s", "no common encoding found => not compressing");
+		}
+		return LI_HANDLER_GO_ON; /* no common encoding found */
+	}
+
+	/* find best encoding (first in list) */
+	for (i = 1; 0 == (encoding_mask & (1 << i)) ; i++) ;
+
+	if (NULL != cache) {
+		/* only unmodified static files are cached */
+		liHandlerResult res = is_head_request ? LI_HANDLER_ERROR : deflate_cache_check_static(vr, &st);
+		if (LI_HANDLER_WAIT_FOR_EVENT == res) return res;
+		if (LI_HANDLER_GO_ON != res) cache = NULL;
+	}
+
+	if (0 != config->min_compression_level) {
+		double load = deflate_load(vr->wrk, config);
+
+		if (load >= 1.0 && config->load_min_size > 0) {
+			goffset len = deflate_response_length(vr);
+			if (len >= 0 && len < config->load_min_size) {
+				if (debug) {
+					VR_DEBUG(vr, "%s", "deflate: small response at full load => not compressing");
+				}
+				return LI_HANDLER_GO_ON;
+			}
+		}
+
+		conf.compression_level = deflate_scale_level(config->compression_level, config->min_compression_level, load);
+		conf.brotli_quality = deflate_scale_level(config->brotli_quality, 1, load);
+		conf.zstd_level = deflate_scale_level(config->zstd_level, 1, load);
+
+		if (debug) {
+			VR_DEBUG(vr, "deflate: load %.2f => compression level %u", load, deflate_encoding_level(&conf, (encodings) i));
+		}
+	}
+
+	hh_etag_entry = li_http_header_find_first(vr->response.headers, CONST_STR_LEN("etag"));
+	if (hh_etag_entry) {
+		if (li_http_header_find_next(hh_etag_entry, CONST_STR_LEN("etag"))) {
+			if (debug || CORE_OPTION(LI_CORE_OPTION_DEBUG_REQUEST_HANDLING).boolean) {
+				VR_DEBUG(vr, "%s", "duplicate etag header in response, will not deflate it");
+			}
+			return LI_HANDLER_GO_ON;
+		}
+		hh_etag = (liHttpHeader*) hh_etag_entry->data;
+	}
+
+	if (debug || CORE_OPTION(LI_CORE_OPTION_DEBUG_REQUEST_HANDLING).boolean) {
+		VR_DEBUG(vr, "deflate: compressing using %s encoding", encoding_names[i]);
+	}
+
+	switch ((encodings) i) {
+	case ENCODING_IDENTITY:
+		return LI_HANDLER_GO_ON;
+	case ENCODING_BROTLI:
+#ifdef HAVE_BROTLI
+		if (cached_handle_etag(vr, debug, hh_etag, encoding_names[i])) return LI_HANDLER_GO_ON;
+		if (!is_head_request) {
+			deflate_context_brotli *ctx;
+			if (-1 != (cached_length = deflate_cache_hit(vr, cache, &st, encoding_names[i]))) break;
+			ctx = deflate_context_brotli_create(vr, &conf);
+			if (!ctx) return LI_HANDLER_GO_ON;
+			deflate_add_filter(vr, &conf, deflate_compress_brotli, (GDestroyNotify) deflate_context_brotli_free, ctx);
+			deflate_cache_store(vr, cache, &st, encoding_names[i]);
+		}
+		break;
+#endif
+		return LI_HANDLER_GO_ON;
+	case ENCODING_ZSTD:
+#ifdef HAVE_ZSTD
+		if (cached_handle_etag(vr, debug, hh_etag, encoding_names[i])) return LI_HANDLER_GO_ON;
+		if (!is_head_request) {
+			deflate_context_zstd *ctx;
+			if (-1 != (cached_length = deflate_cache_hit(vr, cache, &st, encoding_names[i]))) break;
+			ctx = deflate_context_zstd_create(vr, &conf);
+			if (!ctx) return LI_HANDLER_GO_ON;
+			deflate_add_filter(vr, &conf, deflate_compress_zstd, (GDestroyNotify) deflate_context_zstd_release, ctx);
+			deflate_cache_store(vr, cache, &st, encoding_names[i]);
+		}
+		break;
+#endif
+		return LI_HANDLER_GO_ON;
+	case ENCODING_BZIP2:
+	case ENCODING_X_BZIP2:
+#ifdef HAVE_BZIP
+		if (cached_handle_etag(vr, debug, hh_etag, encoding_names[i])) return LI_HANDLER_GO_ON;
+		if (!is_head_request) {
+			deflate_context_bzip2 *ctx;
+			if (-1 != (cached_length = deflate_cache_hit(vr, cache, &st, encoding_names[i]))) break;
+			ctx = deflate_context_bzip2_create(vr, &conf);
+			if (!ctx) return LI_HANDLER_GO_ON;
+			deflate_add_filter(vr, &conf, deflate_compress_bzip2, (GDestroyNotify) deflate_context_bzip2_free, ctx);
+			deflate_cache_store(vr, cache, &st, encoding_names[i]);
+		}
+		break;
+#endif
+		return LI_HANDLER_GO_ON;
+	case ENCODING_GZIP:
+	case ENCODING_X_GZIP:
+#ifdef HAVE_ZLIB
+		if (cached_handle_etag(vr, debug, hh_etag, encoding_names[i])) return LI_HANDLER_GO_ON;
+		if (!is_head_request) {
+			deflate_context_zlib *ctx;
+			if (-1 != (cached_length = deflate_cache_hit(vr, cache, &st, encoding_names[i]))) break;
+			ctx = deflate_context_zlib_create(vr, &conf, TRUE);
+			if (!ctx) return LI_HANDLER_GO_ON;
+			deflate_add_filter(vr, &conf, deflate_compress_zlib, (GDestroyNotify) deflate_context_zlib_release, ctx);
+			deflate_cache_store(vr, cache, &st, encoding_names[i]);
+		}
+		break;
+#endif
+		return LI_HANDLER_GO_ON;
+	case ENCODING_DEFLATE:
+#ifdef HAVE_ZLIB
+		if (cached_handle_etag(vr, debug, hh_etag, encoding_names[i])) return LI_HANDLER_GO_ON;
+		if (!is_head_request) {
+			deflate_context_zlib *ctx;
+			if (-1 != (cached_length = deflate_cache_hit(vr, cache, &st, encoding_names[i]))) break;
+			ctx = deflate_context_zlib_create(vr, &conf, FALSE);
+			if (!ctx) return LI_HANDLER_GO_ON;
+			deflate_add_filter(vr, &conf, deflate_compress_zlib, (GDestroyNotify) deflate_context_zlib_release, ctx);
+			deflate_cache_store(vr, cache, &st, encoding_names[i]);
+		}
+		break;
+#endif
+		return LI_HANDLER_GO_ON;
+	case ENCODING_COMPRESS:
+		return LI_HANDLER_GO_ON;
+	}
+
+	if (is_head_request) {
+		/* kill content so response.c doesn't send wrong content-length */
+		liFilter *f = li_vrequest_add_filter_out(vr, deflate_filter_null, NULL, NULL, NULL);
+		f->out->is_closed = TRUE;
+	}
+
+	li_http_header_insert(vr->response.headers, CONST_STR_LEN("Content-Encoding"), encoding_names[i], strlen(encoding_names[i]));
+
+	if (-1 != cached_length) {
+		GString *tmp = vr->wrk->tmp_str;
+		g_string_truncate(tmp, 0);
+		li_string_append_int(tmp, cached_length);
+		li_http_header_overwrite(vr->response.headers, CONST_STR_LEN("Content-Length"), GSTR_LEN(tmp));
+		return LI_HANDLER_GO_ON;
+	}
+
+	li_http_header_remove(vr->response.headers, CONST_STR_LEN("content-length"));
+
+	if (0 != config->min_compression_level) {
+		GString *tmp = vr->wrk->tmp_str;
+		g_string_printf(tmp, "%u", deflate_encoding_level(&conf, (encodings) i));
+		li_environment_set(&vr->env, CONST_STR_LEN("DEFLATE_LEVEL"), GSTR_LEN(tmp));
+	}
+
+	return LI_HANDLER_GO_ON;
+}
+
+static void deflate_free(liServer *srv, gpointer param) {
+	deflate_config *conf = (deflate_config*) param;
+	UNUSED(srv);
+
+	g_slice_free(deflate_config, conf);
 }
 
 /* deflate option names */
@@ -665,7 +1932,16 @@ static const GString
 	don_encodings = { CONST_STR_LEN("encodings"), 0 },
 	don_blocksize = { CONST_STR_LEN("blocksize"), 0 },
 	don_outputbuffer = { CONST_STR_LEN("output-buffer"), 0 },
-	don_compression_level = { CONST_STR_LEN("compression-level"), 0 }
+	don_compression_level = { CONST_STR_LEN("compression-level"), 0 },
+	don_brotli_quality = { CONST_STR_LEN("brotli-quality"), 0 },
+	don_brotli_window = { CONST_STR_LEN("brotli-window"), 0 },
+	don_zstd_level = { CONST_STR_LEN("zstd-level"), 0 },
+	don_zstd_window = { CONST_STR_LEN("zstd-window"), 0 },
+	don_offload_threshold = { CONST_STR_LEN("offload-threshold"), 0 },
+	don_min_compression_level = { CONST_STR_LEN("min-compression-level"), 0 },
+	don_load_lag = { CONST_STR_LEN("load-lag"), 0 },
+	don_load_requests = { CONST_STR_LEN("load-requests"), 0 },
+	don_load_min_size = { CONST_STR_LEN("load-min-size"), 0 }
 ;
 
 static liAction* deflate_create(liServer *srv, liWorker *wrk, liPlugin* p, liValue *val, gpointer userdata) {
@@ -674,7 +1950,16 @@ static liAction* deflate_create(liServer *srv, liWorker *wrk, liPlugin* p, liVal
 		have_encodings_parameter = FALSE,
 		have_blocksize_parameter = FALSE,
 		have_outputbuffer_parameter = FALSE,
-		have_compression_level_parameter = FALSE;
+		have_compression_level_parameter = FALSE,
+		have_brotli_quality_parameter = FALSE,
+		have_brotli_window_parameter = FALSE,
+		have_zstd_level_parameter = FALSE,
+		have_zstd_window_parameter = FALSE,
+		have_offload_threshold_parameter = FALSE,
+		have_min_compression_level_parameter = FALSE,
+		have_load_lag_parameter = FALSE,
+		have_load_requests_parameter = FALSE,
+		have_load_min_size_parameter = FALSE;
 	UNUSED(wrk); UNUSED(userdata);
 
 	val = li_value_get_single_argument(val);
@@ -690,6 +1975,11 @@ static liAction* deflate_create(liServer *srv, liWorker *wrk, liPlugin* p, liVal
 	conf->blocksize = 16*1024;
 	conf->output_buffer = 4*1024;
 	conf->compression_level = 1;
+	conf->brotli_quality = 4;
+	conf->brotli_window = 20;
+	conf->zstd_level = 3;
+	conf->zstd_window = 0;
+	conf->load_lag = 100;
 
 	LI_VALUE_FOREACH(entry, val)
 		liValue *entryKey = li_value_list_at(entry, 0);
@@ -746,12 +2036,116 @@ static liAction* deflate_create(liServer *srv, liWorker *wrk, liPlugin* p, liVal
 			}
 			have_compression_level_parameter = TRUE;
 			conf->compression_level = entryValue->data.number;
+		} else if (g_string_equal(entryKeyStr, &don_brotli_quality)) {
+			if (LI_VALUE_NUMBER != li_value_type(entryValue) || entryValue->data.number < 0 || entryValue->data.number > 11) {
+				ERROR(srv, "deflate option '%s' expects an integer between 0 and 11 as parameter", entryKeyStr->str);
+				goto option_failed;
+			}
+			if (have_brotli_quality_parameter) {
+				ERROR(srv, "duplicate deflate option '%s'", entryKeyStr->str);
+				goto option_failed;
+			}
+			have_brotli_quality_parameter = TRUE;
+			conf->brotli_quality = entryValue->data.number;
+		} else if (g_string_equal(entryKeyStr, &don_brotli_window)) {
+			if (LI_VALUE_NUMBER != li_value_type(entryValue) || entryValue->data.number < 10 || entryValue->data.number > 24) {
+				ERROR(srv, "deflate option '%s' expects an integer between 10 and 24 as parameter", entryKeyStr->str);
+				goto option_failed;
+			}
+			if (have_brotli_window_parameter) {
+				ERROR(srv, "duplicate deflate option '%s'", entryKeyStr->str);
+				goto option_failed;
+			}
+			have_brotli_window_parameter = TRUE;
+			conf->brotli_window = entryValue->data.number;
+		} else if (g_string_equal(entryKeyStr, &don_zstd_level)) {
+			if (LI_VALUE_NUMBER != li_value_type(entryValue) || entryValue->data.number <= 0 || entryValue->data.number > 22) {
+				ERROR(srv, "deflate option '%s' expects an integer between 1 and 22 as parameter", entryKeyStr->str);
+				goto option_failed;
+			}
+			if (have_zstd_level_parameter) {
+				ERROR(srv, "duplicate deflate option '%s'", entryKeyStr->str);
+				goto option_failed;
+			}
+			have_zstd_level_parameter = TRUE;
+			conf->zstd_level = entryValue->data.number;
+		} else if (g_string_equal(entryKeyStr, &don_zstd_window)) {
+			if (LI_VALUE_NUMBER != li_value_type(entryValue) || (0 != entryValue->data.number && (entryValue->data.number < 10 || entryValue->data.number > 27))) {
+				ERROR(srv, "deflate option '%s' expects 0 or an integer between 10 and 27 as parameter", entryKeyStr->str);
+				goto option_failed;
+			}
+			if (have_zstd_window_parameter) {
+				ERROR(srv, "duplicate deflate option '%s'", entryKeyStr->str);
+				goto option_failed;
+			}
+			have_zstd_window_parameter = TRUE;
+			conf->zstd_window = entryValue->data.number;
+		} else if (g_string_equal(entryKeyStr, &don_offload_threshold)) {
+			if (LI_VALUE_NUMBER != li_value_type(entryValue) || entryValue->data.number < 0) {
+				ERROR(srv, "deflate option '%s' expects non-negative integer as parameter", entryKeyStr->str);
+				goto option_failed;
+			}
+			if (have_offload_threshold_parameter) {
+				ERROR(srv, "duplicate deflate option '%s'", entryKeyStr->str);
+				goto option_failed;
+			}
+			have_offload_threshold_parameter = TRUE;
+			conf->offload_threshold = entryValue->data.number;
+		} else if (g_string_equal(entryKeyStr, &don_min_compression_level)) {
+			if (LI_VALUE_NUMBER != li_value_type(entryValue) || entryValue->data.number <= 0 || entryValue->data.number > 9) {
+				ERROR(srv, "deflate option '%s' expects an integer between 1 and 9 as parameter", entryKeyStr->str);
+				goto option_failed;
+			}
+			if (have_min_compression_level_parameter) {
+				ERROR(srv, "duplicate deflate option '%s'", entryKeyStr->str);
+				goto option_failed;
+			}
+			have_min_compression_level_parameter = TRUE;
+			conf->min_compression_level = entryValue->data.number;
+		} else if (g_string_equal(entryKeyStr, &don_load_lag)) {
+			if (LI_VALUE_NUMBER != li_value_type(entryValue) || entryValue->data.number < 0) {
+				ERROR(srv, "deflate option '%s' expects non-negative integer as parameter", entryKeyStr->str);
+				goto option_failed;
+			}
+			if (have_load_lag_parameter) {
+				ERROR(srv, "duplicate deflate option '%s'", entryKeyStr->str);
+				goto option_failed;
+			}
+			have_load_lag_parameter = TRUE;
+			conf->load_lag = entryValue->data.number;
+		} else if (g_string_equal(entryKeyStr, &don_load_requests)) {
+			if (LI_VALUE_NUMBER != li_value_type(entryValue) || entryValue->data.number < 0) {
+				ERROR(srv, "deflate option '%s' expects non-negative integer as parameter", entryKeyStr->str);
+				goto option_failed;
+			}
+			if (have_load_requests_parameter) {
+				ERROR(srv, "duplicate deflate option '%s'", entryKeyStr->str);
+				goto option_failed;
+			}
+			have_load_requests_parameter = TRUE;
+			conf->load_requests = entryValue->data.number;
+		} else if (g_string_equal(entryKeyStr, &don_load_min_size)) {
+			if (LI_VALUE_NUMBER != li_value_type(entryValue) || entryValue->data.number < 0) {
+				ERROR(srv, "deflate option '%s' expects non-negative integer as parameter", entryKeyStr->str);
+				goto option_failed;
+			}
+			if (have_load_min_size_parameter) {
+				ERROR(srv, "duplicate deflate option '%s'", entryKeyStr->str);
+				goto option_failed;
+			}
+			have_load_min_size_parameter = TRUE;
+			conf->load_min_size = entryValue->data.number;
 		} else {
 			ERROR(srv, "unknown option for deflate '%s'", entryKeyStr->str);
 			goto option_failed;
 		}
 	LI_VALUE_END_FOREACH()
 
+	if (conf->min_compression_level > conf->compression_level) {
+		ERROR(srv, "deflate option 'min-compression-level' (%u) must not be greater than 'compression-level' (%u)", conf->min_compression_level, conf->compression_level);
+		goto option_failed;
+	}
+
 	return li_action_new_function(deflate_handle, NULL, deflate_free, conf);
 
 option_failed:
@@ -770,17 +2164,130 @@ static const liPluginAction actions[] = {
 	{ NULL, NULL, NULL }
 };
 
+static gboolean deflate_setup_cache(liServer *srv, liPlugin* p, liValue *val, gpointer userdata) {
+	deflate_plugin_data *pd = p->data;
+	GString *path = NULL;
+	gint64 max_size = 256*1024*1024;
+	UNUSED(userdata);
+
+	val = li_value_get_single_argument(val);
+
+	if (LI_VALUE_BOOLEAN == li_value_type(val) && !val->data.boolean) {
+		deflate_cache_free(pd->cache);
+		pd->cache = NULL;
+		return TRUE;
+	} else if (LI_VALUE_STRING == li_value_type(val)) {
+		path = li_value_extract_string(val);
+	} else if (NULL == (val = li_value_to_key_value_list(val))) {
+		ERROR(srv, "%s", "deflate.cache expects false, a path or a hash/key-value list as parameter");
+		return FALSE;
+	} else {
+		LI_VALUE_FOREACH(entry, val)
+			liValue *entryKey = li_value_list_at(entry, 0);
+			liValue *entryValue = li_value_list_at(entry, 1);
+			GString *entryKeyStr;
+
+			if (LI_VALUE_STRING != li_value_type(entryKey)) {
+				ERROR(srv, "%s", "deflate.cache doesn't take default keys");
+				goto failed;
+			}
+			entryKeyStr = entryKey->data.string; /* keys are either NONE or STRING */
+
+			if (g_str_equal(entryKeyStr->str, "path")) {
+				if (LI_VALUE_STRING != li_value_type(entryValue) || NULL != path) {
+					ERROR(srv, "%s", "deflate.cache option 'path' expects a single string as parameter");
+					goto failed;
+				}
+				path = li_value_extract_string(entryValue);
+			} else if (g_str_equal(entryKeyStr->str, "max-size")) {
+				if (LI_VALUE_NUMBER != li_value_type(entryValue) || entryValue->data.number <= 0) {
+					ERROR(srv, "deflate.cache option '%s' expects positive integer as parameter", entryKeyStr->str);
+					goto failed;
+				}
+				max_size = entryValue->data.number;
+			} else {
+				ERROR(srv, "unknown option for deflate.cache '%s'", entryKeyStr->str);
+				goto failed;
+			}
+		LI_VALUE_END_FOREACH()
+	}
+
+	if (NULL == path || 0 == path->len) {
+		ERROR(srv, "%s", "deflate.cache: missing path");
+		goto failed;
+	}
+
+	/* strip trailing slashes, the physical path (starting with a slash) gets appended */
+	while (path->len > 1 && '/' == path->str[path->len - 1]) g_string_truncate(path, path->len - 1);
+
+	deflate_cache_free(pd->cache);
+	pd->cache = deflate_cache_new(path, max_size);
+	deflate_cache_scan(srv, pd->cache);
+
+	return TRUE;
+
+failed:
+	if (NULL != path) g_string_free(path, TRUE);
+	return FALSE;
+}
+
 static const liPluginSetup setups[] = {
+	{ "deflate.cache", deflate_setup_cache, NULL },
+
 	{ NULL, NULL, NULL }
 };
 
 
+static void deflate_prepare(liServer *srv, liPlugin *p) {
+	deflate_plugin_data *pd = p->data;
+	guint i;
+
+	pd->worker_count = srv->worker_count;
+	pd->worker_data = g_slice_alloc0(sizeof(deflate_worker_data) * pd->worker_count);
+	for (i = 0; i < pd->worker_count; i++) {
+		g_queue_init(&pd->worker_data[i].zlib_contexts);
+		g_queue_init(&pd->worker_data[i].zstd_contexts);
+	}
+}
+
+static void plugin_deflate_free(liServer *srv, liPlugin *p) {
+	deflate_plugin_data *pd = p->data;
+	guint i;
+	UNUSED(srv);
+
+	if (NULL != pd->worker_data) {
+		for (i = 0; i < pd->worker_count; i++) {
+			GList *link;
+			while (NULL != (link = g_queue_pop_head_link(&pd->worker_data[i].zlib_contexts))) {
+#ifdef HAVE_ZLIB
+				deflate_context_zlib_free(link->data);
+#endif
+			}
+			while (NULL != (link = g_queue_pop_head_link(&pd->worker_data[i].zstd_contexts))) {
+#ifdef HAVE_ZSTD
+				deflate_context_zstd_free(link->data);
+#endif
+			}
+		}
+		g_slice_free1(sizeof(deflate_worker_data) * pd->worker_count, pd->worker_data);
+	}
+
+	deflate_cache_free(pd->cache);
+
+	g_slice_free(deflate_plugin_data, pd);
+}
+
 static void plugin_init(liServer *srv, liPlugin *p, gpointer userdata) {
 	UNUSED(srv); UNUSED(userdata);
 
+	p->data = g_slice_new0(deflate_plugin_data);
+
 	p->options = options;
 	p->actions = actions;
 	p->setups = setups;
+
+	p->free = plugin_deflate_free;
+	p->handle_prepare = deflate_prepare;
 }
 
 gboolean mod_deflate_init(liModules *mods, liModule *mod) {
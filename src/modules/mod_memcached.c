@@ -248,15 +248,15 @@ option_failed:
 }
 
 static void mc_ctx_build_key(GString *dest, memcached_ctx *ctx, liVRequest *vr) {
-	GMatchInfo *match_info = NULL;
+	liRegexMatch *match = NULL;
 
 	if (vr->action_stack.regex_stack->len) {
 		GArray *rs = vr->action_stack.regex_stack;
-		match_info = g_array_index(rs, liActionRegexStackElement, rs->len - 1).match_info;
+		match = &g_array_index(rs, liActionRegexStackElement, rs->len - 1).match;
 	}
 
 	g_string_truncate(dest, 0);
-	li_pattern_eval(vr, dest, ctx->pattern, NULL, NULL, li_pattern_regex_cb, match_info);
+	li_pattern_eval(vr, dest, ctx->pattern, NULL, NULL, li_pattern_regex_cb, match);
 
 	li_memcached_mutate_key(dest);
 }
@@ -48,6 +48,7 @@ struct openssl_context {
 	gint refcount;
 
 	SSL_CTX *ssl_ctx;
+	gboolean ktls;
 };
 
 enum {
@@ -217,6 +218,8 @@ static gboolean openssl_con_new(liConnection *con, int fd) {
 		return FALSE;
 	}
 
+	if (ctx->ktls) li_openssl_filter_enable_ktls(conctx->ssl_filter, fd);
+
 	conctx->con = con;
 	con->con_sock.data = conctx;
 	con->con_sock.callbacks = &openssl_tcp_cbs;
@@ -503,7 +506,8 @@ static gboolean openssl_setup(liServer *srv, liPlugin* p, liValue *val, gpointer
 		have_verify_parameter = FALSE,
 		have_verify_depth_parameter = FALSE,
 		have_verify_any_parameter = FALSE,
-		have_verify_require_parameter = FALSE;
+		have_verify_require_parameter = FALSE,
+		have_ktls_parameter = FALSE;
 	const char
 		*ciphers = NULL, *pemfile = NULL, *ca_file = NULL, *client_ca_file = NULL, *dh_params_file = NULL, *ecdh_curve = NULL;
 	long
@@ -518,7 +522,8 @@ static gboolean openssl_setup(liServer *srv, liPlugin* p, liValue *val, gpointer
 	guint
 		verify_mode = 0, verify_depth = 1;
 	gboolean
-		verify_any = FALSE;
+		verify_any = FALSE,
+		ktls = FALSE;
 
 	UNUSED(p); UNUSED(userdata);
 
@@ -670,6 +675,20 @@ static gboolean openssl_setup(liServer *srv, liPlugin* p, liValue *val, gpointer
 			have_verify_require_parameter = TRUE;
 			if (entryValue->data.boolean)
 				verify_mode |= SSL_VERIFY_FAIL_IF_NO_PEER_CERT;
+		} else if (g_str_equal(entryKeyStr->str, "ktls")) {
+#ifndef USE_OPENSSL_KTLS
+			WARNING(srv, "%s", "kernel TLS is not supported by this build => ktls has no effect");
+#endif
+			if (LI_VALUE_BOOLEAN != li_value_type(entryValue)) {
+				ERROR(srv, "%s", "openssl ktls expects a boolean as parameter");
+				return FALSE;
+			}
+			if (have_ktls_parameter) {
+				ERROR(srv, "openssl unexpected duplicate parameter %s", entryKeyStr->str);
+				return FALSE;
+			}
+			have_ktls_parameter = TRUE;
+			ktls = entryValue->data.boolean;
 		} else if (g_str_equal(entryKeyStr->str, "client-ca-file")) {
 			if (LI_VALUE_STRING != li_value_type(entryValue)) {
 				ERROR(srv, "%s", "openssl client-ca-file expects a string as parameter");
@@ -698,6 +717,7 @@ static gboolean openssl_setup(liServer *srv, liPlugin* p, liValue *val, gpointer
 	}
 
 	ctx = mod_openssl_context_new();
+	ctx->ktls = ktls;
 
 	if (NULL == (ctx->ssl_ctx = SSL_CTX_new(SSLv23_server_method()))) {
 		ERROR(srv, "SSL_CTX_new: %s", ERR_error_string(ERR_get_error(), NULL));
@@ -21,7 +21,7 @@ LI_API gboolean mod_redirect_free(liModules *mods, liModule *mod);
 typedef struct redirect_rule redirect_rule;
 struct redirect_rule {
 	liPattern *pattern;
-	GRegex *regex;
+	liRegex *regex;
 	enum {
 		REDIRECT_ABSOLUTE_URI,
 		REDIRECT_ABSOLUTE_PATH,
@@ -59,10 +59,10 @@ static gboolean redirect_rule_parse(liServer *srv, GString *regex, GString *str,
 
 	if (NULL != regex) {
 		GError *err = NULL;
-		rule->regex = g_regex_new(regex->str, G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, &err);
+		rule->regex = li_regex_new(regex->str, &err);
 
-		if (NULL == rule->regex || NULL != err) {
-			ERROR(srv, "redirect: error compiling regex \"%s\": %s", regex->str, NULL != err ? err->message : "unknown error");
+		if (NULL == rule->regex) {
+			ERROR(srv, "redirect: error compiling regex \"%s\": %s", regex->str, err->message);
 			g_error_free(err);
 			goto error;
 		}
@@ -76,7 +76,7 @@ error:
 		rule->pattern = NULL;
 	}
 	if (NULL != rule->regex) {
-		g_regex_unref(rule->regex);
+		li_regex_free(rule->regex);
 		rule->regex = NULL;
 	}
 
@@ -84,23 +84,21 @@ error:
 }
 
 static gboolean redirect_internal(liVRequest *vr, GString *dest, redirect_rule *rule) {
-	gchar *path;
-	GMatchInfo *match_info = NULL;
-	GMatchInfo *prev_match_info = NULL;
+	GString *path;
+	liRegexMatch match, *pmatch = NULL;
+	liRegexMatch *prev_match = NULL;
 
-	path = vr->request.uri.path->str;
+	path = vr->request.uri.path;
 
-	if (NULL != rule->regex && !g_regex_match(rule->regex, path, 0, &match_info)) {
-		if (match_info) {
-			g_match_info_free(match_info);
-		}
-
-		return FALSE;
+	if (NULL != rule->regex) {
+		/* the offsets are valid until the next match in this worker, which can't happen before we're done */
+		if (!li_regex_match(rule->regex, vr->wrk->regex_match_data, GSTR_LEN(path), &match)) return FALSE;
+		pmatch = &match;
 	}
 
 	if (vr->action_stack.regex_stack->len) {
 		GArray *rs = vr->action_stack.regex_stack;
-		prev_match_info = g_array_index(rs, liActionRegexStackElement, rs->len - 1).match_info;
+		prev_match = &g_array_index(rs, liActionRegexStackElement, rs->len - 1).match;
 	}
 
 	g_string_truncate(dest, 0);
@@ -139,11 +137,7 @@ static gboolean redirect_internal(liVRequest *vr, GString *dest, redirect_rule *
 		break;
 	}
 
-	li_pattern_eval(vr, dest, rule->pattern, li_pattern_regex_cb, match_info, li_pattern_regex_cb, prev_match_info);
-
-	if (match_info) {
-		g_match_info_free(match_info);
-	}
+	li_pattern_eval(vr, dest, rule->pattern, li_pattern_regex_cb, pmatch, li_pattern_regex_cb, prev_match);
 
 	return TRUE;
 }
@@ -193,7 +187,7 @@ static void redirect_free(liServer *srv, gpointer param) {
 		li_pattern_free(rule->pattern);
 
 		if (NULL != rule->regex)
-			g_regex_unref(rule->regex);
+			li_regex_free(rule->regex);
 	}
 
 	g_array_free(rd->rules, TRUE);
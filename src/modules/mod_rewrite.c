@@ -19,7 +19,7 @@ LI_API gboolean mod_rewrite_free(liModules *mods, liModule *mod);
 typedef struct rewrite_rule rewrite_rule;
 struct rewrite_rule {
 	liPattern *path, *querystring;
-	GRegex *regex;
+	liRegex *regex;
 };
 
 typedef struct rewrite_data rewrite_data;
@@ -60,10 +60,10 @@ static gboolean rewrite_rule_parse(liServer *srv, GString *regex, GString *str,
 
 	if (NULL != regex) {
 		GError *err = NULL;
-		rule->regex = g_regex_new(regex->str, G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, &err);
+		rule->regex = li_regex_new(regex->str, &err);
 
-		if (NULL == rule->regex || NULL != err) {
-			ERROR(srv, "rewrite: error compiling regex \"%s\": %s", regex->str, NULL != err ? err->message : "unknown error");
+		if (NULL == rule->regex) {
+			ERROR(srv, "rewrite: error compiling regex \"%s\": %s", regex->str, err->message);
 			g_error_free(err);
 			goto error;
 		}
@@ -85,7 +85,7 @@ error:
 		rule->path = NULL;
 	}
 	if (NULL != rule->regex) {
-		g_regex_unref(rule->regex);
+		li_regex_free(rule->regex);
 		rule->regex = NULL;
 	}
 
@@ -97,33 +97,29 @@ error:
 }
 
 static gboolean rewrite_internal(liVRequest *vr, GString *dest_path, GString *dest_query, rewrite_rule *rule, gchar *path) {
-	GMatchInfo *match_info = NULL;
-	GMatchInfo *prev_match_info = NULL;
+	liRegexMatch match, *pmatch = NULL;
+	liRegexMatch *prev_match = NULL;
 
-	if (NULL != rule->regex && !g_regex_match(rule->regex, path, 0, &match_info)) {
-		if (NULL != match_info) {
-			g_match_info_free(match_info);
-		}
-
-		return FALSE;
+	if (NULL != rule->regex) {
+		/* the offsets are valid until the next match in this worker, which can't happen before we're done */
+		if (!li_regex_match(rule->regex, vr->wrk->regex_match_data, path, strlen(path), &match)) return FALSE;
+		pmatch = &match;
 	}
 
 	if (vr->action_stack.regex_stack->len) {
 		GArray *rs = vr->action_stack.regex_stack;
-		prev_match_info = g_array_index(rs, liActionRegexStackElement, rs->len - 1).match_info;
+		prev_match = &g_array_index(rs, liActionRegexStackElement, rs->len - 1).match;
 	}
 
 	g_string_truncate(dest_path, 0);
 	if (NULL != dest_query) g_string_truncate(dest_query, 0);
 
-	li_pattern_eval(vr, dest_path, rule->path, li_pattern_regex_cb, match_info, li_pattern_regex_cb, prev_match_info);
+	li_pattern_eval(vr, dest_path, rule->path, li_pattern_regex_cb, pmatch, li_pattern_regex_cb, prev_match);
 	if (NULL != rule->querystring) {
 		LI_FORCE_ASSERT(NULL != dest_query);
-		li_pattern_eval(vr, dest_query, rule->querystring, li_pattern_regex_cb, match_info, li_pattern_regex_cb, prev_match_info);
+		li_pattern_eval(vr, dest_query, rule->querystring, li_pattern_regex_cb, pmatch, li_pattern_regex_cb, prev_match);
 	}
 
-	g_match_info_free(match_info);
-
 	return TRUE;
 }
 
@@ -227,7 +223,7 @@ static void rewrite_free(liServer *srv, gpointer param) {
 		li_pattern_free(rule->querystring);
 
 		if (rule->regex) {
-			g_regex_unref(rule->regex);
+			li_regex_free(rule->regex);
 		}
 	}
 
@@ -22,8 +22,22 @@
 LI_API gboolean mod_status_init(liModules *mods, liModule *mod);
 LI_API gboolean mod_status_free(liModules *mods, liModule *mod);
 
+typedef struct mod_status_cache_stats mod_status_cache_stats;
+
+/* per worker cache counters (not part of liStatistics) */
+struct mod_status_cache_stats {
+	guint64 stat_cache_hits;
+	guint64 stat_cache_misses;
+	guint64 stat_cache_errors;
+	guint64 stat_cache_invalidations;
+	guint64 stat_cache_negative_hits;
+	guint64 stat_cache_negative_misses;
+
+	liFileCacheStats file_cache; /* server wide, not summed up */
+};
+
 static GString *status_info_full(liVRequest *vr, liPlugin *p, gboolean short_info, GPtrArray *result, guint uptime, liStatistics *totals, guint total_connections, guint *connection_count);
-static GString *status_info_plain(liVRequest *vr, guint uptime, liStatistics *totals, guint total_connections, guint *connection_count);
+static GString *status_info_plain(liVRequest *vr, guint uptime, liStatistics *totals, mod_status_cache_stats *cache_totals, guint total_connections, guint *connection_count);
 static GString *status_info_auto(liVRequest *vr, guint uptime, liStatistics *totals, guint *connection_count);
 static liHandlerResult status_info_runtime(liVRequest *vr, liPlugin *p);
 static gint str_comp(gconstpointer a, gconstpointer b);
@@ -356,6 +370,7 @@ struct mod_status_con_data {
 struct mod_status_wrk_data {
 	guint worker_ndx;
 	liStatistics stats;
+	mod_status_cache_stats cache_stats;
 	GArray *connections;
 	guint connection_count[LI_CON_STATE_LAST+1];
 };
@@ -376,6 +391,14 @@ static gpointer status_collect_func(liWorker *wrk, gpointer fdata) {
 
 	sd->stats = wrk->stats;
 	sd->worker_ndx = wrk->ndx;
+	if (NULL != wrk->stat_cache) {
+		sd->cache_stats.stat_cache_hits = wrk->stat_cache->hits;
+		sd->cache_stats.stat_cache_misses = wrk->stat_cache->misses;
+		sd->cache_stats.stat_cache_errors = wrk->stat_cache->errors;
+		sd->cache_stats.stat_cache_invalidations = wrk->stat_cache->invalidations;
+		sd->cache_stats.stat_cache_negative_hits = wrk->stat_cache->negative_hits;
+		sd->cache_stats.stat_cache_negative_misses = wrk->stat_cache->negative_misses;
+	}
 	/* gather connection info */
 	sd->connections = g_array_sized_new(FALSE, TRUE, sizeof(mod_status_con_data), wrk->connections_active);
 	g_array_set_size(sd->connections, wrk->connections_active);
@@ -450,14 +473,14 @@ static void status_collect_cb(gpointer cbdata, gpointer fdata, GPtrArray *result
 		guint uptime, len;
 		guint total_connections = 0;
 		guint connection_count[LI_CON_STATE_LAST+1] = {0};
+		mod_status_cache_stats cache_totals;
+		liStatistics totals;
 
-		liStatistics totals = {
-			G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0),
-			G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0),
-			G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0),
-			0, 0, {G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0), G_GUINT64_CONSTANT(0)},
-			G_GUINT64_CONSTANT(0), 0, 0
-		};
+		memset(&totals, 0, sizeof(totals));
+		memset(&cache_totals, 0, sizeof(cache_totals));
+		if (NULL != vr->wrk->srv->file_cache) {
+			li_file_cache_get_stats(vr->wrk->srv->file_cache, &cache_totals.file_cache);
+		}
 
 		/* clear context so it doesn't get cleaned up anymore */
 		*(job->context) = NULL;
@@ -479,8 +502,18 @@ static void status_collect_cb(gpointer cbdata, gpointer fdata, GPtrArray *result
 			totals.bytes_in += sd->stats.bytes_in;
 			totals.requests += sd->stats.requests;
 			totals.actions_executed += sd->stats.actions_executed;
+			totals.condition_cache_hits += sd->stats.condition_cache_hits;
+			totals.write_syscalls += sd->stats.write_syscalls;
+			totals.cork_syscalls += sd->stats.cork_syscalls;
 			total_connections += sd->connections->len;
 
+			cache_totals.stat_cache_hits += sd->cache_stats.stat_cache_hits;
+			cache_totals.stat_cache_misses += sd->cache_stats.stat_cache_misses;
+			cache_totals.stat_cache_errors += sd->cache_stats.stat_cache_errors;
+			cache_totals.stat_cache_invalidations += sd->cache_stats.stat_cache_invalidations;
+			cache_totals.stat_cache_negative_hits += sd->cache_stats.stat_cache_negative_hits;
+			cache_totals.stat_cache_negative_misses += sd->cache_stats.stat_cache_negative_misses;
+
 			totals.requests_5s_diff += sd->stats.requests_5s_diff;
 			totals.bytes_in_5s_diff += sd->stats.bytes_in_5s_diff;
 			totals.bytes_out_5s_diff += sd->stats.bytes_out_5s_diff;
@@ -499,7 +532,7 @@ static void status_collect_cb(gpointer cbdata, gpointer fdata, GPtrArray *result
 
 		if (li_querystring_find(vr->request.uri.query, CONST_STR_LEN("format"), &val, &len) && strncmp(val, "plain", len) == 0) {
 			/* show plain text page */
-			html = status_info_plain(vr, uptime, &totals, total_connections, &connection_count[0]);
+			html = status_info_plain(vr, uptime, &totals, &cache_totals, total_connections, &connection_count[0]);
 		} else if (li_strncase_equal(vr->request.uri.query, CONST_STR_LEN("auto"))) {
 			/* show auto text page */
 			html = status_info_auto(vr, uptime, &totals, &connection_count[0]);
@@ -807,7 +840,7 @@ static GString *status_info_full(liVRequest *vr, liPlugin *p, gboolean short_inf
 	return html;
 }
 
-static GString *status_info_plain(liVRequest *vr, guint uptime, liStatistics *totals, guint total_connections, guint *connection_count) {
+static GString *status_info_plain(liVRequest *vr, guint uptime, liStatistics *totals, mod_status_cache_stats *cache_totals, guint total_connections, guint *connection_count) {
 	GString *html;
 
 	html = g_string_sized_new(1024 - 1);
@@ -856,6 +889,42 @@ static GString *status_info_plain(liVRequest *vr, guint uptime, liStatistics *to
 	li_string_append_int(html, connection_count[LI_CON_STATE_KEEP_ALIVE]);
 	g_string_append_len(html, CONST_STR_LEN("\nconnection_state_upgraded: "));
 	li_string_append_int(html, connection_count[LI_CON_STATE_UPGRADED]);
+	/* network write syscalls */
+	g_string_append_len(html, CONST_STR_LEN("\n\n# Network Writes (since start)\nwrite_syscalls: "));
+	li_string_append_int(html, totals->write_syscalls);
+	g_string_append_len(html, CONST_STR_LEN("\ncork_syscalls: "));
+	li_string_append_int(html, totals->cork_syscalls);
+	g_string_append_printf(html, "\nwrite_syscalls_per_request: %.2f",
+		totals->requests ? (double)(totals->write_syscalls + totals->cork_syscalls) / totals->requests : 0.0);
+	/* condition lvalues not evaluated again */
+	g_string_append_len(html, CONST_STR_LEN("\n\n# Conditions (since start)\ncondition_cache_hits: "));
+	li_string_append_int(html, totals->condition_cache_hits);
+	/* stat cache */
+	g_string_append_len(html, CONST_STR_LEN("\n\n# Stat Cache (since start)\nstat_cache_hits: "));
+	li_string_append_int(html, cache_totals->stat_cache_hits);
+	g_string_append_len(html, CONST_STR_LEN("\nstat_cache_misses: "));
+	li_string_append_int(html, cache_totals->stat_cache_misses);
+	g_string_append_len(html, CONST_STR_LEN("\nstat_cache_errors: "));
+	li_string_append_int(html, cache_totals->stat_cache_errors);
+	g_string_append_len(html, CONST_STR_LEN("\nstat_cache_invalidations: "));
+	li_string_append_int(html, cache_totals->stat_cache_invalidations);
+	g_string_append_len(html, CONST_STR_LEN("\nstat_cache_negative_hits: "));
+	li_string_append_int(html, cache_totals->stat_cache_negative_hits);
+	g_string_append_len(html, CONST_STR_LEN("\nstat_cache_negative_misses: "));
+	li_string_append_int(html, cache_totals->stat_cache_negative_misses);
+	/* file cache */
+	if (NULL != vr->wrk->srv->file_cache) {
+		g_string_append_len(html, CONST_STR_LEN("\n\n# File Cache (since start)\nfile_cache_hits: "));
+		li_string_append_int(html, cache_totals->file_cache.hits);
+		g_string_append_len(html, CONST_STR_LEN("\nfile_cache_misses: "));
+		li_string_append_int(html, cache_totals->file_cache.misses);
+		g_string_append_len(html, CONST_STR_LEN("\nfile_cache_evictions: "));
+		li_string_append_int(html, cache_totals->file_cache.evictions);
+		g_string_append_len(html, CONST_STR_LEN("\nfile_cache_entries: "));
+		li_string_append_int(html, cache_totals->file_cache.entries);
+		g_string_append_len(html, CONST_STR_LEN("\nfile_cache_bytes: "));
+		li_string_append_int(html, cache_totals->file_cache.size);
+	}
 	/* status cpdes */
 	g_string_append_len(html, CONST_STR_LEN("\n\n# Status Codes (since start)\nstatus_1xx: "));
 	li_string_append_int(html, mod_status_response_codes[0]);
@@ -24,15 +24,52 @@ struct vhost_map_data {
 
 typedef struct vhost_map_regex_entry vhost_map_regex_entry;
 struct vhost_map_regex_entry {
-	GRegex *regex;
+	liRegex *regex;
 	liValue *action;
 };
 
+/* vhost.map_regex has to find the first entry matching the host. Instead of trying all regexes, the literal string
+ * each pattern requires (li_regex_required_literal) is indexed by its first VHOST_GRAM bytes: only entries whose
+ * literal occurs in the host (and entries without literal) are candidates. Each worker remembers the result (entry
+ * index or no match) for the last VHOST_CACHE_SIZE hosts of at most VHOST_CACHE_MAX_HOST bytes.
+ */
+#define VHOST_GRAM 4
+#define VHOST_CACHE_SIZE 1024
+#define VHOST_CACHE_MAX_HOST 255 /* longer hosts (not valid DNS names) are matched, but not cached */
+#define VHOST_NO_MATCH G_MAXUINT
+
+typedef struct vhost_map_regex_literal vhost_map_regex_literal;
+struct vhost_map_regex_literal {
+	guint ndx; /* entry index */
+	GString *literal;
+};
+
+typedef struct vhost_map_regex_cached vhost_map_regex_cached;
+struct vhost_map_regex_cached {
+	GString *host;
+	guint ndx; /* entry index or VHOST_NO_MATCH */
+	GList lru_link;
+};
+
+typedef struct vhost_map_regex_worker vhost_map_regex_worker;
+struct vhost_map_regex_worker {
+	GHashTable *hosts; /* GString* -> vhost_map_regex_cached */
+	GQueue lru;        /* most recently used first */
+	GArray *candidates; /* guint entry indices, only used during a lookup */
+};
+
 typedef struct vhost_map_regex_data vhost_map_regex_data;
 struct vhost_map_regex_data {
 	liPlugin *plugin;
 	GArray *list; /* array of vhost_map_regex_entry */
 	liValue *default_action;
+
+	GHashTable *grams;  /* guint32 (first VHOST_GRAM bytes of a literal) -> GArray of vhost_map_regex_literal */
+	GArray *unfiltered; /* guint entry indices without literal, sorted */
+
+	GMutex *workers_mutex; /* only for creating workers */
+	guint worker_count;
+	vhost_map_regex_worker *workers; /* created by the first request, each worker only uses its own */
 };
 
 static liHandlerResult vhost_map(liVRequest *vr, gpointer param, gpointer *context) {
@@ -132,31 +169,146 @@ static liAction* vhost_map_create(liServer *srv, liWorker *wrk, liPlugin* p, liV
 	return li_action_new_function(vhost_map, NULL, vhost_map_free, md);
 }
 
+static gint vhost_ndx_cmp(gconstpointer a, gconstpointer b) {
+	guint x = *(const guint*) a, y = *(const guint*) b;
+	return (x < y) ? -1 : (x > y);
+}
+
+static vhost_map_regex_worker* vhost_map_regex_worker_get(liWorker *wrk, vhost_map_regex_data *mrd) {
+	vhost_map_regex_worker *workers = g_atomic_pointer_get(&mrd->workers), *w;
+
+	if (G_UNLIKELY(NULL == workers)) {
+		g_mutex_lock(mrd->workers_mutex);
+		if (NULL == (workers = mrd->workers)) {
+			mrd->worker_count = wrk->srv->worker_count;
+			workers = g_slice_alloc0(sizeof(vhost_map_regex_worker) * mrd->worker_count);
+			g_atomic_pointer_set(&mrd->workers, workers);
+		}
+		g_mutex_unlock(mrd->workers_mutex);
+	}
+
+	w = &workers[wrk->ndx];
+	if (NULL == w->hosts) {
+		w->hosts = g_hash_table_new((GHashFunc) g_string_hash, (GEqualFunc) g_string_equal);
+		g_queue_init(&w->lru);
+		w->candidates = g_array_new(FALSE, FALSE, sizeof(guint));
+	}
+
+	return w;
+}
+
+static void vhost_map_regex_worker_clear(vhost_map_regex_worker *w) {
+	GList *link;
+
+	if (NULL == w->hosts) return;
+
+	while (NULL != (link = g_queue_pop_head_link(&w->lru))) {
+		vhost_map_regex_cached *cached = link->data;
+		g_string_free(cached->host, TRUE);
+		g_slice_free(vhost_map_regex_cached, cached);
+	}
+	g_hash_table_destroy(w->hosts);
+	g_array_free(w->candidates, TRUE);
+}
+
+/* index of the first entry matching host, or VHOST_NO_MATCH */
+static guint vhost_map_regex_find(liVRequest *vr, vhost_map_regex_data *mrd, vhost_map_regex_worker *w, GString *host) {
+	GArray *candidates = w->candidates;
+	guint i, last;
+
+	g_array_set_size(candidates, 0);
+
+	for (i = 0; i + VHOST_GRAM <= host->len; i++) {
+		guint32 gram;
+		GArray *literals;
+		guint j;
+
+		memcpy(&gram, host->str + i, VHOST_GRAM);
+		if (NULL == (literals = g_hash_table_lookup(mrd->grams, GUINT_TO_POINTER(gram)))) continue;
+
+		for (j = 0; j < literals->len; j++) {
+			vhost_map_regex_literal *l = &g_array_index(literals, vhost_map_regex_literal, j);
+			if (i + l->literal->len <= host->len && 0 == memcmp(host->str + i, GSTR_LEN(l->literal))) {
+				g_array_append_val(candidates, l->ndx);
+			}
+		}
+	}
+
+	if (0 == candidates->len) {
+		/* only the entries without literal are left, already in order */
+		candidates = mrd->unfiltered;
+	} else {
+		g_array_append_vals(candidates, mrd->unfiltered->data, mrd->unfiltered->len);
+		g_array_sort(candidates, vhost_ndx_cmp);
+	}
+
+	for (i = 0, last = VHOST_NO_MATCH; i < candidates->len; i++) {
+		guint ndx = g_array_index(candidates, guint, i);
+
+		if (ndx == last) continue; /* literal found more than once */
+		last = ndx;
+
+		if (li_regex_match(g_array_index(mrd->list, vhost_map_regex_entry, ndx).regex, vr->wrk->regex_match_data, GSTR_LEN(host), NULL)) {
+			return ndx;
+		}
+	}
+
+	return VHOST_NO_MATCH;
+}
+
+static guint vhost_map_regex_lookup(liVRequest *vr, vhost_map_regex_data *mrd) {
+	vhost_map_regex_worker *w = vhost_map_regex_worker_get(vr->wrk, mrd);
+	GString *host = vr->request.uri.host;
+	vhost_map_regex_cached *cached;
+
+	/* don't let clients fill the cache with huge host headers */
+	if (host->len > VHOST_CACHE_MAX_HOST) return vhost_map_regex_find(vr, mrd, w, host);
+
+	if (NULL != (cached = g_hash_table_lookup(w->hosts, host))) {
+		g_queue_unlink(&w->lru, &cached->lru_link);
+		g_queue_push_head_link(&w->lru, &cached->lru_link);
+		return cached->ndx;
+	}
+
+	if (w->lru.length >= VHOST_CACHE_SIZE) {
+		/* reuse the least recently used entry */
+		GList *link = g_queue_pop_tail_link(&w->lru);
+		cached = link->data;
+		g_hash_table_remove(w->hosts, cached->host);
+		g_string_truncate(cached->host, 0);
+		g_string_append_len(cached->host, GSTR_LEN(host));
+	} else {
+		cached = g_slice_new0(vhost_map_regex_cached);
+		cached->host = g_string_new_len(GSTR_LEN(host));
+		cached->lru_link.data = cached;
+	}
+
+	cached->ndx = vhost_map_regex_find(vr, mrd, w, host);
+
+	g_hash_table_insert(w->hosts, cached->host, cached);
+	g_queue_push_head_link(&w->lru, &cached->lru_link);
+
+	return cached->ndx;
+}
+
 static liHandlerResult vhost_map_regex(liVRequest *vr, gpointer param, gpointer *context) {
-	guint i;
+	guint ndx;
 	vhost_map_regex_data *mrd = param;
-	GArray *list = mrd->list;
 	gboolean debug = _OPTION(vr, mrd->plugin, 0).boolean;
 	liValue *v = NULL;
 	vhost_map_regex_entry *entry = NULL;
 
 	UNUSED(context);
 
-	/* loop through all rules to find a match */
-	for (i = 0; i < list->len; i++) {
-		entry = &g_array_index(list, vhost_map_regex_entry, i);
-
-		if (!g_regex_match(entry->regex, vr->request.uri.host->str, 0, NULL))
-			continue;
-
+	ndx = vhost_map_regex_lookup(vr, mrd);
+	if (VHOST_NO_MATCH != ndx) {
+		entry = &g_array_index(mrd->list, vhost_map_regex_entry, ndx);
 		v = entry->action;
-
-		break;
 	}
 
 	if (NULL != v) {
 		if (debug) {
-			VR_DEBUG(vr, "vhost_map_regex: host %s matches pattern \"%s\"", vr->request.uri.host->str, g_regex_get_pattern(entry->regex));
+			VR_DEBUG(vr, "vhost_map_regex: host %s matches pattern \"%s\"", vr->request.uri.host->str, li_regex_get_pattern(entry->regex));
 		}
 		li_action_enter(vr, v->data.val_action.action);
 	} else if (NULL != mrd->default_action) {
@@ -182,7 +334,7 @@ static void vhost_map_regex_free(liServer *srv, gpointer param) {
 	for (i = 0; i < list->len; i++) {
 		vhost_map_regex_entry *entry = &g_array_index(list, vhost_map_regex_entry, i);
 
-		g_regex_unref(entry->regex);
+		li_regex_free(entry->regex);
 		li_value_free(entry->action);
 	}
 	g_array_free(list, TRUE);
@@ -191,9 +343,64 @@ static void vhost_map_regex_free(liServer *srv, gpointer param) {
 		li_value_free(mrd->default_action);
 	}
 
+	if (NULL != mrd->grams) {
+		g_hash_table_destroy(mrd->grams);
+	}
+	if (NULL != mrd->unfiltered) {
+		g_array_free(mrd->unfiltered, TRUE);
+	}
+
+	if (NULL != mrd->workers) {
+		for (i = 0; i < mrd->worker_count; i++) {
+			vhost_map_regex_worker_clear(&mrd->workers[i]);
+		}
+		g_slice_free1(sizeof(vhost_map_regex_worker) * mrd->worker_count, mrd->workers);
+	}
+	g_mutex_free(mrd->workers_mutex);
+
 	g_slice_free(vhost_map_regex_data, mrd);
 }
 
+static void vhost_map_regex_literals_free(gpointer data) {
+	GArray *literals = data;
+	guint i;
+
+	for (i = 0; i < literals->len; i++) {
+		g_string_free(g_array_index(literals, vhost_map_regex_literal, i).literal, TRUE);
+	}
+	g_array_free(literals, TRUE);
+}
+
+static void vhost_map_regex_build_prefilter(vhost_map_regex_data *mrd) {
+	guint i;
+
+	mrd->grams = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, vhost_map_regex_literals_free);
+	mrd->unfiltered = g_array_new(FALSE, FALSE, sizeof(guint));
+
+	for (i = 0; i < mrd->list->len; i++) {
+		vhost_map_regex_entry *entry = &g_array_index(mrd->list, vhost_map_regex_entry, i);
+		vhost_map_regex_literal l;
+		GArray *literals;
+		guint32 gram;
+
+		l.ndx = i;
+		l.literal = li_regex_required_literal(entry->regex);
+
+		if (NULL == l.literal || l.literal->len < VHOST_GRAM) {
+			if (NULL != l.literal) g_string_free(l.literal, TRUE);
+			g_array_append_val(mrd->unfiltered, i);
+			continue;
+		}
+
+		memcpy(&gram, l.literal->str, VHOST_GRAM);
+		if (NULL == (literals = g_hash_table_lookup(mrd->grams, GUINT_TO_POINTER(gram)))) {
+			literals = g_array_new(FALSE, FALSE, sizeof(vhost_map_regex_literal));
+			g_hash_table_insert(mrd->grams, GUINT_TO_POINTER(gram), literals);
+		}
+		g_array_append_val(literals, l);
+	}
+}
+
 static liAction* vhost_map_regex_create(liServer *srv, liWorker *wrk, liPlugin* p, liValue *val, gpointer userdata) {
 	vhost_map_regex_data *mrd;
 	UNUSED(wrk); UNUSED(userdata);
@@ -208,6 +415,7 @@ static liAction* vhost_map_regex_create(liServer *srv, liWorker *wrk, liPlugin*
 	mrd = g_slice_new0(vhost_map_regex_data);
 	mrd->plugin = p;
 	mrd->list = g_array_new(FALSE, FALSE, sizeof(vhost_map_regex_entry));
+	mrd->workers_mutex = g_mutex_new();
 
 	LI_VALUE_FOREACH(entry, val)
 		liValue *entryKey = li_value_list_at(entry, 0);
@@ -216,7 +424,7 @@ static liAction* vhost_map_regex_create(liServer *srv, liWorker *wrk, liPlugin*
 
 		if (LI_VALUE_ACTION != li_value_type(entryValue)) {
 			ERROR(srv, "vhost.map_regex expects a hashtable/key-value list with action values as parameter, %s value given", li_value_type_string(entryValue));
-			vhost_map_free(srv, mrd);
+			vhost_map_regex_free(srv, mrd);
 			return NULL;
 		}
 
@@ -232,7 +440,7 @@ static liAction* vhost_map_regex_create(liServer *srv, liWorker *wrk, liPlugin*
 		if (NULL == entryKeyStr) {
 			if (NULL != mrd->default_action) {
 				ERROR(srv, "%s", "vhost.map_regex: already have a default action");
-				vhost_map_free(srv, mrd);
+				vhost_map_regex_free(srv, mrd);
 				return NULL;
 			}
 			mrd->default_action = li_value_extract(entryValue);
@@ -240,17 +448,18 @@ static liAction* vhost_map_regex_create(liServer *srv, liWorker *wrk, liPlugin*
 			GError *err = NULL;
 			vhost_map_regex_entry map_entry;
 
-			map_entry.regex = g_regex_new(entryKeyStr->str, G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, &err);
-			g_string_free(entryKeyStr, TRUE);
+			map_entry.regex = li_regex_new(entryKeyStr->str, &err);
 
 			if (NULL == map_entry.regex) {
 				LI_FORCE_ASSERT(NULL != err);
 				vhost_map_regex_free(srv, mrd);
 				ERROR(srv, "vhost.map_regex: error compiling regex \"%s\": %s", entryKeyStr->str, err->message);
+				g_string_free(entryKeyStr, TRUE);
 				g_error_free(err);
 				return NULL;
 			}
 			LI_FORCE_ASSERT(NULL == err);
+			g_string_free(entryKeyStr, TRUE);
 
 			map_entry.action = li_value_extract(entryValue);
 
@@ -258,6 +467,8 @@ static liAction* vhost_map_regex_create(liServer *srv, liWorker *wrk, liPlugin*
 		}
 	LI_VALUE_END_FOREACH()
 
+	vhost_map_regex_build_prefilter(mrd);
+
 	return li_action_new_function(vhost_map_regex, NULL, vhost_map_regex_free, mrd);
 }
 
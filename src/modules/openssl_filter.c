@@ -5,6 +5,18 @@
 #include <openssl/err.h>
 #include <openssl/rand.h>
 
+#ifdef USE_OPENSSL_KTLS
+# include <openssl/hmac.h>
+# include <netinet/tcp.h>
+# include <linux/tls.h>
+# ifndef TCP_ULP
+#  define TCP_ULP 31
+# endif
+# ifndef SOL_TLS
+#  define SOL_TLS 282
+# endif
+#endif
+
 
 struct liOpenSSLFilter {
 	int refcount;
@@ -28,6 +40,9 @@ struct liOpenSSLFilter {
 	unsigned int client_initiated_renegotiation:1;
 	unsigned int closing:1, aborted:1;
 	unsigned int write_wants_read:1;
+	unsigned int ktls:1; /* socket encrypts outgoing data, OpenSSL only reads */
+
+	int ktls_fd; /* -1: don't try kTLS */
 };
 
 #define BIO_TYPE_LI_STREAM (127|BIO_TYPE_SOURCE_SINK)
@@ -62,6 +77,8 @@ static int stream_bio_write(BIO *bio, const char *buf, int len) {
 	if (NULL == f || NULL == f->crypt_source.out) return -1;
 	cq = f->crypt_source.out;
 	if (cq->is_closed) return -1;
+	/* the write state of OpenSSL is out of sync with the kernel, any record would be garbage */
+	if (f->ktls) return -1;
 
 	li_chunkqueue_append_mem(cq, buf, len);
 	li_stream_notify_later(&f->crypt_source);
@@ -269,11 +286,164 @@ static void do_handle_error(liOpenSSLFilter *f, const char *sslfunc, int r, gboo
 
 }
 
+#ifdef USE_OPENSSL_KTLS
+/* TLS 1.2 PRF (RFC 5246, section 5) with seed = seed1 + seed2 */
+static gboolean ktls_prf(const EVP_MD *md, const unsigned char *secret, int secret_len, const char *label,
+		const unsigned char *seed1, const unsigned char *seed2, int seed_len, unsigned char *out, int out_len) {
+	unsigned char a[EVP_MAX_MD_SIZE], chunk[EVP_MAX_MD_SIZE];
+	unsigned int a_len, chunk_len;
+	size_t label_len = strlen(label);
+	int pos = 0;
+	gboolean res = FALSE;
+	HMAC_CTX ctx;
+
+	HMAC_CTX_init(&ctx);
+
+	/* A(1) = HMAC(secret, label + seed) */
+	if (!HMAC_Init_ex(&ctx, secret, secret_len, md, NULL)
+	    || !HMAC_Update(&ctx, (const unsigned char*) label, label_len)
+	    || !HMAC_Update(&ctx, seed1, seed_len)
+	    || !HMAC_Update(&ctx, seed2, seed_len)
+	    || !HMAC_Final(&ctx, a, &a_len)) goto out;
+
+	while (pos < out_len) {
+		/* HMAC(secret, A(i) + label + seed) */
+		if (!HMAC_Init_ex(&ctx, NULL, 0, NULL, NULL)
+		    || !HMAC_Update(&ctx, a, a_len)
+		    || !HMAC_Update(&ctx, (const unsigned char*) label, label_len)
+		    || !HMAC_Update(&ctx, seed1, seed_len)
+		    || !HMAC_Update(&ctx, seed2, seed_len)
+		    || !HMAC_Final(&ctx, chunk, &chunk_len)) goto out;
+		memcpy(out + pos, chunk, MIN((int) chunk_len, out_len - pos));
+		pos += chunk_len;
+
+		/* A(i+1) = HMAC(secret, A(i)) */
+		if (!HMAC_Init_ex(&ctx, NULL, 0, NULL, NULL)
+		    || !HMAC_Update(&ctx, a, a_len)
+		    || !HMAC_Final(&ctx, a, &a_len)) goto out;
+	}
+	res = TRUE;
+
+out:
+	HMAC_CTX_cleanup(&ctx);
+	OPENSSL_cleanse(a, sizeof(a));
+	OPENSSL_cleanse(chunk, sizeof(chunk));
+	return res;
+}
+
+/* everything OpenSSL encrypted so far has to be on the wire before the kernel takes over */
+static gboolean ktls_flush(liOpenSSLFilter *f) {
+	liChunkQueue *queues[2];
+	guint i;
+
+	queues[0] = (NULL != f->crypt_source.dest) ? f->crypt_source.dest->out : NULL; /* already stolen by the socket stream */
+	queues[1] = f->crypt_source.out;
+
+	for (i = 0; i < G_N_ELEMENTS(queues); i++) {
+		liChunkQueue *cq = queues[i];
+		GError *err = NULL;
+
+		if (NULL == cq || 0 == cq->length) continue;
+
+		if (LI_NETWORK_STATUS_SUCCESS != li_network_write(f->wrk, f->ktls_fd, cq, cq->length, &err)) {
+			if (NULL != err) g_error_free(err);
+			return FALSE;
+		}
+		if (0 != cq->length) return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* only TLS 1.2 with AES-GCM; everything else stays with SSL_write */
+static gboolean ktls_enable_tx(liOpenSSLFilter *f) {
+	SSL *ssl = f->ssl;
+	const EVP_MD *md;
+	unsigned char key_block[2*32 + 2*4];
+	const unsigned char *key, *salt;
+	int key_len, r = -1;
+
+	if (TLS1_2_VERSION != SSL_version(ssl) || NULL == ssl->enc_write_ctx || NULL == ssl->session) return FALSE;
+
+	switch (EVP_CIPHER_nid(EVP_CIPHER_CTX_cipher(ssl->enc_write_ctx))) {
+	case NID_aes_128_gcm:
+		key_len = 16;
+		md = EVP_sha256();
+		break;
+#ifdef TLS_CIPHER_AES_GCM_256
+	case NID_aes_256_gcm:
+		key_len = 32;
+		md = EVP_sha384();
+		break;
+#endif
+	default:
+		return FALSE;
+	}
+
+	/* AEAD key block: client_write_key, server_write_key, client_write_IV, server_write_IV (no MAC keys) */
+	if (!ktls_prf(md, ssl->session->master_key, ssl->session->master_key_length, TLS_MD_KEY_EXPANSION_CONST,
+			ssl->s3->server_random, ssl->s3->client_random, SSL3_RANDOM_SIZE, key_block, 2*key_len + 2*4)) {
+		return FALSE;
+	}
+	key = key_block + key_len;
+	salt = key_block + 2*key_len + 4;
+
+	if (!ktls_flush(f)) goto out;
+
+	if (0 != setsockopt(f->ktls_fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls"))) {
+		_DEBUG(f->srv, f->wrk, f->log_context, "kTLS not available (tls module not loaded?): %s", g_strerror(errno));
+		goto out;
+	}
+
+	/* the explicit nonce only has to be unique, use the sequence number like the kernel does */
+	if (16 == key_len) {
+		struct tls12_crypto_info_aes_gcm_128 ci;
+		memset(&ci, 0, sizeof(ci));
+		ci.info.version = TLS_1_2_VERSION;
+		ci.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+		memcpy(ci.key, key, TLS_CIPHER_AES_GCM_128_KEY_SIZE);
+		memcpy(ci.salt, salt, TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+		memcpy(ci.iv, ssl->s3->write_sequence, TLS_CIPHER_AES_GCM_128_IV_SIZE);
+		memcpy(ci.rec_seq, ssl->s3->write_sequence, TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE);
+		r = setsockopt(f->ktls_fd, SOL_TLS, TLS_TX, &ci, sizeof(ci));
+		OPENSSL_cleanse(&ci, sizeof(ci));
+	}
+#ifdef TLS_CIPHER_AES_GCM_256
+	else {
+		struct tls12_crypto_info_aes_gcm_256 ci;
+		memset(&ci, 0, sizeof(ci));
+		ci.info.version = TLS_1_2_VERSION;
+		ci.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+		memcpy(ci.key, key, TLS_CIPHER_AES_GCM_256_KEY_SIZE);
+		memcpy(ci.salt, salt, TLS_CIPHER_AES_GCM_256_SALT_SIZE);
+		memcpy(ci.iv, ssl->s3->write_sequence, TLS_CIPHER_AES_GCM_256_IV_SIZE);
+		memcpy(ci.rec_seq, ssl->s3->write_sequence, TLS_CIPHER_AES_GCM_256_REC_SEQ_SIZE);
+		r = setsockopt(f->ktls_fd, SOL_TLS, TLS_TX, &ci, sizeof(ci));
+		OPENSSL_cleanse(&ci, sizeof(ci));
+	}
+#endif
+	if (0 != r) {
+		_DEBUG(f->srv, f->wrk, f->log_context, "setsockopt(TLS_TX) failed: %s", g_strerror(errno));
+	}
+
+out:
+	OPENSSL_cleanse(key_block, sizeof(key_block));
+	return 0 == r;
+}
+#endif
+
 static gboolean do_ssl_handshake(liOpenSSLFilter *f, gboolean writing) {
 	int r = SSL_do_handshake(f->ssl);
 	if (1 == r) {
 		f->initial_handshaked_finished = 1;
 		f->ssl->s3->flags |= SSL3_FLAGS_NO_RENEGOTIATE_CIPHERS;
+#ifdef USE_OPENSSL_KTLS
+		if (-1 != f->ktls_fd && ktls_enable_tx(f)) {
+			f->ktls = 1;
+			/* can't send close_notify through OpenSSL anymore */
+			SSL_set_quiet_shutdown(f->ssl, 1);
+		}
+#endif
 		li_stream_acquire(&f->plain_source);
 		li_stream_acquire(&f->plain_drain);
 		f->callbacks->handshake_cb(f, f->callback_data, &f->plain_source, &f->plain_drain);
@@ -411,52 +581,60 @@ static void do_ssl_write(liOpenSSLFilter *f) {
 		goto out;
 	}
 
-	do {
-		GError *err = NULL;
-		liChunkIter ci;
+	if (f->ktls) {
+		/* the kernel encrypts: pass the plain chunks on to the socket, file chunks can use sendfile() */
+		if (0 < cq->length) {
+			li_chunkqueue_steal_all(f->crypt_source.out, cq);
+			li_stream_notify_later(&f->crypt_source);
+		}
+	} else {
+		do {
+			GError *err = NULL;
+			liChunkIter ci;
 
-		if (0 == cq->length) break;
+			if (0 == cq->length) break;
 
-		ci = li_chunkqueue_iter(cq);
-		switch (li_chunkiter_read(ci, 0, blocksize, &block_data, &block_len, &err)) {
-		case LI_HANDLER_GO_ON:
-			break;
-		case LI_HANDLER_ERROR:
-			if (NULL != err) {
-				_ERROR(f->srv, f->wrk, f->log_context, "Couldn't read data from chunkqueue: %s", err->message);
-				g_error_free(err);
+			ci = li_chunkqueue_iter(cq);
+			switch (li_chunkiter_read(ci, 0, blocksize, &block_data, &block_len, &err)) {
+			case LI_HANDLER_GO_ON:
+				break;
+			case LI_HANDLER_ERROR:
+				if (NULL != err) {
+					_ERROR(f->srv, f->wrk, f->log_context, "Couldn't read data from chunkqueue: %s", err->message);
+					g_error_free(err);
+				}
+				/* fall through */
+			default:
+				f_abort_ssl(f);
+				goto out;
 			}
-			/* fall through */
-		default:
-			f_abort_ssl(f);
-			goto out;
-		}
-
-		/**
-		 * SSL_write man-page
-		 *
-		 * WARNING
-		 *        When an SSL_write() operation has to be repeated because of
-		 *        SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE, it must be
-		 *        repeated with the same arguments.
-		 *
-		 */
 
-		ERR_clear_error();
-		r = SSL_write(f->ssl, block_data, block_len);
-		if (f->client_initiated_renegotiation) {
-			_ERROR(f->srv, f->wrk, f->log_context, "%s", "SSL: client initiated renegotitation, closing connection");
-			f_abort_ssl(f);
-			goto out;
-		}
-		if (r <= 0) {
-			do_handle_error(f, "SSL_write", r, TRUE);
-			goto out;
-		}
+			/**
+			 * SSL_write man-page
+			 *
+			 * WARNING
+			 *        When an SSL_write() operation has to be repeated because of
+			 *        SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE, it must be
+			 *        repeated with the same arguments.
+			 *
+			 */
+
+			ERR_clear_error();
+			r = SSL_write(f->ssl, block_data, block_len);
+			if (f->client_initiated_renegotiation) {
+				_ERROR(f->srv, f->wrk, f->log_context, "%s", "SSL: client initiated renegotitation, closing connection");
+				f_abort_ssl(f);
+				goto out;
+			}
+			if (r <= 0) {
+				do_handle_error(f, "SSL_write", r, TRUE);
+				goto out;
+			}
 
-		li_chunkqueue_skip(cq, r);
-		write_max -= r;
-	} while (r == block_len && write_max > 0);
+			li_chunkqueue_skip(cq, r);
+			write_max -= r;
+		} while (r == block_len && write_max > 0);
+	}
 
 	if (cq->is_closed && 0 == cq->length) {
 		r = SSL_shutdown(f->ssl);
@@ -658,6 +836,8 @@ liOpenSSLFilter* li_openssl_filter_new(
 	f->client_initiated_renegotiation = 0;
 	f->closing = f->aborted = 0;
 	f->write_wants_read = 0;
+	f->ktls = 0;
+	f->ktls_fd = -1;
 
 	li_stream_init(&f->crypt_source, loop, stream_crypt_source_cb);
 	li_stream_init(&f->crypt_drain, loop, stream_crypt_drain_cb);
@@ -705,3 +885,11 @@ void li_openssl_filter_free(liOpenSSLFilter *f) {
 SSL* li_openssl_filter_ssl(liOpenSSLFilter *f) {
 	return f->ssl;
 }
+
+void li_openssl_filter_enable_ktls(liOpenSSLFilter *f, int fd) {
+#ifdef USE_OPENSSL_KTLS
+	f->ktls_fd = fd;
+#else
+	UNUSED(f); UNUSED(fd);
+#endif
+}
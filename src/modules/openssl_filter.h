@@ -5,6 +5,12 @@
 
 #include <openssl/ssl.h>
 
+/* kernel TLS offload for the send direction; needs access to the (pre 1.1) SSL internals
+ * to get the key material and sequence number */
+#if defined(HAVE_LINUX_TLS_H) && OPENSSL_VERSION_NUMBER < 0x10100000L
+# define USE_OPENSSL_KTLS
+#endif
+
 typedef struct liOpenSSLFilter liOpenSSLFilter;
 
 typedef void (*liOpenSSLFilterHandshakeCB)(liOpenSSLFilter *f, gpointer data, liStream *plain_source, liStream *plain_drain);
@@ -26,4 +32,9 @@ LI_API void li_openssl_filter_free(liOpenSSLFilter *f);
 
 LI_API SSL* li_openssl_filter_ssl(liOpenSSLFilter *f);
 
+/* try to switch the sending side of the socket fd to kernel TLS after the handshake
+ * (only TLS 1.2 with AES-GCM); then plain chunks are passed to the socket directly,
+ * so file chunks can use sendfile(). Otherwise SSL_write is used as usual. */
+LI_API void li_openssl_filter_enable_ktls(liOpenSSLFilter *f, int fd);
+
 #endif
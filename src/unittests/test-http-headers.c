@@ -0,0 +1,67 @@
+
+#include <lighttpd/base.h>
+
+static void test_header_ids(void) {
+	g_assert_cmpint(li_http_header_id(CONST_STR_LEN("host")), ==, LI_HTTP_HEADER_HOST);
+	g_assert_cmpint(li_http_header_id(CONST_STR_LEN("Host")), ==, LI_HTTP_HEADER_HOST);
+	g_assert_cmpint(li_http_header_id(CONST_STR_LEN("IF-NONE-MATCH")), ==, LI_HTTP_HEADER_IF_NONE_MATCH);
+	g_assert_cmpint(li_http_header_id(CONST_STR_LEN("Accept-Encoding")), ==, LI_HTTP_HEADER_ACCEPT_ENCODING);
+	g_assert_cmpint(li_http_header_id(CONST_STR_LEN("x-lighttpd-send-file")), ==, LI_HTTP_HEADER_X_LIGHTTPD_SEND_FILE);
+
+	g_assert_cmpint(li_http_header_id(CONST_STR_LEN("")), ==, LI_HTTP_HEADER_UNKNOWN);
+	g_assert_cmpint(li_http_header_id(CONST_STR_LEN("hosts")), ==, LI_HTTP_HEADER_UNKNOWN);
+	g_assert_cmpint(li_http_header_id(CONST_STR_LEN("x-custom")), ==, LI_HTTP_HEADER_UNKNOWN);
+	g_assert_cmpint(li_http_header_id(CONST_STR_LEN("accept-encodinG2")), ==, LI_HTTP_HEADER_UNKNOWN);
+}
+
+static void test_header_index(void) {
+	liHttpHeaders *headers = li_http_headers_new();
+	GList *l;
+
+	li_http_header_insert(headers, CONST_STR_LEN("Vary"), CONST_STR_LEN("a"));
+	li_http_header_insert(headers, CONST_STR_LEN("X-Custom"), CONST_STR_LEN("1"));
+	li_http_header_insert(headers, CONST_STR_LEN("vary"), CONST_STR_LEN("b"));
+	li_http_header_insert(headers, CONST_STR_LEN("VARY"), CONST_STR_LEN("c"));
+
+	l = li_http_header_find_first_id(headers, LI_HTTP_HEADER_VARY);
+	g_assert(NULL != l);
+	g_assert_cmpstr(LI_HEADER_VALUE((liHttpHeader*) l->data), ==, "a");
+	l = li_http_header_find_next_id(l, LI_HTTP_HEADER_VARY);
+	g_assert_cmpstr(LI_HEADER_VALUE((liHttpHeader*) l->data), ==, "b");
+	g_assert_cmpstr(LI_HEADER_VALUE(li_http_header_lookup_id(headers, LI_HTTP_HEADER_VARY)), ==, "c");
+	g_assert_cmpstr(LI_HEADER_VALUE(li_http_header_lookup(headers, CONST_STR_LEN("x-custom"))), ==, "1");
+
+	/* removing the first and the last entry moves the index to the remaining one */
+	li_http_header_remove_link(headers, li_http_header_find_first_id(headers, LI_HTTP_HEADER_VARY));
+	li_http_header_remove_link(headers, li_http_header_find_last_id(headers, LI_HTTP_HEADER_VARY));
+	l = li_http_header_find_first_id(headers, LI_HTTP_HEADER_VARY);
+	g_assert(l == li_http_header_find_last_id(headers, LI_HTTP_HEADER_VARY));
+	g_assert_cmpstr(LI_HEADER_VALUE((liHttpHeader*) l->data), ==, "b");
+
+	li_http_header_append(headers, CONST_STR_LEN("Vary"), CONST_STR_LEN("d"));
+	g_assert_cmpstr(LI_HEADER_VALUE(li_http_header_lookup_id(headers, LI_HTTP_HEADER_VARY)), ==, "b, d");
+
+	g_assert(li_http_header_remove(headers, CONST_STR_LEN("vary")));
+	g_assert(NULL == li_http_header_find_first_id(headers, LI_HTTP_HEADER_VARY));
+	g_assert(NULL == li_http_header_find_last_id(headers, LI_HTTP_HEADER_VARY));
+	g_assert_cmpuint(headers->entries.length, ==, 1);
+
+	li_http_header_overwrite(headers, CONST_STR_LEN("Content-Length"), CONST_STR_LEN("10"));
+	li_http_header_overwrite(headers, CONST_STR_LEN("content-length"), CONST_STR_LEN("20"));
+	g_assert_cmpuint(headers->entries.length, ==, 2);
+	g_assert_cmpstr(LI_HEADER_VALUE(li_http_header_lookup_id(headers, LI_HTTP_HEADER_CONTENT_LENGTH)), ==, "20");
+
+	li_http_headers_reset(headers);
+	g_assert(NULL == li_http_header_find_first_id(headers, LI_HTTP_HEADER_CONTENT_LENGTH));
+
+	li_http_headers_free(headers);
+}
+
+int main(int argc, char **argv) {
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/http-headers/ids", test_header_ids);
+	g_test_add_func("/http-headers/index", test_header_index);
+
+	return g_test_run();
+}
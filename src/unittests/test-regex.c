@@ -0,0 +1,199 @@
+
+#include <lighttpd/base.h>
+#include <lighttpd/pattern.h>
+
+static liRegex* regex_new(const gchar *pattern) {
+	GError *err = NULL;
+	liRegex *regex = li_regex_new(pattern, &err);
+
+	g_assert(NULL == err);
+	g_assert(NULL != regex);
+	g_assert_cmpstr(li_regex_get_pattern(regex), ==, pattern);
+
+	return regex;
+}
+
+static void test_match(void) {
+	liRegexMatchData *md = li_regex_match_data_new();
+	liRegex *regex = regex_new("^/(\\w+)(?:/(x))?(?:/(\\d+))?");
+	const gchar *subject = "/abc/42?q";
+	liRegexMatch match;
+	gsize start, end;
+
+	g_test_message("regex: %s%s", li_regex_impl(), li_regex_is_jit(regex) ? " (jit)" : "");
+
+	g_assert(li_regex_match(regex, md, subject, strlen(subject), &match));
+	g_assert(match.subject == subject);
+	g_assert_cmpuint(match.count, ==, 4);
+
+	g_assert(li_regex_match_fetch_pos(&match, 0, &start, &end));
+	g_assert_cmpuint(start, ==, 0);
+	g_assert_cmpuint(end, ==, 7);
+	g_assert(li_regex_match_fetch_pos(&match, 1, &start, &end));
+	g_assert_cmpuint(start, ==, 1);
+	g_assert_cmpuint(end, ==, 4);
+	/* didn't participate */
+	g_assert(!li_regex_match_fetch_pos(&match, 2, &start, &end));
+	g_assert(li_regex_match_fetch_pos(&match, 3, &start, &end));
+	g_assert_cmpuint(start, ==, 5);
+	g_assert_cmpuint(end, ==, 7);
+	g_assert(!li_regex_match_fetch_pos(&match, 4, &start, &end));
+
+	g_assert(!li_regex_match(regex, md, CONST_STR_LEN("abc"), &match));
+	g_assert(li_regex_match(regex, md, CONST_STR_LEN("/abc"), NULL));
+
+	li_regex_free(regex);
+	li_regex_match_data_free(md);
+}
+
+static void test_raw(void) {
+	liRegexMatchData *md = li_regex_match_data_new();
+	liRegex *regex = regex_new("\\xff.b$");
+
+	/* no utf-8 validation, and the subject length is respected */
+	g_assert(li_regex_match(regex, md, "a\xff\0b", 4, NULL));
+	g_assert(!li_regex_match(regex, md, "a\xff\0b", 3, NULL));
+	g_assert(li_regex_match(regex, md, CONST_STR_LEN("\xff\xfe" "b"), NULL));
+
+	li_regex_free(regex);
+	li_regex_match_data_free(md);
+}
+
+static void test_many_groups(void) {
+	liRegexMatchData *md = li_regex_match_data_new();
+	GString *pattern = g_string_sized_new(0), *subject = g_string_sized_new(0);
+	liRegex *regex;
+	liRegexMatch match;
+	gsize start, end;
+	guint i;
+
+	/* more groups than the initial match data has room for */
+	for (i = 0; i < 100; i++) {
+		g_string_append_len(pattern, CONST_STR_LEN("(.)"));
+		g_string_append_c(subject, 'a' + i % 26);
+	}
+	regex = regex_new(pattern->str);
+
+	g_assert(li_regex_match(regex, md, GSTR_LEN(subject), &match));
+	g_assert_cmpuint(match.count, ==, 101);
+	g_assert(li_regex_match_fetch_pos(&match, 100, &start, &end));
+	g_assert_cmpuint(start, ==, 99);
+	g_assert_cmpuint(end, ==, 100);
+
+	li_regex_free(regex);
+	g_string_free(pattern, TRUE);
+	g_string_free(subject, TRUE);
+	li_regex_match_data_free(md);
+}
+
+static void test_copy(void) {
+	liRegexMatchData *md = li_regex_match_data_new();
+	liRegex *regex = regex_new("^/(\\w+)/(\\w+)");
+	liRegexMatch match, copy;
+	GString *subject = g_string_new("/first/second"), *result = g_string_sized_new(0);
+
+	g_assert(li_regex_match(regex, md, GSTR_LEN(subject), &match));
+	li_regex_match_copy(&copy, &match, subject->str);
+
+	/* the next match reuses the match data, the copy keeps its offsets */
+	g_assert(li_regex_match(regex, md, CONST_STR_LEN("/a/b"), &match));
+
+	li_pattern_regex_cb(result, 2, 1, &copy);
+	g_assert_cmpstr(result->str, ==, "secondfirst");
+
+	g_string_truncate(result, 0);
+	li_pattern_regex_cb(result, 0, 9, &match);
+	g_assert_cmpstr(result->str, ==, "/a/bab");
+
+	li_regex_match_clear(&copy);
+	g_assert(NULL == copy.ovector);
+
+	li_regex_free(regex);
+	g_string_free(subject, TRUE);
+	g_string_free(result, TRUE);
+	li_regex_match_data_free(md);
+}
+
+static void test_invalid(void) {
+	GError *err = NULL;
+
+	g_assert(NULL == li_regex_new("(abc", &err));
+	g_assert(NULL != err);
+	g_test_message("error: %s", err->message);
+	g_error_free(err);
+}
+
+static void test_literal(void) {
+	static const gchar *patterns[][2] = {
+		{ "(^|\\.)t\\-basic\\-gets$", "t-basic-gets" },
+		{ "^(.+\\.)?example\\.com$", "example.com" },
+		{ "^www\\.(.*)$", "www." },
+		{ "ab?cdef", "cdef" },
+		{ "ab+cd", "ab" },
+		{ "a{2}bcd", "bcd" },
+		{ "x\\x41yz", "yz" },
+		{ "(?<n>a)\\k<n>zz", "zz" },
+		{ "[[:alpha:]]]xy", "]xy" },
+		{ "abc\\d+defg", "defg" },
+		{ "abc|def", NULL },
+		{ "(?i)abc", NULL },
+		{ "\\Qabc\\E", NULL },
+		{ "^.*$", NULL },
+	};
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(patterns); i++) {
+		liRegex *regex = regex_new(patterns[i][0]);
+		GString *literal = li_regex_required_literal(regex);
+
+		g_assert_cmpstr(NULL != literal ? literal->str : NULL, ==, patterns[i][1]);
+
+		if (NULL != literal) g_string_free(literal, TRUE);
+		li_regex_free(regex);
+	}
+}
+
+static void test_benchmark(void) {
+	static const gchar *paths[] = {
+		"/static/js/app.3f9a1c.js",
+		"/products/overview/1234/details",
+		"/blog/2016/03/17/some-article-title",
+		"/api/v2/orders/1234/items",
+		"/favicon.ico",
+	};
+	const guint rounds = 200000;
+	liRegexMatchData *md = li_regex_match_data_new();
+	liRegex *regex = regex_new("^/(blog|products|api/v\\d+)/([^/]+)/(\\d+)(?:/(.*))?$");
+	liRegexMatch match;
+	guint i, matched = 0;
+	gdouble t;
+
+	g_test_timer_start();
+	for (i = 0; i < rounds; i++) {
+		const gchar *path = paths[i % G_N_ELEMENTS(paths)];
+		if (li_regex_match(regex, md, path, strlen(path), &match)) matched++;
+	}
+	t = g_test_timer_elapsed();
+
+	g_assert_cmpuint(matched, ==, rounds / G_N_ELEMENTS(paths) * 3);
+	g_test_minimized_result(t, "regex match (%s%s): %.0f ns per match", li_regex_impl(), li_regex_is_jit(regex) ? " jit" : "", t * 1e9 / rounds);
+
+	li_regex_free(regex);
+	li_regex_match_data_free(md);
+}
+
+int main(int argc, char **argv) {
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/regex/match", test_match);
+	g_test_add_func("/regex/raw", test_raw);
+	g_test_add_func("/regex/many-groups", test_many_groups);
+	g_test_add_func("/regex/copy", test_copy);
+	g_test_add_func("/regex/invalid", test_invalid);
+	g_test_add_func("/regex/literal", test_literal);
+	if (g_test_perf()) {
+		g_test_add_func("/regex/benchmark", test_benchmark);
+	}
+
+	return g_test_run();
+}
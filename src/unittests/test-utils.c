@@ -164,6 +164,86 @@ static void test_url_decode(void) {
 	g_string_free(url, TRUE);
 }
 
+static void url_decode_path_simplify_pair(GString *path) {
+	li_url_decode(path);
+	li_path_simplify(path);
+}
+
+static void check_url_decode_path_simplify(const gchar *s, gsize len) {
+	GString *a = g_string_new_len(s, len), *b = g_string_new_len(s, len);
+
+	url_decode_path_simplify_pair(a);
+	li_url_decode_path_simplify(b);
+
+	if (a->len != b->len || 0 != memcmp(a->str, b->str, a->len)) {
+		GString *input = g_string_new_len(s, len);
+		g_error("li_url_decode_path_simplify('%s'): got '%s', expected '%s'", g_strescape(input->str, NULL), b->str, a->str);
+	}
+
+	g_string_free(a, TRUE);
+	g_string_free(b, TRUE);
+}
+
+static void test_url_decode_path_simplify(void) {
+	static const gchar *paths[] = {
+		"", "/", "//", "/.", "/..", "/./", "/../", "/a/..", "/a/../", "/a/../..", "/a/./b", "/a//b///c",
+		"/a/b/../../../c", "/%2e%2e/%2E./x", "/%2f..%2fy", "/a%2", "/a%", "/%41%4", "/%zz/b", "/%00/%7f/%1F",
+		"/umlaut/path/%C3%A4%C3%B6%C3%BC%C3%9F", "/static/js/vendor/jquery-3.1.1.min.js", "/docs/some%20file%20name.html",
+		"a/b", " /a", "%2fa", "/a\001b\177c", "/this/is/a/longer/path/with/./many/../segments//index.html",
+		NULL
+	};
+	static const gchar alphabet[] = "/.%aA2eFz \001\177\303";
+	const gchar **p;
+	GRand *rnd = g_rand_new_with_seed(1);
+	gchar buf[48];
+	guint i, j, len;
+
+	for (p = paths; NULL != *p; p++) check_url_decode_path_simplify(*p, strlen(*p));
+
+	/* differential fuzzing against li_url_decode + li_path_simplify */
+	for (i = 0; i < 200000; i++) {
+		len = g_rand_int_range(rnd, 0, sizeof(buf));
+		for (j = 0; j < len; j++) buf[j] = alphabet[g_rand_int_range(rnd, 0, sizeof(alphabet) - 1)];
+		if (len > 0 && g_rand_boolean(rnd)) buf[0] = '/';
+		/* li_url_decode stops at the first zero */
+		if (len > 3 && 0 == g_rand_int_range(rnd, 0, 8)) buf[g_rand_int_range(rnd, 0, len)] = '\0';
+		check_url_decode_path_simplify(buf, len);
+	}
+
+	g_rand_free(rnd);
+}
+
+static void bench_url_decode_path_simplify(const gchar *name, void (*func)(GString *path), GString *input) {
+	const guint rounds = 2000000;
+	GString *path = g_string_sized_new(input->len);
+	gdouble t;
+	guint i;
+
+	g_test_timer_start();
+	for (i = 0; i < rounds; i++) {
+		li_string_assign_len(path, GSTR_LEN(input));
+		func(path);
+	}
+	t = g_test_timer_elapsed();
+
+	g_test_minimized_result(t, "%s: %.0f ns per path", name, t * 1e9 / rounds);
+
+	g_string_free(path, TRUE);
+}
+
+static void test_url_decode_path_simplify_benchmark(void) {
+	GString *plain = g_string_new("/static/js/vendor/jquery-3.1.1.min.js");
+	GString *encoded = g_string_new("/shop/%C3%A4pfel/../birnen/./some%20file%20name%2C%20with%20commas.html");
+
+	bench_url_decode_path_simplify("plain path, decode + simplify", url_decode_path_simplify_pair, plain);
+	bench_url_decode_path_simplify("plain path, one pass", li_url_decode_path_simplify, plain);
+	bench_url_decode_path_simplify("encoded path, decode + simplify", url_decode_path_simplify_pair, encoded);
+	bench_url_decode_path_simplify("encoded path, one pass", li_url_decode_path_simplify, encoded);
+
+	g_string_free(plain, TRUE);
+	g_string_free(encoded, TRUE);
+}
+
 int main(int argc, char **argv) {
 	g_test_init(&argc, &argv, NULL);
 
@@ -173,6 +253,10 @@ int main(int argc, char **argv) {
 	g_test_add_func("/utils/apr_sha1_base64/2", test_apr_sha1_base64_2);
 	g_test_add_func("/utils/apr_md5_crypt", test_apr_md5_crypt);
 	g_test_add_func("/utils/url_decode", test_url_decode);
+	g_test_add_func("/utils/url_decode_path_simplify", test_url_decode_path_simplify);
+	if (g_test_perf()) {
+		g_test_add_func("/utils/url_decode_path_simplify/benchmark", test_url_decode_path_simplify_benchmark);
+	}
 
 	return g_test_run();
 }
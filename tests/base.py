@@ -342,9 +342,13 @@ class Tests(object):
 	def Prepare(self):
 		print >> Env.log, "[Start] Preparing tests"
 		cache_disk_etag_dir = self.PrepareDir(os.path.join("tmp", "cache_etag"))
+		cache_deflate_dir = self.PrepareDir(os.path.join("tmp", "cache_deflate"))
 		errorlog = self.PrepareFile("log/error.log", "")
 		errorconfig = Env.debug and " " or """log [ default => "file:%s" ];""" % (errorlog)
 		accesslog = self.PrepareFile("log/access.log", "")
+		writebackendconfig = ""
+		if Env.write_backend:
+			writebackendconfig = 'io.write_backend "%s";' % (Env.write_backend)
 		self.config = """
 global var.contribdir = "{Env.contribdir}";
 global var.ssldir = "{Env.sourcedir}/tests/ca";
@@ -365,6 +369,7 @@ setup {{
 	];
 
 	listen "127.0.0.2:{Env.port}";
+	listen.reuseport "127.0.0.2:" + cast(string)({Env.port} + 3);
 	gnutls [
 		"listen" => "127.0.0.2:" + cast(string)({Env.port} + 1),
 		"pemfile" => var.ssldir + "/server_test1.ssl.pem",
@@ -375,6 +380,12 @@ setup {{
 		"pemfile" => var.ssldir + "/server_test1.ssl.pem",
 		"ca-file" => var.ssldir + "/intermediate.crt",
 	];
+	openssl [
+		"listen" => "127.0.0.2:" + cast(string)({Env.port} + 4),
+		"pemfile" => var.ssldir + "/server_test1.ssl.pem",
+		"ca-file" => var.ssldir + "/intermediate.crt",
+		"ktls" => true,
+	];
 
 	log [ default => "stderr" ];
 
@@ -395,7 +406,11 @@ setup {{
 	buffer_request_body true;
 
 	io.timeout 300;
+	{writebackendconfig}
 	stat_cache.ttl 10;
+	static.memory_cache true;
+
+	deflate.cache [ "path" => "{cache_deflate_dir}" ];
 }}
 
 {errorconfig}
@@ -414,7 +429,7 @@ global do_deflate = {{
 
 var.vhosts = [];
 var.reg_vhosts = [];
-""".format(Env = Env, errorconfig = errorconfig, accesslog = accesslog)
+""".format(Env = Env, errorconfig = errorconfig, accesslog = accesslog, cache_deflate_dir = cache_deflate_dir, writebackendconfig = writebackendconfig)
 
 		self.vhosts_config = ""
 
@@ -466,8 +481,8 @@ env [ "G_SLICE=always-malloc", "G_DEBUG=gc-friendly,fatal-criticals,resident-mod
 {valgrindconfig}
 
 allow_listen "127.0.0.2:{Env.port}";
-allow_listen ["127.0.0.2:{gnutlsport}", "127.0.0.2:{opensslport}"];
-""".format(Env = Env, gnutlsport = Env.port+1, opensslport = Env.port + 2, valgrindconfig = valgrindconfig))
+allow_listen ["127.0.0.2:{gnutlsport}", "127.0.0.2:{opensslport}", "127.0.0.2:{reuseport}", "127.0.0.2:{opensslktlsport}"];
+""".format(Env = Env, gnutlsport = Env.port+1, opensslport = Env.port + 2, reuseport = Env.port + 3, opensslktlsport = Env.port + 4, valgrindconfig = valgrindconfig))
 
 		print >> Env.log, "[Done] Preparing tests"
 
@@ -551,14 +566,15 @@ allow_listen ["127.0.0.2:{gnutlsport}", "127.0.0.2:{opensslport}"];
 			self.CleanupFile("log/error.log")
 			self.CleanupFile("conf/lighttpd.conf")
 			self.CleanupFile("conf/angel.conf")
-			cache_disk_etag_dir = os.path.join(Env.dir, "tmp", "cache_etag")
-			try:
-				import shutil
-				shutil.rmtree(cache_disk_etag_dir)
-				os.mkdir(cache_disk_etag_dir)
-			except BaseException, e:
-				print >>sys.stderr, "Couldn't clear directory '%s': %s" % (fname, e)
-			self.CleanupDir(os.path.join("tmp", "cache_etag"))
+			for cache_dir in ["cache_etag", "cache_deflate"]:
+				cache_dir_path = os.path.join(Env.dir, "tmp", cache_dir)
+				try:
+					import shutil
+					shutil.rmtree(cache_dir_path)
+					os.mkdir(cache_dir_path)
+				except BaseException, e:
+					print >>sys.stderr, "Couldn't clear directory '%s': %s" % (cache_dir_path, e)
+				self.CleanupDir(os.path.join("tmp", cache_dir))
 		print >> Env.log, "[Done] Cleanup tests"
 
 ## helpers for prepare/cleanup
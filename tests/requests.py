@@ -8,6 +8,16 @@ import zlib
 import bz2
 import os
 
+# optional decoders for the br and zstd content-encodings
+try:
+	import brotli
+except ImportError:
+	brotli = None
+try:
+	import zstandard
+except ImportError:
+	zstandard = None
+
 from base import *
 
 TEST_TXT="""Hi!
@@ -143,6 +153,11 @@ class CurlRequest(TestBase):
 			raise CurlRequestException("Unsupported content-encoding %s" % method)
 		elif 'x-bzip2' == method or 'bzip2' == method:
 			return bz2.decompress(data)
+		elif 'br' == method and None != brotli:
+			return brotli.decompress(data)
+		elif 'zstd' == method and None != zstandard:
+			# streamed frames don't contain the content size
+			return zstandard.ZstdDecompressor().decompressobj().decompress(data)
 		else:
 			raise CurlRequestException("Unsupported content-encoding %s" % method)
 
@@ -187,3 +202,52 @@ class CurlRequest(TestBase):
 
 	def CheckResponse(self):
 		return True
+
+class CurlParallelRequest(TestBase):
+	"""sends COUNT requests for URL at the same time, each on its own connection"""
+	URL = None
+	PORT = 0 # offset to Env.port
+	COUNT = 16
+
+	EXPECT_RESPONSE_BODY = None
+	EXPECT_RESPONSE_CODE = None
+
+	def Run(self):
+		if None == self.URL:
+			raise CurlRequestException("You have to set URL in your CurlParallelRequest instance")
+		m = pycurl.CurlMulti()
+		requests = []
+		for i in range(self.COUNT):
+			c = pycurl.Curl()
+			b = StringIO.StringIO()
+			c.setopt(pycurl.URL, "http://127.0.0.2:%i%s" % (Env.port + self.PORT, self.URL))
+			c.setopt(pycurl.HTTPHEADER, ["Host: " + self.vhost])
+			c.setopt(pycurl.NOSIGNAL, 1)
+			c.setopt(pycurl.TIMEOUT, 5)
+			c.setopt(pycurl.WRITEFUNCTION, b.write)
+			m.add_handle(c)
+			requests.append((c, b))
+
+		try:
+			active = self.COUNT
+			while active:
+				while True:
+					ret, active = m.perform()
+					if ret != pycurl.E_CALL_MULTI_PERFORM: break
+				if active: m.select(1.0)
+
+			for (c, b) in requests:
+				code = c.getinfo(pycurl.RESPONSE_CODE)
+				if None != self.EXPECT_RESPONSE_CODE and code != self.EXPECT_RESPONSE_CODE:
+					raise CurlRequestException("Unexpected response code %i (wanted %i)" % (code, self.EXPECT_RESPONSE_CODE))
+				if None != self.EXPECT_RESPONSE_BODY and b.getvalue() != self.EXPECT_RESPONSE_BODY:
+					print >> Env.log, "Curl response body for test '%s':" % (self.name)
+					print >> Env.log, b.getvalue()
+					raise CurlRequestException("Unexpected response body")
+		finally:
+			for (c, b) in requests:
+				m.remove_handle(c)
+				c.close()
+			m.close()
+
+		return True
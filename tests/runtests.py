@@ -56,6 +56,7 @@ parser.add_option("--debug", help = "Show service logs on console", action = "st
 parser.add_option("--wait", help = "Wait for services to exit on first signal", action = "store_true", default = False)
 parser.add_option("--valgrind", help = "Run worker with valgrind from angel", action = "store_true", default = False)
 parser.add_option("--valgrind-leak", help = "Run valgrind with memory leak check; takes an empty string or a valgrind suppression file", action="store", default = False)
+parser.add_option("--write-backend", help = "io.write_backend for the worker (writev, sendfile or io_uring; default: lighttpd's default)", default = None)
 
 (options, args) = parser.parse_args()
 
@@ -81,6 +82,7 @@ Env.debug = options.debug
 Env.wait = options.wait
 Env.valgrind = options.valgrind
 Env.valgrind_leak = options.valgrind_leak
+Env.write_backend = options.write_backend
 if Env.valgrind or Env.valgrind_leak:
 	Env.valgrind = which('valgrind')
 
@@ -193,6 +193,8 @@ class Lighttpd(Service):
 		else:
 			self.fork(base.Env.angel, '-o', '-m', base.Env.plugindir, '-c', base.Env.angelconf)
 		self.waitconnect(base.Env.port)
+		# the reuseport sockets are created after the worker count is known
+		self.waitconnect(base.Env.port + 3)
 
 class FastCGI(Service):
 	binary = [None]
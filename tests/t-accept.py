@@ -0,0 +1,52 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+# the main worker accepts all connections on the default listen socket and hands them to
+# the workers through a ring per worker; the remote address is copied out of the ring slot
+
+class TestRemoteAddress(CurlRequest):
+	URL = "/remote"
+	EXPECT_RESPONSE_BODY = "local"
+	EXPECT_RESPONSE_CODE = 200
+
+class TestBurst(CurlParallelRequest):
+	URL = "/remote"
+	COUNT = 64
+	EXPECT_RESPONSE_BODY = "local"
+	EXPECT_RESPONSE_CODE = 200
+
+# more connections at once than fit into a ring (LI_WORKER_NEW_CON_RING_SIZE)
+class TestBigBurst(CurlParallelRequest):
+	URL = "/remote"
+	COUNT = 300
+	EXPECT_RESPONSE_BODY = "local"
+	EXPECT_RESPONSE_CODE = 200
+
+class TestStatic(CurlParallelRequest):
+	URL = "/test.txt"
+	COUNT = 64
+	EXPECT_RESPONSE_BODY = TEST_TXT
+	EXPECT_RESPONSE_CODE = 200
+
+class Test(GroupTest):
+	group = [
+		TestRemoteAddress,
+		TestBurst,
+		TestBigBurst,
+		TestStatic,
+	]
+
+	def Prepare(self):
+		self.PrepareVHostFile("test.txt", TEST_TXT)
+
+	config = """
+if req.path == "/remote" {
+	if request.remoteip =/ "127.0.0.0/8" {
+		respond "local";
+	} else {
+		respond "remote";
+	}
+}
+"""
@@ -0,0 +1,55 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+# header values and stat results used by conditions are cached per request; modifying the
+# headers or changing the physical path has to invalidate them
+
+class TestHeaderCached(CurlRequest):
+	URL = "/header"
+	REQUEST_HEADERS = ["X-Select: b"]
+	EXPECT_RESPONSE_BODY = "b"
+
+class TestHeaderModified(CurlRequest):
+	URL = "/header"
+	REQUEST_HEADERS = ["X-Select: a"]
+	EXPECT_RESPONSE_BODY = "b"
+
+class TestPhysicalChanged(CurlRequest):
+	URL = "/x.txt"
+	EXPECT_RESPONSE_BODY = "missing"
+
+class Test(GroupTest):
+	group = [
+		TestHeaderCached,
+		TestHeaderModified,
+		TestPhysicalChanged,
+	]
+
+	def Prepare(self):
+		self.PrepareVHostFile("x.txt", "x")
+
+	config = """
+if req.path == "/header" {
+	if req.header["X-Select"] == "a" {
+		req_header.overwrite "X-Select" => "b";
+	}
+	if req.header["X-Select"] == "b" {
+		respond "b";
+	} else {
+		respond "stale";
+	}
+} else if req.path == "/x.txt" {
+	if phys.is_file {
+		docroot "/nonexistent";
+		if phys.exists {
+			respond "stale";
+		} else {
+			respond "missing";
+		}
+	} else {
+		respond "not found";
+	}
+}
+"""
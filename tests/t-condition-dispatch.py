@@ -0,0 +1,78 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+# the chains are long enough to be replaced by dispatch tables; the results must be the same as
+# checking the conditions one by one
+
+class TestDispatchEqual(CurlRequest):
+	URL = "/a"
+	EXPECT_RESPONSE_BODY = "eq-a"
+
+class TestDispatchFirstPrefix(CurlRequest):
+	URL = "/prefix/deeper/x"
+	EXPECT_RESPONSE_BODY = "prefix"
+
+class TestDispatchSuffix(CurlRequest):
+	URL = "/x.txt"
+	EXPECT_RESPONSE_BODY = "suffix-txt"
+
+class TestDispatchSuffixBeforeEqual(CurlRequest):
+	URL = "/p.txt"
+	EXPECT_RESPONSE_BODY = "suffix-txt"
+
+class TestDispatchPrefixBeforeEqual(CurlRequest):
+	URL = "/px"
+	EXPECT_RESPONSE_BODY = "p"
+
+class TestDispatchElse(CurlRequest):
+	URL = "/zzz"
+	EXPECT_RESPONSE_BODY = "else"
+
+class TestDispatchIP(CurlRequest):
+	URL = "/ip"
+	EXPECT_RESPONSE_BODY = "lo8"
+
+class Test(GroupTest):
+	group = [
+		TestDispatchEqual,
+		TestDispatchFirstPrefix,
+		TestDispatchSuffix,
+		TestDispatchSuffixBeforeEqual,
+		TestDispatchPrefixBeforeEqual,
+		TestDispatchElse,
+		TestDispatchIP,
+	]
+
+	config = """
+if req.path == "/ip" {
+	if req.localip =/ "10.0.0.0/8" {
+		respond "ten";
+	} else if req.localip =/ "::1" {
+		respond "v6";
+	} else if req.localip =/ "127.0.0.0/8" {
+		respond "lo8";
+	} else if req.localip =/ "127.0.0.2" {
+		respond "lo2";
+	} else {
+		respond "other";
+	}
+} else if req.path == "/a" {
+	respond "eq-a";
+} else if req.path =^ "/prefix/" {
+	respond "prefix";
+} else if req.path =^ "/prefix/deeper/" {
+	respond "deeper";
+} else if req.path =$ ".txt" {
+	respond "suffix-txt";
+} else if req.path == "/p.txt" {
+	respond "never";
+} else if req.path =^ "/p" {
+	respond "p";
+} else if req.path == "/px" {
+	respond "never";
+} else {
+	respond "else";
+}
+"""
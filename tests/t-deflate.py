@@ -16,6 +16,10 @@ class DeflateRequest(CurlRequest):
 class TestGzip(DeflateRequest):
 	ACCEPT_ENCODING = 'gzip'
 
+# second request for the same file: served from the deflate.cache directory
+class TestCachedGzip(DeflateRequest):
+	ACCEPT_ENCODING = 'gzip'
+
 class TestXGzip(DeflateRequest):
 	ACCEPT_ENCODING = 'x-gzip'
 
@@ -32,6 +36,92 @@ class TestBzip2(DeflateRequest):
 class TestXBzip2(DeflateRequest):
 	ACCEPT_ENCODING = 'x-bzip2'
 
+class TestBrotli(DeflateRequest):
+	ACCEPT_ENCODING = 'br'
+
+	def FeatureCheck(self):
+		if None == brotli:
+			return self.MissingFeature('python brotli module')
+		return True
+
+class TestZstd(DeflateRequest):
+	ACCEPT_ENCODING = 'zstd'
+
+	def FeatureCheck(self):
+		if None == zstandard:
+			return self.MissingFeature('python zstandard module')
+		return True
+
+class TestOffloadGzip(DeflateRequest):
+	URL = "/test.txt?offload"
+	ACCEPT_ENCODING = 'gzip'
+
+class TestOffloadBzip2(DeflateRequest):
+	URL = "/test.txt?offload"
+	ACCEPT_ENCODING = 'bzip2'
+
+class TestAdaptiveGzip(DeflateRequest):
+	URL = "/test.txt?adaptive"
+	ACCEPT_ENCODING = 'gzip'
+
+# dynamic responses, compressed with a new or a recycled context; each with different content
+class ReuseRequest(DeflateRequest):
+	URL = "/test.txt?reuse"
+	ROUND = 0
+
+	def Prepare(self):
+		self.EXPECT_RESPONSE_BODY = "".join([ "%s-%i-%i;" % (self.ACCEPT_ENCODING, self.ROUND, i) for i in range(0, 300) ])
+		self.REQUEST_HEADERS = ["X-Body: " + self.EXPECT_RESPONSE_BODY]
+		super(ReuseRequest, self).Prepare()
+
+class TestReuseGzip1(ReuseRequest):
+	ACCEPT_ENCODING = 'gzip'
+	ROUND = 1
+
+class TestReuseGzip2(ReuseRequest):
+	ACCEPT_ENCODING = 'gzip'
+	ROUND = 2
+
+class TestReuseGzip3(ReuseRequest):
+	ACCEPT_ENCODING = 'gzip'
+	ROUND = 3
+
+class TestReuseDeflate1(ReuseRequest):
+	ACCEPT_ENCODING = 'deflate'
+	ROUND = 1
+
+class TestReuseDeflate2(ReuseRequest):
+	ACCEPT_ENCODING = 'deflate'
+	ROUND = 2
+
+class TestReuseDeflate3(ReuseRequest):
+	ACCEPT_ENCODING = 'deflate'
+	ROUND = 3
+
+# bzip2 contexts are not recycled; mixed in to check gzip contexts aren't mixed up
+class TestReuseBzip2(ReuseRequest):
+	ACCEPT_ENCODING = 'bzip2'
+	ROUND = 1
+
+class TestReuseGzip4(ReuseRequest):
+	ACCEPT_ENCODING = 'gzip'
+	ROUND = 4
+
+class TestReuseZstd1(ReuseRequest):
+	ACCEPT_ENCODING = 'zstd'
+	ROUND = 1
+
+	def FeatureCheck(self):
+		if None == zstandard:
+			return self.MissingFeature('python zstandard module')
+		return True
+
+class TestReuseZstd2(TestReuseZstd1):
+	ROUND = 2
+
+class TestReuseZstd3(TestReuseZstd1):
+	ROUND = 3
+
 class TestDisableDeflate(CurlRequest):
 	URL = "/test.txt?nodeflate"
 	EXPECT_RESPONSE_BODY = TEST_TXT
@@ -41,11 +131,16 @@ class TestDisableDeflate(CurlRequest):
 
 
 class Test(GroupTest):
-	group = [TestGzip, TestXGzip, TestDeflate, TestBzip2, TestXBzip2, TestDisableDeflate]
+	group = [TestGzip, TestCachedGzip, TestXGzip, TestDeflate, TestBzip2, TestXBzip2, TestBrotli, TestZstd, TestOffloadGzip, TestOffloadBzip2, TestAdaptiveGzip,
+		TestReuseGzip1, TestReuseGzip2, TestReuseGzip3, TestReuseDeflate1, TestReuseDeflate2, TestReuseDeflate3, TestReuseBzip2, TestReuseGzip4,
+		TestReuseZstd1, TestReuseZstd2, TestReuseZstd3, TestDisableDeflate]
 
 	def Prepare(self):
 		# deflate is enabled global too; force it here anyway
 		self.config = """
 defaultaction;
+if req.query == "offload" { static; deflate [ "offload-threshold" => 1 ]; }
+if req.query == "adaptive" { static; deflate [ "compression-level" => 6, "min-compression-level" => 1, "load-requests" => 1000 ]; }
+if req.query == "reuse" { respond 200 => "%{req.header[X-Body]}"; }
 if req.query == "nodeflate" { req_header.remove "Accept-Encoding"; } static; do_deflate;
 """
@@ -0,0 +1,120 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+import re
+import time
+
+# static.memory_cache (enabled in the test setup) keeps small files (up to 16kbyte by default)
+# in memory; an entry is only used while size, inode, mtime and ctime still match
+
+SMALL = "small file, version 1\n"
+SMALL_CHANGED = "small file, version 2\n" # same size
+LARGE = "".join([ "%07i\n" % i for i in range(0, 2500) ]) # 20000 bytes
+
+def fetch(vhost, url):
+	c = pycurl.Curl()
+	b = StringIO.StringIO()
+	c.setopt(pycurl.URL, "http://127.0.0.2:%i%s" % (Env.port, url))
+	c.setopt(pycurl.HTTPHEADER, ["Host: " + vhost])
+	c.setopt(pycurl.NOSIGNAL, 1)
+	c.setopt(pycurl.TIMEOUT, 2)
+	c.setopt(pycurl.WRITEFUNCTION, b.write)
+	try:
+		c.perform()
+		code = c.getinfo(pycurl.RESPONSE_CODE)
+	finally:
+		c.close()
+	return (code, b.getvalue())
+
+def file_cache_hits(vhost):
+	(code, status) = fetch(vhost, "/server-status?format=plain")
+	m = re.search("^file_cache_hits: (\d+)$", status, re.M)
+	if 200 != code or None == m:
+		raise CurlRequestException("Missing 'file_cache_hits' in status page")
+	return int(m.group(1))
+
+class TestSmall(CurlRequest):
+	URL = "/small.txt"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = SMALL
+	EXPECT_RESPONSE_CODE = 200
+
+class TestSmallCached(TestBase):
+	def Run(self):
+		before = file_cache_hits(self.vhost)
+		for i in range(0, 10):
+			(code, body) = fetch(self.vhost, "/small.txt")
+			if 200 != code or SMALL != body:
+				raise CurlRequestException("Unexpected response %i '%s'" % (code, body))
+		after = file_cache_hits(self.vhost)
+		# the first request in each worker may still be a miss
+		if after < before + 8:
+			raise CurlRequestException("Small file not served from the memory cache: %i -> %i hits" % (before, after))
+		return True
+
+class TestRange(CurlRequest):
+	URL = "/small.txt"
+	ACCEPT_ENCODING = None
+	REQUEST_HEADERS = ["Range: bytes=6-9"]
+	EXPECT_RESPONSE_BODY = SMALL[6:10]
+	EXPECT_RESPONSE_CODE = 206
+
+# rewritten in place within the same second: same inode and size
+class TestSmallChanged(CurlParallelRequest):
+	URL = "/small.txt"
+	COUNT = 8
+	EXPECT_RESPONSE_BODY = SMALL_CHANGED
+	EXPECT_RESPONSE_CODE = 200
+
+	def FeatureCheck(self):
+		if not sys.platform.startswith("linux"):
+			return self.MissingFeature("inotify")
+		return True
+
+	def Run(self):
+		f = open(os.path.join(self.vhostdir, "small.txt"), "r+")
+		f.write(SMALL_CHANGED)
+		f.close()
+		time.sleep(0.2)
+		return super(TestSmallChanged, self).Run()
+
+# too big for the memory cache
+class TestLarge(CurlRequest):
+	URL = "/large.txt"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = LARGE
+	EXPECT_RESPONSE_CODE = 200
+
+class TestLargeAgain(TestLarge):
+	pass
+
+class TestEmpty(CurlRequest):
+	URL = "/empty.txt"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = ""
+	EXPECT_RESPONSE_CODE = 200
+
+class Test(GroupTest):
+	group = [
+		TestSmall,
+		TestSmallCached,
+		TestRange,
+		TestSmallChanged,
+		TestLarge,
+		TestLargeAgain,
+		TestEmpty,
+	]
+
+	def Prepare(self):
+		self.PrepareVHostFile("small.txt", SMALL)
+		self.PrepareVHostFile("large.txt", LARGE)
+		self.PrepareVHostFile("empty.txt", "")
+
+	config = """
+setup { module_load "mod_status"; }
+if req.path == "/server-status" {
+	status.info;
+}
+"""
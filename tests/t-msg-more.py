@@ -0,0 +1,100 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+import re
+
+# the header block and the body of a response are written with one call, MSG_MORE tells the
+# kernel about following data instead of toggling TCP_CORK; mod_status counts the syscalls
+
+BODY = "".join([ "%07i," % i for i in range(0, 2500) ]) # 20000 bytes
+
+def fetch(vhost, url):
+	c = pycurl.Curl()
+	b = StringIO.StringIO()
+	c.setopt(pycurl.URL, "http://127.0.0.2:%i%s" % (Env.port, url))
+	c.setopt(pycurl.HTTPHEADER, ["Host: " + vhost])
+	c.setopt(pycurl.NOSIGNAL, 1)
+	c.setopt(pycurl.TIMEOUT, 2)
+	c.setopt(pycurl.WRITEFUNCTION, b.write)
+	try:
+		c.perform()
+		code = c.getinfo(pycurl.RESPONSE_CODE)
+	finally:
+		c.close()
+	return (code, b.getvalue())
+
+def write_stats(vhost):
+	(code, status) = fetch(vhost, "/server-status?format=plain")
+	if 200 != code:
+		raise CurlRequestException("Unexpected response code %i for status page" % code)
+	stats = { }
+	for key in ["write_syscalls", "cork_syscalls"]:
+		m = re.search("^%s: (\d+)$" % key, status, re.M)
+		if None == m:
+			raise CurlRequestException("Missing '%s' in status page" % key)
+		stats[key] = int(m.group(1))
+	if None == re.search("^write_syscalls_per_request: \d+\.\d\d$", status, re.M):
+		raise CurlRequestException("Missing 'write_syscalls_per_request' in status page")
+	return stats
+
+class TestSmallMemory(CurlRequest):
+	URL = "/memory"
+	EXPECT_RESPONSE_BODY = "small"
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Length", "5")]
+
+class TestLargeMemory(CurlRequest):
+	URL = "/large"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = BODY
+	EXPECT_RESPONSE_CODE = 200
+
+class TestFile(CurlRequest):
+	URL = "/body.txt"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = BODY
+	EXPECT_RESPONSE_CODE = 200
+
+# header and memory bodies don't need TCP_CORK
+class TestNoCork(TestBase):
+	def FeatureCheck(self):
+		if not sys.platform.startswith("linux"):
+			return self.MissingFeature("MSG_MORE")
+		return True
+
+	def Run(self):
+		before = write_stats(self.vhost)
+		for i in range(0, 10):
+			(code, body) = fetch(self.vhost, "/memory")
+			if 200 != code or "small" != body:
+				raise CurlRequestException("Unexpected response %i '%s'" % (code, body))
+		after = write_stats(self.vhost)
+		if after["write_syscalls"] < before["write_syscalls"] + 10:
+			raise CurlRequestException("write_syscalls didn't count the responses: %i -> %i" % (before["write_syscalls"], after["write_syscalls"]))
+		if after["cork_syscalls"] != before["cork_syscalls"]:
+			raise CurlRequestException("cork_syscalls changed: %i -> %i" % (before["cork_syscalls"], after["cork_syscalls"]))
+		return True
+
+class Test(GroupTest):
+	group = [
+		TestSmallMemory,
+		TestLargeMemory,
+		TestFile,
+		TestNoCork,
+	]
+
+	def Prepare(self):
+		self.PrepareVHostFile("body.txt", BODY)
+
+	config = """
+setup { module_load "mod_status"; }
+if req.path == "/server-status" {
+	status.info;
+} else if req.path == "/memory" {
+	respond "small";
+} else if req.path == "/large" {
+	respond "%s";
+}
+""" % BODY
@@ -0,0 +1,67 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+# port + 4 is an openssl listener with "ktls" => true; kernel TLS needs TLS 1.2 (with AES-GCM),
+# other connections (and kernels without the tls module) keep using OpenSSL for sending
+
+BIG_FILE = "".join([ "%07i\n" % i for i in range(0, 128*1024) ]) # 1 MiB
+
+class KTLSRequest(CurlRequest):
+	PORT = 4
+	SCHEME = "https"
+	ACCEPT_ENCODING = None
+	vhost = "test1.ssl"
+
+	def PrepareRequest(self, reqheaders):
+		if hasattr(pycurl, "SSLVERSION_MAX_TLSv1_2"):
+			self.curl.setopt(pycurl.SSLVERSION, pycurl.SSLVERSION_TLSv1_2 | pycurl.SSLVERSION_MAX_TLSv1_2)
+		else:
+			self.curl.setopt(pycurl.SSLVERSION, pycurl.SSLVERSION_TLSv1_2)
+
+class TestSimpleRequest(KTLSRequest):
+	URL = "/test.txt"
+	EXPECT_RESPONSE_BODY = TEST_TXT
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Type", "text/plain; charset=utf-8")]
+
+# sent with sendfile() through the kernel TLS socket
+class TestBigFile(KTLSRequest):
+	URL = "/ktls-big.txt"
+	EXPECT_RESPONSE_BODY = BIG_FILE
+	EXPECT_RESPONSE_CODE = 200
+
+# memory chunks mixed with file chunks
+class TestMultipartRange(KTLSRequest):
+	URL = "/ktls-big.txt"
+	REQUEST_HEADERS = ["Range: bytes=0-9,500000-599999"]
+	EXPECT_RESPONSE_CODE = 206
+
+	def CheckResponse(self):
+		body = self.ResponseBody()
+		pos = body.find("\r\n\r\n" + BIG_FILE[0:10] + "\r\n--")
+		if -1 == pos or -1 == body.find("\r\n\r\n" + BIG_FILE[500000:600000] + "\r\n--", pos):
+			raise CurlRequestException("Missing part in multipart response")
+		return True
+
+# TLS 1.3 connections stay with OpenSSL
+class TestDefaultVersion(CurlRequest):
+	PORT = 4
+	SCHEME = "https"
+	ACCEPT_ENCODING = None
+	URL = "/ktls-big.txt"
+	EXPECT_RESPONSE_BODY = BIG_FILE
+	EXPECT_RESPONSE_CODE = 200
+	vhost = "test1.ssl"
+
+class Test(GroupTest):
+	group = [
+		TestSimpleRequest,
+		TestBigFile,
+		TestMultipartRange,
+		TestDefaultVersion,
+	]
+
+	def Prepare(self):
+		self.PrepareFile("www/default/ktls-big.txt", BIG_FILE)
@@ -0,0 +1,56 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+# the sibling contents don't need to be valid compressed data, curl doesn't decode them
+PLAIN = "plain content\n"
+BROTLI = "brotli content\n"
+GZIP = "gzip content\n"
+
+class TestPrecompressedBrotli(CurlRequest):
+	URL = "/pc.txt"
+	ACCEPT_ENCODING = "gzip, br"
+	EXPECT_RESPONSE_BODY = BROTLI
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Encoding", "br"), ("Content-Type", "text/plain; charset=utf-8"), ("Vary", "Accept-Encoding")]
+
+class TestPrecompressedGzip(CurlRequest):
+	URL = "/pc.txt"
+	ACCEPT_ENCODING = "gzip, br;q=0"
+	EXPECT_RESPONSE_BODY = GZIP
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Encoding", "gzip"), ("Content-Type", "text/plain; charset=utf-8"), ("Vary", "Accept-Encoding")]
+
+class TestPrecompressedIdentity(CurlRequest):
+	URL = "/pc.txt"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = PLAIN
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Encoding", None), ("Vary", "Accept-Encoding")]
+
+class TestPrecompressedStale(CurlRequest):
+	URL = "/pc-stale.txt"
+	ACCEPT_ENCODING = "gzip"
+	EXPECT_RESPONSE_BODY = PLAIN
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Encoding", None)]
+
+class Test(GroupTest):
+	group = [TestPrecompressedBrotli, TestPrecompressedGzip, TestPrecompressedIdentity, TestPrecompressedStale]
+
+	def Prepare(self):
+		self.PrepareVHostFile("pc.txt", PLAIN)
+		self.PrepareVHostFile("pc.txt.br", BROTLI)
+		self.PrepareVHostFile("pc.txt.gz", GZIP)
+		self.PrepareVHostFile("pc-stale.txt", PLAIN)
+		stale = self.PrepareVHostFile("pc-stale.txt.gz", GZIP)
+		# older than pc-stale.txt
+		os.utime(stale, (0, 0))
+		self.config = """
+static.precompressed true;
+defaultaction;
+static;
+# keep the global deflate away from the stale response
+if req.path == "/pc-stale.txt" { req_header.remove "Accept-Encoding"; }
+"""
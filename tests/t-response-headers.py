@@ -0,0 +1,96 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+# the response header block is written into a buffer shared by the responses of a worker;
+# every request here sends a complete response through it
+
+BIG_VALUE = "x" * 20000
+
+class TestStatusLine(CurlRequest):
+	URL = "/"
+	EXPECT_RESPONSE_BODY = "ok"
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Connection", "close")]
+	config = """
+respond 200 => "ok";
+"""
+
+	def CheckResponse(self):
+		if self.resp_first_line != "HTTP/1.1 200 OK":
+			raise BaseException("Unexpected status line '%s'" % self.resp_first_line)
+		if not self.resp_headers.has_key("date") or not self.resp_headers.has_key("server"):
+			raise BaseException("Missing Date or Server header")
+		return True
+
+class TestHttp10(CurlRequest):
+	URL = "/"
+	EXPECT_RESPONSE_BODY = "ok"
+	EXPECT_RESPONSE_CODE = 200
+	config = """
+respond 200 => "ok";
+"""
+
+	def PrepareRequest(self, reqheaders):
+		self.curl.setopt(pycurl.HTTP_VERSION, pycurl.CURL_HTTP_VERSION_1_0)
+
+	def CheckResponse(self):
+		if self.resp_first_line != "HTTP/1.0 200 OK":
+			raise BaseException("Unexpected status line '%s'" % self.resp_first_line)
+		return True
+
+class TestHeaderOrder(CurlRequest):
+	URL = "/"
+	EXPECT_RESPONSE_BODY = "ok"
+	EXPECT_RESPONSE_CODE = 201
+	# connection headers from the config/backends are replaced
+	EXPECT_RESPONSE_HEADERS = [("Connection", "close"), ("Server", "tag-test")]
+	config = """
+header.add "X-First" => "1";
+header.add "Connection" => "upgrade";
+header.add "X-Second" => "2";
+header.add "X-First" => "3";
+server.tag "tag-test";
+respond 201 => "ok";
+"""
+
+	def CheckResponse(self):
+		h = filter(lambda x: x[0].startswith("X-"), self.resp_header_list)
+		if h != [("X-First", "1"), ("X-Second", "2"), ("X-First", "3")]:
+			print >>Env.log, repr(h)
+			raise BaseException("Unexpected X- headers")
+		return True
+
+class TestHugeHeader(CurlRequest):
+	# doesn't fit into the shared buffer
+	URL = "/"
+	EXPECT_RESPONSE_BODY = "ok"
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("X-Big", BIG_VALUE)]
+	config = """
+header.add "X-Big" => "%s";
+respond 200 => "ok";
+""" % BIG_VALUE
+
+class TestErrorPage(CurlRequest):
+	URL = "/"
+	EXPECT_RESPONSE_CODE = 404
+	EXPECT_RESPONSE_HEADERS = [("Connection", "close")]
+	config = """
+respond 404;
+"""
+
+	def CheckResponse(self):
+		if self.resp_first_line != "HTTP/1.1 404 Not Found":
+			raise BaseException("Unexpected status line '%s'" % self.resp_first_line)
+		return True
+
+class Test(GroupTest):
+	group = [
+		TestStatusLine,
+		TestHttp10,
+		TestHeaderOrder,
+		TestHugeHeader,
+		TestErrorPage,
+	]
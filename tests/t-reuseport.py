@@ -0,0 +1,47 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+# port + 3 is a listen.reuseport address: every worker accepts on its own socket
+
+class TestSimpleRequest(CurlRequest):
+	PORT = 3
+	URL = "/test.txt"
+	EXPECT_RESPONSE_BODY = TEST_TXT
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Type", "text/plain; charset=utf-8")]
+
+class TestNotFound(CurlRequest):
+	PORT = 3
+	URL = "/nothing.txt"
+	EXPECT_RESPONSE_CODE = 404
+
+# enough connections to reach both workers
+class TestParallel(CurlParallelRequest):
+	PORT = 3
+	URL = "/test.txt"
+	COUNT = 32
+	EXPECT_RESPONSE_BODY = TEST_TXT
+	EXPECT_RESPONSE_CODE = 200
+
+class TestParallelDefaultListen(CurlParallelRequest):
+	URL = "/test.txt"
+	COUNT = 32
+	EXPECT_RESPONSE_BODY = TEST_TXT
+	EXPECT_RESPONSE_CODE = 200
+
+class Test(GroupTest):
+	group = [
+		TestSimpleRequest,
+		TestNotFound,
+		TestParallel,
+		TestParallelDefaultListen,
+	]
+
+	def Prepare(self):
+		self.PrepareVHostFile("test.txt", TEST_TXT)
+
+	config = """
+static;
+"""
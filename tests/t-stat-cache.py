@@ -0,0 +1,190 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+import time
+
+# the stat cache opens regular files in the tasklet and shares the fd between requests;
+# other file types are only stat()ed
+
+FILE_COUNT = 50
+
+# changes are seen through inotify, without it only after stat_cache.ttl (10 seconds)
+def inotify_feature_check(test):
+	if not sys.platform.startswith("linux"):
+		return test.MissingFeature("inotify")
+	return True
+
+# give the workers time to read the inotify events
+def wait_for_inotify():
+	time.sleep(0.2)
+
+class TestFile(CurlRequest):
+	URL = "/test.txt"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = TEST_TXT
+	EXPECT_RESPONSE_CODE = 200
+
+# stat cache hit, uses the already open file
+class TestFileAgain(TestFile):
+	pass
+
+class TestFileParallel(CurlParallelRequest):
+	URL = "/test.txt"
+	COUNT = 32
+	EXPECT_RESPONSE_BODY = TEST_TXT
+	EXPECT_RESPONSE_CODE = 200
+
+class TestManyFiles(CurlRequest):
+	URL = "/file-0.txt"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = "file 0\n"
+	EXPECT_RESPONSE_CODE = 200
+
+	def CheckResponse(self):
+		for i in range(1, FILE_COUNT):
+			c = pycurl.Curl()
+			b = StringIO.StringIO()
+			c.setopt(pycurl.URL, "http://127.0.0.2:%i/file-%i.txt" % (Env.port, i))
+			c.setopt(pycurl.HTTPHEADER, ["Host: " + self.vhost])
+			c.setopt(pycurl.NOSIGNAL, 1)
+			c.setopt(pycurl.TIMEOUT, 2)
+			c.setopt(pycurl.WRITEFUNCTION, b.write)
+			try:
+				c.perform()
+				code = c.getinfo(pycurl.RESPONSE_CODE)
+			finally:
+				c.close()
+			if 200 != code or ("file %i\n" % i) != b.getvalue():
+				raise CurlRequestException("Unexpected response %i for file-%i.txt" % (code, i))
+		return True
+
+# cache the file in both workers
+class TestChangingFile(CurlParallelRequest):
+	URL = "/changing.txt"
+	COUNT = 8
+	EXPECT_RESPONSE_BODY = "old content\n"
+	EXPECT_RESPONSE_CODE = 200
+
+	def FeatureCheck(self):
+		return inotify_feature_check(self)
+
+class TestModifiedFile(CurlParallelRequest):
+	URL = "/changing.txt"
+	COUNT = 8
+	EXPECT_RESPONSE_BODY = "modified content, longer\n"
+	EXPECT_RESPONSE_CODE = 200
+
+	def FeatureCheck(self):
+		return inotify_feature_check(self)
+
+	def Run(self):
+		f = open(os.path.join(self.vhostdir, "changing.txt"), "w")
+		f.write(self.EXPECT_RESPONSE_BODY)
+		f.close()
+		wait_for_inotify()
+		return super(TestModifiedFile, self).Run()
+
+# a new file renamed over the cached one: the open fd still refers to the old file
+class TestReplacedFile(CurlParallelRequest):
+	URL = "/changing.txt"
+	COUNT = 8
+	EXPECT_RESPONSE_BODY = "replaced\n"
+	EXPECT_RESPONSE_CODE = 200
+
+	def FeatureCheck(self):
+		return inotify_feature_check(self)
+
+	def Run(self):
+		path = os.path.join(self.vhostdir, "changing.txt")
+		f = open(path + ".new", "w")
+		f.write(self.EXPECT_RESPONSE_BODY)
+		f.close()
+		os.rename(path + ".new", path)
+		wait_for_inotify()
+		return super(TestReplacedFile, self).Run()
+
+# ENOENT results are kept in the negative set until the directory changes
+class TestMissing(CurlParallelRequest):
+	URL = "/late.txt"
+	COUNT = 8
+	EXPECT_RESPONSE_CODE = 404
+
+	def FeatureCheck(self):
+		return inotify_feature_check(self)
+
+class TestMissingAgain(TestMissing):
+	pass
+
+class TestOtherMissing(CurlParallelRequest):
+	URL = "/other-late.txt"
+	COUNT = 8
+	EXPECT_RESPONSE_CODE = 404
+
+	def FeatureCheck(self):
+		return inotify_feature_check(self)
+
+class TestCreated(CurlParallelRequest):
+	URL = "/late.txt"
+	COUNT = 8
+	EXPECT_RESPONSE_BODY = "created\n"
+	EXPECT_RESPONSE_CODE = 200
+
+	def FeatureCheck(self):
+		return inotify_feature_check(self)
+
+	def Run(self):
+		self.PrepareVHostFile("late.txt", self.EXPECT_RESPONSE_BODY)
+		wait_for_inotify()
+		return super(TestCreated, self).Run()
+
+# still missing after the directory changed
+class TestOtherStillMissing(TestOtherMissing):
+	pass
+
+# must not be opened: open() on a fifo without writer blocks
+class TestFifo(CurlRequest):
+	URL = "/fifo"
+	EXPECT_RESPONSE_CODE = 403
+
+class TestFifoAgain(TestFifo):
+	pass
+
+# not handled by static
+class TestDirectory(CurlRequest):
+	URL = "/dir"
+	EXPECT_RESPONSE_CODE = 404
+
+class Test(GroupTest):
+	group = [
+		TestFile,
+		TestFileAgain,
+		TestFileParallel,
+		TestManyFiles,
+		TestChangingFile,
+		TestModifiedFile,
+		TestReplacedFile,
+		TestMissing,
+		TestMissingAgain,
+		TestOtherMissing,
+		TestCreated,
+		TestOtherStillMissing,
+		TestFifo,
+		TestFifoAgain,
+		TestDirectory,
+	]
+
+	def Prepare(self):
+		self.PrepareVHostFile("test.txt", TEST_TXT)
+		for i in range(0, FILE_COUNT):
+			self.PrepareVHostFile("file-%i.txt" % i, "file %i\n" % i)
+		self.PrepareVHostFile("changing.txt", "old content\n")
+		fifo = self.PrepareVHostFile("fifo", "")
+		os.remove(fifo)
+		os.mkfifo(fifo)
+		self.PrepareVHostFile("dir/index.txt", "")
+
+	config = """
+static;
+"""
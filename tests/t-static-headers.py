@@ -0,0 +1,143 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+import time
+import email.utils
+
+# ETag, Last-Modified and Content-Type of static files are computed once by the stat cache;
+# they still have to follow the etag.use and mime_types options of the request
+
+PAGE = "<html><body>static headers</body></html>\n"
+
+retrieved_etag = None
+retrieved_last_modified = None
+
+class TestHeaders(CurlRequest):
+	URL = "/page.html"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = PAGE
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Type", "text/html")]
+
+	def CheckResponse(self):
+		global retrieved_etag, retrieved_last_modified
+		if not self.resp_headers.has_key('etag') or not self.resp_headers.has_key('last-modified'):
+			raise CurlRequestException("Response missing etag or last-modified header")
+		mtime = os.stat(os.path.join(self.vhostdir, "page.html")).st_mtime
+		last_modified = email.utils.formatdate(mtime, usegmt = True)
+		if self.resp_headers['last-modified'] != last_modified:
+			raise CurlRequestException("Unexpected last-modified header '%s' (wanted '%s')" % (self.resp_headers['last-modified'], last_modified))
+		retrieved_etag = self.resp_headers['etag']
+		retrieved_last_modified = self.resp_headers['last-modified']
+		return True
+
+# same values from the cached entry
+class TestHeadersAgain(TestHeaders):
+	pass
+
+class TestIfNoneMatch(CurlRequest):
+	URL = "/page.html"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = ""
+	EXPECT_RESPONSE_CODE = 304
+
+	def PrepareRequest(self, reqheaders):
+		if None == retrieved_etag:
+			raise CurlRequestException("Don't have a etag value to request")
+		self.curl.setopt(pycurl.HTTPHEADER, reqheaders + ["If-None-Match: " + retrieved_etag])
+
+class TestIfNoneMatchStale(CurlRequest):
+	URL = "/page.html"
+	ACCEPT_ENCODING = None
+	REQUEST_HEADERS = ['If-None-Match: "stale"']
+	EXPECT_RESPONSE_BODY = PAGE
+	EXPECT_RESPONSE_CODE = 200
+
+class TestIfModifiedSince(CurlRequest):
+	URL = "/page.html"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = ""
+	EXPECT_RESPONSE_CODE = 304
+
+	def PrepareRequest(self, reqheaders):
+		if None == retrieved_last_modified:
+			raise CurlRequestException("Don't have a last-modified value to request")
+		self.curl.setopt(pycurl.HTTPHEADER, reqheaders + ["If-Modified-Since: " + retrieved_last_modified])
+
+class TestUnknownType(CurlRequest):
+	URL = "/data.unknown-extension"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = "data"
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Type", "application/octet-stream")]
+
+# the same file with other options (the stat cache entry is shared)
+class TestOtherMimeTypes(CurlRequest):
+	URL = "/page.html"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = PAGE
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Type", "text/x-other"), ("ETag", None)]
+	inherit_docroot = True
+	config = """
+mime_types (".html" => "text/x-other");
+etag.use [];
+"""
+
+class TestDefaultMimeTypesAgain(CurlRequest):
+	URL = "/page.html"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = PAGE
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Type", "text/html")]
+
+	def CheckResponse(self):
+		if self.resp_headers.get('etag') != retrieved_etag:
+			raise CurlRequestException("Unexpected etag header '%s' (wanted '%s')" % (self.resp_headers.get('etag'), retrieved_etag))
+		return True
+
+# new values once the file changed (inotify)
+class TestChanged(CurlRequest):
+	URL = "/page.html"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = PAGE + PAGE
+	EXPECT_RESPONSE_CODE = 200
+
+	def FeatureCheck(self):
+		if not sys.platform.startswith("linux"):
+			return self.MissingFeature("inotify")
+		return True
+
+	def PrepareRequest(self, reqheaders):
+		f = open(os.path.join(self.vhostdir, "page.html"), "w")
+		f.write(PAGE + PAGE)
+		f.close()
+		time.sleep(0.2)
+
+	def CheckResponse(self):
+		if self.resp_headers.get('etag') == retrieved_etag:
+			raise CurlRequestException("Got the etag of the old file")
+		return True
+
+class Test(GroupTest):
+	group = [
+		TestHeaders,
+		TestHeadersAgain,
+		TestIfNoneMatch,
+		TestIfNoneMatchStale,
+		TestIfModifiedSince,
+		TestUnknownType,
+		TestOtherMimeTypes,
+		TestDefaultMimeTypesAgain,
+		TestChanged,
+	]
+
+	def Prepare(self):
+		self.PrepareVHostFile("page.html", PAGE)
+		self.PrepareVHostFile("data.unknown-extension", "data")
+
+	config = """
+static;
+"""
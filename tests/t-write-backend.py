@@ -0,0 +1,89 @@
+# -*- coding: utf-8 -*-
+
+from base import *
+from requests import *
+
+# responses for the different paths of the write backend (runtests.py --write-backend):
+# memory chunks only, small files (read into memory / io_uring read), large files (sendfile)
+# and memory chunks mixed with file chunks (multipart ranges)
+
+BIG_FILE = "".join([ "%07i\n" % i for i in range(0, 128*1024) ]) # 1 MiB
+SMALL_FILE = BIG_FILE[:3000]
+
+class TestMemory(CurlRequest):
+	URL = "/memory"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = "memory only"
+	EXPECT_RESPONSE_CODE = 200
+
+class TestSmallFile(CurlRequest):
+	URL = "/small.txt"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = SMALL_FILE
+	EXPECT_RESPONSE_CODE = 200
+
+class TestBigFile(CurlRequest):
+	URL = "/big.txt"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = BIG_FILE
+	EXPECT_RESPONSE_CODE = 200
+	EXPECT_RESPONSE_HEADERS = [("Content-Length", str(len(BIG_FILE)))]
+
+# again, now the file is already open (stat cache)
+class TestBigFileAgain(TestBigFile):
+	pass
+
+class TestRange(CurlRequest):
+	URL = "/big.txt"
+	ACCEPT_ENCODING = None
+	REQUEST_HEADERS = ["Range: bytes=100000-299999"]
+	EXPECT_RESPONSE_BODY = BIG_FILE[100000:300000]
+	EXPECT_RESPONSE_CODE = 206
+
+class TestMultipartRange(CurlRequest):
+	URL = "/big.txt"
+	ACCEPT_ENCODING = None
+	REQUEST_HEADERS = ["Range: bytes=0-9,500000-599999,-10"]
+	EXPECT_RESPONSE_CODE = 206
+
+	def CheckResponse(self):
+		body = self.ResponseBody()
+		parts = [ BIG_FILE[0:10], BIG_FILE[500000:600000], BIG_FILE[-10:] ]
+		pos = 0
+		for part in parts:
+			pos = body.find("\r\n\r\n" + part + "\r\n--", pos)
+			if -1 == pos:
+				raise CurlRequestException("Missing part in multipart response")
+		if not body.endswith("--\r\n"):
+			raise CurlRequestException("Multipart response not terminated")
+		return True
+
+class TestHead(CurlRequest):
+	URL = "/big.txt"
+	ACCEPT_ENCODING = None
+	EXPECT_RESPONSE_BODY = ""
+	EXPECT_RESPONSE_CODE = 200
+
+	def PrepareRequest(self, reqheaders):
+		self.curl.setopt(pycurl.NOBODY, 1)
+
+class Test(GroupTest):
+	group = [
+		TestMemory,
+		TestSmallFile,
+		TestBigFile,
+		TestBigFileAgain,
+		TestRange,
+		TestMultipartRange,
+		TestHead,
+	]
+
+	def Prepare(self):
+		self.PrepareVHostFile("small.txt", SMALL_FILE)
+		self.PrepareVHostFile("big.txt", BIG_FILE)
+
+	config = """
+if req.path == "/memory" {
+	respond "memory only";
+}
+"""